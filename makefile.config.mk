@@ -26,6 +26,37 @@
 #
 DEBUG_BUILD := 1
 
+# Minimum log-level which will be compiled into the binaries.
+#
+# Calls of the LogDebug(), LogInfo(), ... macros with a lower
+# log-level will be removed completely by the compiler.  `auto` means
+# `all` for debug builds and `info` otherwise.
+#
+# values: [auto all debug info warning error fatal none]
+#
+LOGLEVEL_MIN := auto
+
+# Set to 1 to compile tracing in.
+#
+# The TraceSpan(), TraceInstant(), ... macros record into per-thread
+# ring buffers, which will be written to `log/trace.json` at exit.
+# Open it in `chrome://tracing` or https://ui.perfetto.dev.  With 0
+# the macros will be removed completely by the compiler.
+#
+# values: [1 0]
+#
+TRACE := 0
+
+# Set to `thread` to build with ThreadSanitizer, to find data races.
+# `address` builds with AddressSanitizer.  Run `$> make clean` after
+# changing it.  For example run the stress test of the Logger:
+#
+#   $> make clean && make SANITIZE=thread stress
+#
+# values: [none thread address]
+#
+SANITIZE := none
+
 # Version format: MAJOR.MINOR.PATCH{-SUFFIX}
 # MAJOR  - Breaking, changing/removing classes, class members, functional
 # MINOR  - Backward compatible, adding classes, class members
@@ -20,11 +20,34 @@ include $(PREFIX_ROOTDIR)/makefile.config.mk
 PROJECTPATH_ROOT = $(PREFIX_ITERATEDIR)/project
 LIBCOMMONPATH_ROOT = $(PREFIX_ITERATEDIR)/libathome-common
 LIBCLIENTPATH_ROOT = $(PREFIX_ITERATEDIR)/libathome-client
+LOGDECODEPATH_ROOT = $(PREFIX_ITERATEDIR)/libathome-logdecode
+LOGSTRESSPATH_ROOT = $(PREFIX_ITERATEDIR)/libathome-logstress
+BENCHPATH_ROOT = $(PREFIX_ITERATEDIR)/libathome-bench
 
 all:
 
-.PHONY: all run run-leakcheck debug
-all run run-leakcheck debug:
+.PHONY: all
+all:
+	$(MAKE) -C $(PROJECTPATH_ROOT) $@
+	$(MAKE) -C $(LOGDECODEPATH_ROOT) $@
+	$(MAKE) -C $(LOGSTRESSPATH_ROOT) $@
+	$(MAKE) -C $(BENCHPATH_ROOT) $@
+
+# Multithreaded stress test of the Logger, see makefile.config.mk for
+# building it with ThreadSanitizer
+.PHONY: stress
+stress:
+	$(MAKE) -C $(LOGSTRESSPATH_ROOT) run
+
+# Micro-benchmarks of libathome-common, see makefile.config.mk for
+# OPTFLAG.  Select some of them by BENCH, e.g.
+# '$> make bench BENCH=asyncio'
+.PHONY: bench
+bench:
+	$(MAKE) -C $(BENCHPATH_ROOT) run ARGS="$(BENCH)"
+
+.PHONY: run run-leakcheck debug
+run run-leakcheck debug:
 	$(MAKE) -C $(PROJECTPATH_ROOT) $@
 
 .PHONY: debug-emacs
@@ -38,6 +61,9 @@ recompile: clean all
 tags-ctags tags-etags tags-ebrowse tags-all:
 	$(MAKE) -C $(LIBCOMMONPATH_ROOT) $@
 	$(MAKE) -C $(LIBCLIENTPATH_ROOT) $@
+	$(MAKE) -C $(LOGDECODEPATH_ROOT) $@
+	$(MAKE) -C $(LOGSTRESSPATH_ROOT) $@
+	$(MAKE) -C $(BENCHPATH_ROOT) $@
 	$(MAKE) -C $(PROJECTPATH_ROOT) $@
 
 .PHONY: doc doc-view clean-doc
@@ -49,11 +75,17 @@ doc doc-view clean-doc:
 clean:
 	$(MAKE) -C $(LIBCOMMONPATH_ROOT) $@
 	$(MAKE) -C $(LIBCLIENTPATH_ROOT) $@
+	$(MAKE) -C $(LOGDECODEPATH_ROOT) $@
+	$(MAKE) -C $(LOGSTRESSPATH_ROOT) $@
+	$(MAKE) -C $(BENCHPATH_ROOT) $@
 	$(MAKE) -C $(PROJECTPATH_ROOT) $@
 	rm -rf *.bak *~ $(CLEAN_FILES)
 clean-all:
 	$(MAKE) -C $(LIBCOMMONPATH_ROOT) _$@-recursive
 	$(MAKE) -C $(LIBCLIENTPATH_ROOT) _$@-recursive
+	$(MAKE) -C $(LOGDECODEPATH_ROOT) _$@-recursive
+	$(MAKE) -C $(LOGSTRESSPATH_ROOT) _$@-recursive
+	$(MAKE) -C $(BENCHPATH_ROOT) _$@-recursive
 	$(MAKE) -C $(PROJECTPATH_ROOT) clean-doc
 	$(MAKE) -C $(PROJECTPATH_ROOT) $@
 	rm -rf *.bak *~ $(CLEAN_FILES) $(CLEAN_ALL_FILES)
@@ -53,10 +53,49 @@ else
   CCDEFINES +=
 endif
 
+# Compile-time log-level, see makefile.config.mk
+_LOGLEVEL_all := 0
+_LOGLEVEL_debug := 10
+_LOGLEVEL_info := 20
+_LOGLEVEL_warning := 30
+_LOGLEVEL_error := 40
+_LOGLEVEL_fatal := 50
+_LOGLEVEL_none := 60
+ifeq (auto,$(LOGLEVEL_MIN))
+  ifeq (1,$(DEBUG_BUILD))
+    LOGLEVEL_MIN := all
+  else
+    LOGLEVEL_MIN := info
+  endif
+endif
+ifeq (,$(_LOGLEVEL_$(LOGLEVEL_MIN)))
+  $(error $(ERRB) Invalid value 'LOGLEVEL_MIN := $(LOGLEVEL_MIN)' in \
+    makefile.config.mk)
+endif
+CCDEFINES += -DLOGLEVEL_MIN=$(_LOGLEVEL_$(LOGLEVEL_MIN))
+
+# Tracing, see makefile.config.mk
+ifeq (1,$(TRACE))
+  CCDEFINES += -DTRACE
+endif
+
+# Multithreading, needed for asynchronous logging, etc.
+THREADFLAGS := -pthread
+
+# Sanitizer, see makefile.config.mk
+ifeq (none,$(SANITIZE))
+  SANITIZEFLAGS :=
+else ifneq (,$(filter thread address,$(SANITIZE)))
+  SANITIZEFLAGS := -fsanitize=$(SANITIZE)
+else
+  $(error $(ERRB) Invalid value 'SANITIZE := $(SANITIZE)' in \
+    makefile.config.mk)
+endif
+
 VERSION_LIB := \
   $(VERSION_MAJOR).$(VERSION_MINOR).$(VERSION_PATCH)$(VERSION_SUFFIX)
 
-# Compiling library?
+# Compiling library, command-line tool or project?
 ifneq (,$(LIBNAME))
   OUTPUT := $(LIBNAME).$(SOEXT)
   MAIN_HEADER := $(LIBNAME).$(HEXT)
@@ -65,6 +104,14 @@ ifneq (,$(LIBNAME))
   SHAREDFLAGS += -shared
   DOC_OUTDIR := libathome
   VERSION_THIS := $(VERSION_LIB)
+else ifneq (,$(TOOLNAME))
+  OUTPUT := $(TOOLNAME)$(DOT_BINEXT)
+  MAIN_HEADER :=
+  MAIN_HEADER_TEMPL :=
+  FPICFLAGS :=
+  SHAREDFLAGS +=
+  DOC_OUTDIR := libathome
+  VERSION_THIS := $(VERSION_LIB)
 else
   OUTPUT := $(PROJECT_EXECNAME)-client$(DOT_BINEXT)
   MAIN_HEADER :=
@@ -136,7 +183,8 @@ OBJFILES := $(OBJ:=.$(OEXT))
 DEPFILES := $(OBJ:=.$(DEPEXT))
 HFILES := $(OBJ:=.$(HEXT))
 
-FLAGS := $(DEBUGFLAGS) $(WARNFLAGS) $(OPTFLAG) $(CPPSTDFLAG)
+FLAGS := $(DEBUGFLAGS) $(WARNFLAGS) $(OPTFLAG) $(CPPSTDFLAG) \
+         $(THREADFLAGS) $(SANITIZEFLAGS)
 CCFLAGS := $(FLAGS) $(FPICFLAGS) $(CCDEFINES) \
            $(addprefix -I,$(INCLUDE_PATHS))
 ASFLAGS := $(CCFLAGS)
@@ -0,0 +1,714 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file
+ * @brief Command-line tool `libathome-bench`, micro-benchmarks of
+ *        `libathome-common`.
+ *
+ * ```shell
+ * $> libathome-bench [BENCHMARK ...]
+ * ```
+ *
+ * Runs the given benchmarks, or all of them if none is given, and
+ * prints one line per measurement.  Call it with `--list` to print
+ * the names.  Temporary files are written into directory
+ * ::BENCH_PATH, which will be removed afterwards.
+ *
+ * Build it with `OPTFLAG := -O2` in `makefile.config.mk` to get
+ * meaningful numbers, see target `$> make bench`.
+ */
+
+#include <libathome-common.hpp>
+
+#include <thread>
+#include <cinttypes>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace ::libathome_common;
+
+
+/** Directory of temporary files, will be removed afterwards  */
+static const char* BENCH_PATH = "bench";
+/** Duration of one measurement  */
+static const uint64_t MEASURE_NS = 1000000000;
+
+/** Size of the file of ::bench_asyncio()  */
+static const uint64_t ASYNCIO_FILE_SIZE = 256 << 20;
+/** Size of one read of ::bench_asyncio()  */
+static const size_t ASYNCIO_BLOCK = 4096;
+
+/** Results are written here, so their loops can't be optimized away  */
+static volatile uint64_t sink;
+
+static void
+remove_all(const std::string& path) noexcept(false)
+{
+  Result<std::vector<std::string>> names
+    = Filesystem::list(path, std::nothrow);
+  if (!names) return;
+
+  for (const std::string& name: names.get())
+    Filesystem::remove(path + Filesystem::PATH_SEPERATOR + name);
+  Filesystem::remove(path);
+  Filesystem::forget_dir(path);
+}
+
+/** Xorshift64, deterministic and cheap enough to not be measured  */
+static uint64_t
+next_random(uint64_t& state)
+{
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+/* ***************************************************************  */
+
+static uint64_t
+asyncio_offset(uint64_t& state)
+{
+  return next_random(state) % (ASYNCIO_FILE_SIZE / ASYNCIO_BLOCK)
+    * ASYNCIO_BLOCK;
+}
+
+static double
+asyncio_sync(int fd, char* buffer) noexcept(false)
+{
+  uint64_t state = 88172645463325252ull, count = 0;
+
+  MonotonicClock clock;
+  while (clock.get_elapsed() < MEASURE_NS) {
+    if ((ssize_t) ASYNCIO_BLOCK
+        != ::pread(fd, buffer, ASYNCIO_BLOCK, asyncio_offset(state))) {
+      throw Err("Could not read benchmark file: %s!", ::strerror(errno));
+    }
+    count++;
+  }
+
+  return count / (clock.get_elapsed() / 1e9);
+}
+
+/**
+ * Keeps `depth` reads in flight, every completion prepares the next
+ * read into the same buffer.
+ */
+static double
+asyncio_async(int fd, char* buffers, unsigned depth,
+  AsyncIO::backend_t backend) noexcept(false)
+{
+  AsyncIO io(depth, backend);
+  if (io.get_backend() != backend) return 0.0;
+
+  std::vector<void*> addrs(depth);
+  std::vector<size_t> lengths(depth, ASYNCIO_BLOCK);
+  for (unsigned i=0; i<depth; i++)
+    addrs[i] = buffers + i * ASYNCIO_BLOCK;
+  if (backend == AsyncIO::backend_t::uring_e)
+    io.register_buffers(addrs.data(), lengths.data(), depth);
+
+  uint64_t state = 88172645463325252ull, count = 0;
+  for (unsigned i=0; i<depth; i++) {
+    io.read(fd, addrs[i], ASYNCIO_BLOCK, asyncio_offset(state), i,
+            backend == AsyncIO::backend_t::uring_e? (int) i: -1);
+  }
+
+  std::vector<AsyncIO::completion_t> done(depth);
+  MonotonicClock clock;
+  while (clock.get_elapsed() < MEASURE_NS) {
+    size_t n = io.complete(done.data(), depth, 1);
+
+    for (size_t i=0; i<n; i++) {
+      if (done[i].result != (int64_t) ASYNCIO_BLOCK) {
+        throw Err("Could not read benchmark file: %s!",
+                  ::strerror((int) -done[i].result));
+      }
+
+      unsigned index = (unsigned) done[i].tag;
+      io.read(fd, addrs[index], ASYNCIO_BLOCK, asyncio_offset(state),
+              index,
+              backend == AsyncIO::backend_t::uring_e? (int) index: -1);
+    }
+    count += n;
+  }
+  double result = count / (clock.get_elapsed() / 1e9);
+
+  /* Reads in flight must finish before BUFFERS is freed  */
+  while (0 < io.complete(done.data(), depth, depth)) {}
+
+  return result;
+}
+
+/**
+ * Random 4 KiB reads, synchronous `pread()` against
+ * ::libathome_common::AsyncIO with queue depth 1, 4, 16 and 64.
+ */
+static void
+bench_asyncio() noexcept(false)
+{
+  static const unsigned DEPTHS[] = {1, 4, 16, 64};
+  static const char* FILENAME = "asyncio.dat";
+
+  {
+    std::vector<char> chunk(1 << 20);
+    uint64_t state = 1;
+    for (char& c: chunk) c = (char) next_random(state);
+
+    File out(BENCH_PATH, FILENAME, true);
+    out.open(File::access_t::write_e);
+    for (uint64_t i=0; i<ASYNCIO_FILE_SIZE; i+=chunk.size())
+      out.write(chunk.data(), chunk.size());
+    out.close();
+  }
+
+  /* Without O_DIRECT it measures the page cache, not the disk  */
+  std::string filename_full
+    = std::string(BENCH_PATH) + Filesystem::PATH_SEPERATOR + FILENAME;
+  const char* cache = "O_DIRECT";
+  int fd = -1;
+#ifdef O_DIRECT
+  fd = ::open(filename_full.c_str(), O_RDONLY | O_DIRECT);
+#endif /* ifdef O_DIRECT  */
+  if (fd < 0) {
+    cache = "page cache";
+    fd = ::open(filename_full.c_str(), O_RDONLY);
+  }
+  if (fd < 0) {
+    throw Err("Could not open '%s': %s!", filename_full.c_str(),
+              ::strerror(errno));
+  }
+
+  unsigned depth_max = DEPTHS[sizeof(DEPTHS) / sizeof(*DEPTHS) - 1];
+  void* buffers;
+  if (0 != ::posix_memalign(&buffers, ASYNCIO_BLOCK,
+                            depth_max * ASYNCIO_BLOCK)) {
+    ::close(fd);
+    throw Err("Could not allocate buffers!");
+  }
+
+  try {
+    ::printf("asyncio: random %lu KiB reads of a %lu MiB file, %s\n",
+             (unsigned long) ASYNCIO_BLOCK >> 10,
+             (unsigned long) (ASYNCIO_FILE_SIZE >> 20), cache);
+    ::printf("  %-8s QD%-3u %9.0f IOPS\n", "pread", 1,
+             asyncio_sync(fd, (char*) buffers));
+
+    for (AsyncIO::backend_t backend: {AsyncIO::backend_t::uring_e,
+                                      AsyncIO::backend_t::threads_e}) {
+      for (unsigned depth: DEPTHS) {
+        double iops = asyncio_async(fd, (char*) buffers, depth, backend);
+        if (iops == 0.0) {
+          ::printf("  %-8s not available\n", AsyncIO::to_string(backend));
+          break;
+        }
+        ::printf("  %-8s QD%-3u %9.0f IOPS\n", AsyncIO::to_string(backend),
+                 depth, iops);
+      }
+    }
+  } catch (Error&) {
+    ::free(buffers);
+    ::close(fd);
+    throw;
+  }
+
+  ::free(buffers);
+  ::close(fd);
+}
+
+/* ***************************************************************  */
+
+/** Number of messages of ::bench_logger()  */
+static const unsigned LOGGER_MESSAGES = 200000;
+
+static double
+logger_reopen() noexcept(false)
+{
+  File out(BENCH_PATH, "reopen.log", false);
+
+  MonotonicClock clock;
+  for (unsigned i=0; i<LOGGER_MESSAGES; i++) {
+    out.open(File::access_t::append_e);
+    out.printf("[00:00:00.000] info: benchmark message=%u\n", i);
+    out.close();
+  }
+
+  return LOGGER_MESSAGES / (clock.get_elapsed() / 1e9);
+}
+
+static double
+logger_policy(size_t flush_bytes) noexcept(false)
+{
+  MonotonicClock clock;
+  {
+    Logger logger(Logger::loglevel_t::info_e, RealtimeClock::utc_e,
+                  BENCH_PATH, "policy.log", 0);
+    logger.set_flush_policy(64*1024, flush_bytes, 1000);
+
+    clock.restart();
+    for (unsigned i=0; i<LOGGER_MESSAGES; i++)
+      logger.info("benchmark message=%u", i);
+  }
+
+  return LOGGER_MESSAGES / (clock.get_elapsed() / 1e9);
+}
+
+/**
+ * Synchronous text messages into a log file.  Opening the file per
+ * message, as ::libathome_common::Logger did before, against keeping
+ * it open and flushing per message or by its default flush policy.
+ */
+static void
+bench_logger() noexcept(false)
+{
+  ::printf("logger: %u info messages, text, synchronous\n",
+           LOGGER_MESSAGES);
+  ::printf("  %-20s %9.0f messages/s\n", "open per message",
+           logger_reopen());
+  ::printf("  %-20s %9.0f messages/s\n", "flush per message",
+           logger_policy(0));
+  ::printf("  %-20s %9.0f messages/s\n", "flush per 32 KiB",
+           logger_policy(32*1024));
+}
+
+/* ***************************************************************  */
+
+/** Number of calls of ::bench_timestamp()  */
+static const unsigned TIMESTAMP_CALLS = 1000000;
+static const char* TIMESTAMP_FMT = "[%H:%M:%S.%3N]";
+
+static double
+timestamp_clock(RealtimeClock::timezone_t timezone) noexcept(false)
+{
+  size_t length = 0;
+
+  MonotonicClock clock;
+  for (unsigned i=0; i<TIMESTAMP_CALLS; i++)
+    length += RealtimeClock(timezone).to_string(TIMESTAMP_FMT).length();
+
+  sink = length;
+  return clock.get_elapsed() / (double) TIMESTAMP_CALLS;
+}
+
+static double
+timestamp_cache(RealtimeClock::timezone_t timezone) noexcept(false)
+{
+  TimestampCache cache(timezone, TIMESTAMP_FMT);
+  string_t buf;
+  size_t length = 0;
+
+  MonotonicClock clock;
+  for (unsigned i=0; i<TIMESTAMP_CALLS; i++)
+    length += cache.format(buf, STRING_LEN);
+
+  sink = length;
+  return clock.get_elapsed() / (double) TIMESTAMP_CALLS;
+}
+
+/**
+ * Formatting the log timestamp by
+ * ::libathome_common::RealtimeClock per call against
+ * ::libathome_common::TimestampCache.
+ */
+static void
+bench_timestamp() noexcept(false)
+{
+  ::printf("timestamp: %u calls of '%s'\n", TIMESTAMP_CALLS,
+           TIMESTAMP_FMT);
+
+  for (RealtimeClock::timezone_t timezone: {RealtimeClock::utc_e,
+                                            RealtimeClock::local_e}) {
+    ::printf("  %-10s %-14s %7.1f ns/call\n",
+             RealtimeClock::to_string(timezone), "RealtimeClock",
+             timestamp_clock(timezone));
+    ::printf("  %-10s %-14s %7.1f ns/call\n",
+             RealtimeClock::to_string(timezone), "TimestampCache",
+             timestamp_cache(timezone));
+  }
+}
+
+/* ***************************************************************  */
+
+/** Number of exceptions of ::bench_error()  */
+static const unsigned ERROR_THROWS = 100000;
+
+static double
+error_throw(bool what) noexcept(false)
+{
+  size_t length = 0;
+
+  MonotonicClock clock;
+  for (unsigned i=0; i<ERROR_THROWS; i++) {
+    try {
+      throw Err("Benchmark error %u!", i);
+    } catch (Error& e) {
+      length += what? ::strlen(e.what()): 1;
+    }
+  }
+
+  sink = length;
+  return clock.get_elapsed() / 1e3 / ERROR_THROWS;
+}
+
+/**
+ * Throwing and catching ::libathome_common::Error, with and without
+ * building the message by ::libathome_common::Error::what(), which
+ * resolves the symbols of the backtrace.
+ */
+static void
+bench_error() noexcept(false)
+{
+  ::printf("error: %u times Err() thrown and caught\n", ERROR_THROWS);
+  ::printf("  %-18s %7.2f us/throw\n", "without what()",
+           error_throw(false));
+  ::printf("  %-18s %7.2f us/throw\n", "with what()",
+           error_throw(true));
+}
+
+/* ***************************************************************  */
+
+/** Number of outstanding timers of ::bench_timerwheel()  */
+static const unsigned TIMERWHEEL_TIMERS = 1000000;
+
+static double
+timerwheel_add(TimerWheel& timers, std::vector<TimerWheel::handle_t>&
+  handles) noexcept(false)
+{
+  /* Delays up to one hour, so nothing expires  */
+  uint64_t state = 88172645463325252ull;
+
+  MonotonicClock clock;
+  for (unsigned i=0; i<TIMERWHEEL_TIMERS; i++)
+    handles[i] = timers.add(next_random(state) % 3600000, []() {});
+
+  return clock.get_elapsed() / (double) TIMERWHEEL_TIMERS;
+}
+
+static double
+timerwheel_cancel(TimerWheel& timers, const std::vector<
+  TimerWheel::handle_t>& handles) noexcept(false)
+{
+  MonotonicClock clock;
+  for (TimerWheel::handle_t handle: handles) {
+    if (!timers.cancel(handle)) throw Err("Timer was already gone!");
+  }
+
+  return clock.get_elapsed() / (double) TIMERWHEEL_TIMERS;
+}
+
+/**
+ * Adding and canceling ::libathome_common::TimerWheel timers while
+ * ::TIMERWHEEL_TIMERS are outstanding.  The first fill grows the
+ * pool, the second one reuses it.
+ */
+static void
+bench_timerwheel() noexcept(false)
+{
+  TimerWheel timers;
+  std::vector<TimerWheel::handle_t> handles(TIMERWHEEL_TIMERS);
+
+  ::printf("timerwheel: %u outstanding timers\n", TIMERWHEEL_TIMERS);
+  ::printf("  %-18s %7.1f ns/timer\n", "add, first fill",
+           timerwheel_add(timers, handles));
+  ::printf("  %-18s %7.1f ns/timer\n", "cancel",
+           timerwheel_cancel(timers, handles));
+  ::printf("  %-18s %7.1f ns/timer\n", "add, pool warm",
+           timerwheel_add(timers, handles));
+  ::printf("  %-18s %7.1f ns/timer\n", "cancel",
+           timerwheel_cancel(timers, handles));
+}
+
+/* ***************************************************************  */
+
+/** Numbers factorized by ::bench_threadpool()  */
+static const unsigned THREADPOOL_NUMBERS = 4096;
+static const uint64_t THREADPOOL_FIRST = 1000000000000ull;
+
+/** Slow on purpose, every number costs up to a million divisions  */
+static uint64_t
+threadpool_factorize(uint64_t n)
+{
+  uint64_t factors = 0;
+
+  for (uint64_t d=2; d*d<=n; d++) {
+    while (n % d == 0) {
+      n /= d;
+      factors++;
+    }
+  }
+
+  return factors + (n > 1? 1: 0);
+}
+
+static double
+threadpool_run(unsigned threads, uint64_t& steals) noexcept(false)
+{
+  ThreadPool pool(threads);
+  std::atomic<uint64_t> factors(0);
+
+  /* All tasks are spawned by a worker, so the others must steal them
+   */
+  MonotonicClock clock;
+  pool.submit([&pool, &factors]() {
+      for (unsigned i=0; i<THREADPOOL_NUMBERS; i++) {
+        pool.submit([&factors, i]() {
+            factors.fetch_add(threadpool_factorize(THREADPOOL_FIRST + i));
+          });
+      }
+    });
+  pool.wait_idle();
+  double seconds = clock.get_elapsed() / 1e9;
+
+  sink = factors.load();
+  steals = pool.get_steals();
+  return seconds;
+}
+
+/**
+ * Scaling of ::libathome_common::ThreadPool, trial division of
+ * numbers near `1e12` with 1, 2, 4 workers and one per hardware
+ * thread.
+ */
+static void
+bench_threadpool() noexcept(false)
+{
+  std::vector<unsigned> counts = {1, 2, 4};
+  unsigned hardware = std::thread::hardware_concurrency();
+  if (hardware > counts.back()) counts.push_back(hardware);
+
+  ::printf("threadpool: trial division of %u numbers near %" PRIu64
+           ", %u hardware threads\n", THREADPOOL_NUMBERS,
+           THREADPOOL_FIRST, hardware);
+
+  double first = 0.0;
+  for (unsigned threads: counts) {
+    uint64_t steals;
+    double seconds = threadpool_run(threads, steals);
+    if (first == 0.0) first = seconds;
+
+    ::printf("  %3u workers %7.2f s  speedup %5.2f  steals %" PRIu64 "\n",
+             threads, seconds, first / seconds, steals);
+  }
+}
+
+/* ***************************************************************  */
+
+/** Size of the file of ::bench_read()  */
+static const uint64_t READ_FILE_SIZE = 512 << 20;
+static const char* READ_FILENAME = "read.dat";
+
+/** Sums `data` as 64-bit words, so every byte is touched  */
+static uint64_t
+read_sum(const char* data, size_t length)
+{
+  uint64_t result = 0;
+
+  for (size_t i=0; i+sizeof(uint64_t)<=length; i+=sizeof(uint64_t)) {
+    uint64_t word;
+    ::memcpy(&word, data + i, sizeof(word));
+    result += word;
+  }
+
+  return result;
+}
+
+static double
+read_map() noexcept(false)
+{
+  File in(BENCH_PATH, READ_FILENAME, true);
+  in.open(File::access_t::read_e);
+
+  MonotonicClock clock;
+  File::span_t span = in.map(File::advice_t::sequential_e);
+  sink = read_sum(span.data, span.length);
+  double seconds = clock.get_elapsed() / 1e9;
+
+  in.close();
+  return READ_FILE_SIZE / seconds / 1e9;
+}
+
+static double
+read_span(size_t chunk) noexcept(false)
+{
+  File in(BENCH_PATH, READ_FILENAME, true);
+  in.set_buffer(chunk);
+  in.open(File::access_t::read_e);
+
+  uint64_t sum = 0;
+  MonotonicClock clock;
+  for (File::span_t span = in.read_span(); span.length > 0;
+       span = in.read_span())
+    sum += read_sum(span.data, span.length);
+  double seconds = clock.get_elapsed() / 1e9;
+
+  sink = sum;
+  in.close();
+  return READ_FILE_SIZE / seconds / 1e9;
+}
+
+static double
+read_fread(size_t chunk) noexcept(false)
+{
+  File in(BENCH_PATH, READ_FILENAME, true);
+  in.open(File::access_t::read_e);
+  std::vector<char> buffer(chunk);
+
+  uint64_t sum = 0;
+  size_t length;
+  MonotonicClock clock;
+  while (0 < (length = in.read(buffer.data(), chunk)))
+    sum += read_sum(buffer.data(), length);
+  double seconds = clock.get_elapsed() / 1e9;
+
+  sink = sum;
+  in.close();
+  return READ_FILE_SIZE / seconds / 1e9;
+}
+
+static double
+read_pread(size_t chunk) noexcept(false)
+{
+  std::string filename_full = std::string(BENCH_PATH)
+    + Filesystem::PATH_SEPERATOR + READ_FILENAME;
+  int fd = ::open(filename_full.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw Err("Could not open '%s': %s!", filename_full.c_str(),
+              ::strerror(errno));
+  }
+  std::vector<char> buffer(chunk);
+
+  uint64_t sum = 0, offset = 0;
+  ssize_t length;
+  MonotonicClock clock;
+  while (0 < (length = ::pread(fd, buffer.data(), chunk, offset))) {
+    sum += read_sum(buffer.data(), length);
+    offset += length;
+  }
+  double seconds = clock.get_elapsed() / 1e9;
+
+  ::close(fd);
+  if (length < 0) {
+    throw Err("Could not read '%s': %s!", filename_full.c_str(),
+              ::strerror(errno));
+  }
+
+  sink = sum;
+  return READ_FILE_SIZE / seconds / 1e9;
+}
+
+/**
+ * Sequential reading of a file by the read paths of
+ * ::libathome_common::File against plain `pread()`.  The file is
+ * read once before, so all of them read from the page cache.
+ */
+static void
+bench_read() noexcept(false)
+{
+  static const size_t CHUNKS[] = {1 << 20, 64 << 10};
+
+  {
+    std::vector<char> chunk(1 << 20);
+    uint64_t state = 1;
+    for (char& c: chunk) c = (char) next_random(state);
+
+    File out(BENCH_PATH, READ_FILENAME, true);
+    out.open(File::access_t::write_e);
+    for (uint64_t i=0; i<READ_FILE_SIZE; i+=chunk.size())
+      out.write(chunk.data(), chunk.size());
+    out.close();
+  }
+  read_map();
+
+  ::printf("read: %lu MiB file from the page cache, summed as 64-bit "
+           "words\n", (unsigned long) (READ_FILE_SIZE >> 20));
+  ::printf("  %-9s %-10s %6.2f GB/s\n", "whole", "map", read_map());
+  for (size_t chunk: CHUNKS) {
+    std::string name = std::to_string(chunk >> 10) + " KiB";
+    ::printf("  %-9s %-10s %6.2f GB/s\n", name.c_str(), "read_span",
+             read_span(chunk));
+    ::printf("  %-9s %-10s %6.2f GB/s\n", name.c_str(), "read",
+             read_fread(chunk));
+    ::printf("  %-9s %-10s %6.2f GB/s\n", name.c_str(), "pread",
+             read_pread(chunk));
+  }
+}
+
+/* ***************************************************************  */
+
+typedef struct {
+  const char* name;
+  void (*run)();
+} benchmark_t;
+
+static const benchmark_t BENCHMARKS[] = {
+  {"asyncio", bench_asyncio},
+  {"logger", bench_logger},
+  {"timestamp", bench_timestamp},
+  {"error", bench_error},
+  {"timerwheel", bench_timerwheel},
+  {"threadpool", bench_threadpool},
+  {"read", bench_read},
+};
+
+int
+main(int argc, char** argv)
+{
+  std::vector<const benchmark_t*> selected;
+  for (int i=1; i<argc; i++) {
+    if (0 == ::strcmp(argv[i], "--list")) {
+      for (const benchmark_t& benchmark: BENCHMARKS)
+        ::printf("%s\n", benchmark.name);
+      return 0;
+    }
+
+    const benchmark_t* found = NULL;
+    for (const benchmark_t& benchmark: BENCHMARKS) {
+      if (0 == ::strcmp(argv[i], benchmark.name)) found = &benchmark;
+    }
+    if (found == NULL) {
+      ::fprintf(stderr, "Usage: %s [--list] [BENCHMARK ...]\n", argv[0]);
+      return 2;
+    }
+    selected.push_back(found);
+  }
+  if (selected.empty()) {
+    for (const benchmark_t& benchmark: BENCHMARKS)
+      selected.push_back(&benchmark);
+  }
+
+  int result = 0;
+  for (const benchmark_t* benchmark: selected) {
+    try {
+      remove_all(BENCH_PATH);
+      benchmark->run();
+    } catch (Error& e) {
+      ::fprintf(stderr, "ERROR: %s\n", e.what());
+      result = 1;
+    }
+
+    try {
+      remove_all(BENCH_PATH);
+    } catch (Error& e) {
+      ::fprintf(stderr, "ERROR: %s\n", e.what());
+      result = 1;
+    }
+  }
+
+  return result;
+}
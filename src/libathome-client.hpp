@@ -32,6 +32,9 @@
 
 #include <libathome-common.hpp>
 
-#include "libathome-client/Init.hpp"
+#include "libathome-client/Init.hpp" 
+#include "libathome-client/TaskResult.hpp" 
+#include "libathome-client/Task.hpp" 
+#include "libathome-client/Engine.hpp"
 
 #endif /* LIBATHOME_CLIENT_H__  */
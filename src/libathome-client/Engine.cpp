@@ -0,0 +1,291 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-client/Engine.hpp"
+
+#include <cerrno>
+#include <cinttypes>
+
+using namespace ::libathome_common;
+
+
+libathome_client::Engine::
+Engine(const std::string& path, const std::string& filename,
+  size_t prefetch, size_t upload_batch) noexcept(false)
+  :path(path), filename(filename), prefetch(prefetch),
+   upload_batch(upload_batch == 0? 1: upload_batch), checkpoint(0),
+   stopping(false), exhausted(false), fetched(0), computing(0),
+   next_id(0)
+{
+  Common* common = Common::get();
+  if (common == NULL)
+    throw Err("libathome_client::Init must be instanced before!");
+
+  this->pool = common->get_pool();
+  if (this->prefetch == 0) this->prefetch = 4 * this->pool->get_threads();
+
+  Metrics* metrics = common->get_metrics();
+  this->tasks_done = &metrics->counter(
+    "libathome_tasks_done_total", "Computed tasks");
+  this->tasks_failed = &metrics->counter(
+    "libathome_tasks_failed_total", "Tasks which could not be computed");
+  this->compute_ns = &metrics->histogram(
+    "libathome_task_compute_ns", "Time to compute a task");
+
+  std::string checkpoint_path
+    = path + Filesystem::PATH_SEPERATOR + filename;
+  ::FILE* in = ::fopen(checkpoint_path.c_str(), "r");
+  if (in == NULL) {
+    if (errno != ENOENT) {
+      throw Err("Could not open checkpoint '%s': %s!",
+                checkpoint_path.c_str(), ::strerror(errno));
+    }
+    return;
+  }
+
+  int matched = ::fscanf(in, "%" SCNu64, &this->checkpoint);
+  ::fclose(in);
+  if (matched != 1)
+    throw Err("Checkpoint '%s' is corrupt!", checkpoint_path.c_str());
+
+  this->next_id = this->checkpoint;
+}
+
+libathome_client::Engine::
+~Engine()
+{
+}
+
+uint64_t libathome_client::Engine::
+get_checkpoint() const
+{
+  return this->checkpoint;
+}
+
+/* ***************************************************************  */
+
+uint64_t libathome_client::Engine::
+run(uint64_t max_tasks) noexcept(false)
+{
+  std::unique_lock<std::mutex> lock(this->engine_mutex);
+
+  this->stopping = false;
+  this->exhausted = false;
+  this->fetcher_error = nullptr;
+  this->fetched = 0;
+  this->fetcher = std::thread(&Engine::_fetcher_main, this, max_tasks);
+
+  /* Enough to keep every worker busy while results are collected  */
+  size_t window = 2 * this->pool->get_threads();
+  uint64_t uploaded = 0;
+  std::exception_ptr error;
+  std::vector<TaskResult*> batch;
+
+  for (;;) {
+    if (error != nullptr) this->stopping = true;
+    if (this->stopping) {
+      /* Still outstanding, so they hold back the checkpoint and will
+       * be fetched again after a restart
+       */
+      for (Task* task: this->queue) delete task;
+      this->queue.clear();
+      this->fetcher_cond.notify_one();
+    }
+
+    while (!this->queue.empty() && this->computing < window) {
+      Task* task = this->queue.front();
+      this->queue.pop_front();
+      this->computing++;
+      this->pool->submit([this, task]() { this->_compute(task); });
+      this->fetcher_cond.notify_one();
+    }
+
+    bool done = (this->exhausted || this->stopping)
+      && this->queue.empty() && this->computing == 0;
+
+    if (!this->results.empty() && error == nullptr
+        && (done || this->results.size() >= this->upload_batch)) {
+      batch.swap(this->results);
+      lock.unlock();
+      try {
+        uploaded += batch.size();
+        this->_upload(batch);
+      } catch (Error&) {
+        error = std::current_exception();
+      }
+      lock.lock();
+      continue;
+    }
+    if (done) break;
+
+    this->engine_cond.wait(lock);
+  }
+
+  /* Results which could not be uploaded after an error  */
+  for (TaskResult* result: this->results) delete result;
+  this->results.clear();
+
+  this->stopping = true;
+  this->fetcher_cond.notify_one();
+  lock.unlock();
+  this->fetcher.join();
+
+  if (error == nullptr) error = this->fetcher_error;
+  if (error != nullptr) std::rethrow_exception(error);
+
+  return uploaded;
+}
+
+void libathome_client::Engine::
+stop()
+{
+  std::lock_guard<std::mutex> lock(this->engine_mutex);
+
+  this->stopping = true;
+  this->engine_cond.notify_one();
+  this->fetcher_cond.notify_one();
+}
+
+/* ***************************************************************  */
+
+void libathome_client::Engine::
+_fetcher_main(uint64_t max_tasks)
+{
+  std::vector<Task*> tasks;
+  std::unique_lock<std::mutex> lock(this->engine_mutex);
+
+  while (!this->stopping && !this->exhausted) {
+    if (this->queue.size() >= this->prefetch) {
+      this->fetcher_cond.wait(lock);
+      continue;
+    }
+
+    size_t max = this->prefetch - this->queue.size();
+    if (max_tasks != 0 && max > max_tasks - this->fetched)
+      max = (size_t) (max_tasks - this->fetched);
+    if (max == 0) {
+      this->exhausted = true;
+      break;
+    }
+
+    lock.unlock();
+    tasks.clear();
+    try {
+      TraceSpan("fetch");
+      this->fetch(max, tasks);
+    } catch (Error&) {
+      lock.lock();
+      this->fetcher_error = std::current_exception();
+      this->exhausted = true;
+      break;
+    }
+    lock.lock();
+
+    if (tasks.empty()) this->exhausted = true;
+    for (Task* task: tasks) {
+      this->queue.push_back(task);
+      this->outstanding.insert(task->get_id());
+      uint64_t end = task->get_id() + task->get_span();
+      if (end > this->next_id) this->next_id = end;
+    }
+    this->fetched += tasks.size();
+    this->engine_cond.notify_one();
+  }
+
+  this->engine_cond.notify_one();
+}
+
+void libathome_client::Engine::
+_compute(Task* task)
+{
+  TaskResult* result = NULL;
+  {
+    TraceSpan("compute");
+    ScopedTimer timer(*this->compute_ns);
+
+    try {
+      result = task->compute();
+    } catch (Error& e) {
+      Log->error(e);
+    } catch (std::exception& e) {
+      Log->error("Task %" PRIu64 " has failed: %s", task->get_id(),
+                 e.what());
+    } catch (...) {
+      Log->error("Task %" PRIu64 " has failed: unknown exception",
+                 task->get_id());
+    }
+  }
+
+  delete task;
+
+  std::lock_guard<std::mutex> lock(this->engine_mutex);
+
+  if (result != NULL) {
+    this->results.push_back(result);
+    this->tasks_done->add();
+  } else {
+    /* Stays outstanding, so the checkpoint stops in front of it and
+     * it will be fetched again after a restart
+     */
+    this->tasks_failed->add();
+  }
+
+  this->computing--;
+  this->engine_cond.notify_one();
+}
+
+void libathome_client::Engine::
+_upload(std::vector<TaskResult*>& batch) noexcept(false)
+{
+  try {
+    TraceSpan("upload");
+    this->upload(batch);
+  } catch (Error&) {
+    for (TaskResult* result: batch) delete result;
+    batch.clear();
+    throw;
+  }
+
+  uint64_t checkpoint;
+  {
+    std::lock_guard<std::mutex> lock(this->engine_mutex);
+
+    for (TaskResult* result: batch)
+      this->outstanding.erase(result->get_task_id());
+    checkpoint = this->outstanding.empty()
+      ? this->next_id: *this->outstanding.begin();
+  }
+
+  for (TaskResult* result: batch) delete result;
+  batch.clear();
+
+  if (checkpoint != this->checkpoint) this->_save_checkpoint(checkpoint);
+}
+
+void libathome_client::Engine::
+_save_checkpoint(uint64_t id) noexcept(false)
+{
+  /* Replace it as a whole, a crash must not leave a torn file  */
+  File out(this->path, this->filename, false);
+  out.open(File::access_t::replace_e);
+  out.printf("%" PRIu64 "\n", id);
+  out.commit();
+
+  this->checkpoint = id;
+}
@@ -0,0 +1,203 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_CLIENT_ENGINE_H__
+#define LIBATHOME_CLIENT_ENGINE_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_client::Engine.
+ */
+
+#include "libathome-client/Task.hpp"
+
+#include <deque>
+#include <set>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <condition_variable>
+
+namespace libathome_client
+{
+
+/**
+ * **Abstract** execution engine, runs ::libathome_client::Task on all
+ * cores.
+ *
+ * Implement ::libathome_client::Engine::fetch() and
+ * ::libathome_client::Engine::upload() to connect it to the server of
+ * your project.  ::libathome_client::Engine::run() then
+ *
+ * - fetches tasks in a background thread into a prefetch queue, so
+ *   the workers never wait for I/O,
+ * - computes them on ::libathome_common::Common::get_pool(),
+ * - uploads the results in batches and
+ * - checkpoints the progress to a file after every batch, so a
+ *   restarted client continues at
+ *   ::libathome_client::Engine::get_checkpoint().
+ *
+ * Records the metrics `libathome_tasks_done_total`,
+ * `libathome_tasks_failed_total` and `libathome_task_compute_ns`.
+ *
+ * **Example**
+ * ```cpp
+ * class MyEngine: public Engine
+ * {
+ *   ...
+ *   virtual void fetch(size_t max, std::vector<Task*>& tasks) override;
+ *   virtual void upload(const std::vector<TaskResult*>& results)
+ *     override;
+ * };
+ *
+ * MyEngine engine;
+ * engine.run();
+ * ```
+ */
+class Engine
+{
+public:
+  /**
+   * Constructs an engine and loads the checkpoint of the last run.
+   *
+   * ::libathome_client::Init must be instanced.
+   *
+   * @param path Directory of the checkpoint file
+   * @param filename Filename of the checkpoint file
+   * @param prefetch Maximum number of fetched tasks which are not yet
+   *                 computing, `0` for 4 per worker
+   * @param upload_batch Number of results per upload
+   * @exception ::libathome_common::Error will be thrown if
+   *            ::libathome_client::Init was not instanced or the
+   *            checkpoint file is corrupt
+   */
+  explicit Engine(const std::string& path = "checkpoint",
+    const std::string& filename = "engine.txt", size_t prefetch = 0,
+    size_t upload_batch = 256) noexcept(false);
+  /**
+   * Default destructor.
+   */
+  virtual ~Engine();
+
+  /**
+   * Returns the first task ID which was not uploaded yet.
+   *
+   * All tasks with lower IDs, which were fetched, are uploaded
+   * already.  Use it in ::libathome_client::Engine::fetch() to
+   * continue after a restart.
+   *
+   * @return The ID, `0` if there was no checkpoint
+   */
+  virtual uint64_t get_checkpoint() const;
+
+  /**
+   * Fetches, computes and uploads tasks until
+   * ::libathome_client::Engine::fetch() returns no more tasks,
+   * `max_tasks` were fetched or ::libathome_client::Engine::stop() was
+   * called.
+   *
+   * @param max_tasks Maximum number of tasks to fetch, `0` for no
+   *                  limit
+   * @return Number of uploaded results
+   * @exception ::libathome_common::Error will be thrown if fetching,
+   *            uploading or checkpointing has failed.  The tasks which
+   *            are computing will be finished before.
+   */
+  virtual uint64_t run(uint64_t max_tasks = 0) noexcept(false);
+  /**
+   * Lets ::libathome_client::Engine::run() return soon.
+   *
+   * Thread-safe.  Fetched tasks which are not computing will be
+   * dropped, the computed ones will be uploaded.  The checkpoint stays
+   * before the dropped tasks.
+   */
+  virtual void stop();
+
+protected:
+  /**
+   * Fetches new tasks from the server.
+   *
+   * Called in a background thread, so it may block.
+   *
+   * @param max Maximum number of tasks to fetch
+   * @param tasks Output, the fetched tasks will be appended.  Leave it
+   *              empty if there are no more tasks.
+   * @exception ::libathome_common::Error may be thrown if fetching has
+   *            failed, it will be rethrown by
+   *            ::libathome_client::Engine::run()
+   */
+  virtual void fetch(size_t max, std::vector<Task*>& tasks)
+    noexcept(false) = 0;
+  /**
+   * Sends results to the server.
+   *
+   * Called by the thread of ::libathome_client::Engine::run().  The
+   * results will be deleted afterwards.
+   *
+   * @param results The results, at most `upload_batch`
+   * @exception ::libathome_common::Error may be thrown if uploading
+   *            has failed, it will be rethrown by
+   *            ::libathome_client::Engine::run()
+   */
+  virtual void upload(const std::vector<TaskResult*>& results)
+    noexcept(false) = 0;
+
+private:
+  std::string path;
+  std::string filename;
+  size_t prefetch;
+  size_t upload_batch;
+  uint64_t checkpoint;
+
+  libathome_common::ThreadPool* pool;
+  libathome_common::Counter* tasks_done;
+  libathome_common::Counter* tasks_failed;
+  libathome_common::Histogram* compute_ns;
+
+  std::mutex engine_mutex;
+  /** Woken on new tasks, results or stop  */
+  std::condition_variable engine_cond;
+  /** Woken if the prefetch queue has room  */
+  std::condition_variable fetcher_cond;
+  std::thread fetcher;
+  bool stopping;
+  bool exhausted;
+  std::exception_ptr fetcher_error;
+  uint64_t fetched;
+
+  std::deque<Task*> queue;
+  size_t computing;
+  std::vector<TaskResult*> results;
+  /** Fetched but not yet uploaded task IDs  */
+  std::set<uint64_t> outstanding;
+  /** Behind the highest ID which is covered by a fetched task  */
+  uint64_t next_id;
+
+  void _fetcher_main(uint64_t max_tasks);
+  void _compute(Task* task);
+  void _upload(std::vector<TaskResult*>& batch) noexcept(false);
+  void _save_checkpoint(uint64_t id) noexcept(false);
+
+  Engine(const Engine&) = delete;
+  Engine& operator=(const Engine&) = delete;
+
+}; /* class Engine  */
+
+} /* namespace libathome_client  */
+#endif /* LIBATHOME_CLIENT_ENGINE_H__  */
@@ -0,0 +1,44 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-client/Task.hpp"
+
+
+libathome_client::Task::
+Task(uint64_t id, uint64_t span)
+  :id(id), span(span < 1? 1: span)
+{
+}
+
+libathome_client::Task::
+~Task()
+{
+}
+
+uint64_t libathome_client::Task::
+get_id() const
+{
+  return this->id;
+}
+
+uint64_t libathome_client::Task::
+get_span() const
+{
+  return this->span;
+}
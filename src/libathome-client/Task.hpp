@@ -0,0 +1,95 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_CLIENT_TASK_H__
+#define LIBATHOME_CLIENT_TASK_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_client::Task.
+ */
+
+#include "libathome-client/TaskResult.hpp"
+
+namespace libathome_client
+{
+
+/**
+ * **Abstract** unit of work which was fetched from the server.
+ *
+ * Implement ::libathome_client::Task::compute() for the calculation
+ * of your project.  Tasks are created by
+ * ::libathome_client::Engine::fetch() and computed on the workers of
+ * ::libathome_common::ThreadPool, so
+ * ::libathome_client::Task::compute() must not touch state which is
+ * shared with other tasks without synchronization.
+ */
+class Task
+{
+public:
+  /**
+   * Constructs a task.
+   *
+   * @param id Identifies the task, unique and increasing in the order
+   *           of fetching.  The progress will be checkpointed by it,
+   *           see ::libathome_client::Engine::get_checkpoint().
+   * @param span Number of IDs which are covered by the task, it
+   *             covers `[id, id+span)`.  The IDs of different tasks
+   *             must not overlap.  Greater than `1` for tasks which
+   *             batch many small pieces of work.
+   */
+  explicit Task(uint64_t id, uint64_t span = 1);
+  /**
+   * Default destructor.
+   */
+  virtual ~Task();
+
+  /**
+   * Returns the ID of the task.
+   *
+   * @return The ID
+   */
+  virtual uint64_t get_id() const;
+  /**
+   * Returns the number of IDs which are covered by the task.
+   *
+   * @return At least `1`
+   */
+  virtual uint64_t get_span() const;
+
+  /**
+   * Solves the task.
+   *
+   * Called once, on a worker thread.
+   *
+   * @return The result, owned by the caller
+   * @exception ::libathome_common::Error may be thrown if the task can
+   *            not be solved, then it will be logged.  The checkpoint
+   *            stays in front of it, so it will be computed again
+   *            after a restart.
+   */
+  virtual TaskResult* compute() noexcept(false) = 0;
+
+private:
+  uint64_t id;
+  uint64_t span;
+
+}; /* class Task  */
+
+} /* namespace libathome_client  */
+#endif /* LIBATHOME_CLIENT_TASK_H__  */
@@ -0,0 +1,38 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-client/TaskResult.hpp"
+
+
+libathome_client::TaskResult::
+TaskResult(uint64_t task_id)
+  :task_id(task_id)
+{
+}
+
+libathome_client::TaskResult::
+~TaskResult()
+{
+}
+
+uint64_t libathome_client::TaskResult::
+get_task_id() const
+{
+  return this->task_id;
+}
@@ -0,0 +1,74 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_CLIENT_TASKRESULT_H__
+#define LIBATHOME_CLIENT_TASKRESULT_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_client::TaskResult.
+ */
+
+#include <libathome-common.hpp>
+
+namespace libathome_client
+{
+
+/**
+ * **Abstract** result of a solved ::libathome_client::Task.
+ *
+ * Created by ::libathome_client::Task::compute() and handed in
+ * batches to ::libathome_client::Engine::upload(), which owns it
+ * from then on.
+ */
+class TaskResult
+{
+public:
+  /**
+   * Constructs the result of a task.
+   *
+   * @param task_id ::libathome_client::Task::get_id() of the solved
+   *                task
+   */
+  explicit TaskResult(uint64_t task_id);
+  /**
+   * Default destructor.
+   */
+  virtual ~TaskResult();
+
+  /**
+   * Returns the ID of the solved task.
+   *
+   * @return ::libathome_client::Task::get_id() of the solved task
+   */
+  virtual uint64_t get_task_id() const;
+
+  /**
+   * Appends the result in the format which is sent to the server.
+   *
+   * @param out The encoded result will be appended
+   */
+  virtual void serialize(std::string& out) const = 0;
+
+private:
+  uint64_t task_id;
+
+}; /* class TaskResult  */
+
+} /* namespace libathome_client  */
+#endif /* LIBATHOME_CLIENT_TASKRESULT_H__  */
@@ -31,9 +31,26 @@
 
 #include "libathome-common/Common.hpp" 
 #include "libathome-common/Error.hpp" 
+#include "libathome-common/Result.hpp" 
 #include "libathome-common/RealtimeClock.hpp" 
+#include "libathome-common/MonotonicClock.hpp" 
+#include "libathome-common/Histogram.hpp" 
+#include "libathome-common/ScopedTimer.hpp" 
+#include "libathome-common/Counter.hpp" 
+#include "libathome-common/Gauge.hpp" 
+#include "libathome-common/TimestampCache.hpp" 
 #include "libathome-common/Filesystem.hpp" 
 #include "libathome-common/File.hpp" 
-#include "libathome-common/Logger.hpp"
+#include "libathome-common/LogRingbuffer.hpp" 
+#include "libathome-common/LogBinary.hpp" 
+#include "libathome-common/LogLimiter.hpp" 
+#include "libathome-common/Logger.hpp" 
+#include "libathome-common/CrashHandler.hpp" 
+#include "libathome-common/Metrics.hpp" 
+#include "libathome-common/Tracer.hpp" 
+#include "libathome-common/TimerWheel.hpp" 
+#include "libathome-common/ThreadPool.hpp" 
+#include "libathome-common/AsyncIO.hpp" 
+#include "libathome-common/Journal.hpp"
 
 #endif /* LIBATHOME_COMMON_H__  */
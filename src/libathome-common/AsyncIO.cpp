@@ -0,0 +1,501 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "libathome-common/AsyncIO.hpp"
+#include "libathome-common/Error.hpp"
+
+#include <cerrno>
+#include <algorithm>
+
+#ifdef __linux__
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#endif /* ifdef __linux__  */
+#ifndef OSWIN
+#  include <unistd.h>
+#endif /* ifndef OSWIN  */
+
+
+const char* libathome_common::AsyncIO::
+to_string(AsyncIO::backend_t backend)
+{
+  switch (backend) {
+  case uring_e: return "io_uring";
+  case threads_e: return "threads";
+  }
+
+  return "<not implemented!>";
+}
+
+/* ***************************************************************  */
+
+libathome_common::AsyncIO::
+AsyncIO(unsigned depth, AsyncIO::backend_t backend) noexcept(false)
+  :backend(backend), depth(depth), prepared(0), running(0), ring_fd(-1),
+   sq_ring(NULL), sq_ring_size(0), cq_ring(NULL), cq_ring_size(0),
+   sqes(NULL), sqes_size(0), sq_head(NULL), sq_tail(NULL), sq_mask(NULL),
+   sq_array(NULL), cq_head(NULL), cq_tail(NULL), cq_mask(NULL),
+   cqes(NULL), has_buffers(false), stopping(false)
+{
+  if (depth == 0) throw Err("Argument DEPTH must be greater than 0!");
+
+  if (this->backend == AsyncIO::backend_t::uring_e
+      && this->_setup_uring(depth)) {
+    return;
+  }
+
+#ifndef OSWIN
+  this->backend = AsyncIO::backend_t::threads_e;
+  this->batch.reserve(depth);
+  for (unsigned i=0; i<AsyncIO::THREADS; i++)
+    this->threads.emplace_back(&AsyncIO::_thread_main, this);
+#else /* ifndef OSWIN  */
+  throw Err("Asynchronous I/O is not supported on Windows!");
+#endif /* ifndef OSWIN  */
+}
+
+libathome_common::AsyncIO::
+~AsyncIO()
+{
+  if (this->backend == AsyncIO::backend_t::uring_e) {
+    /* The kernel may still write into the buffers  */
+    AsyncIO::completion_t drop[64];
+    try {
+      while (this->running + this->prepared > 0) this->complete(drop, 64, 1);
+    } catch (Error&) {
+    }
+
+    this->_teardown_uring();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->threads_mutex);
+    for (const request_t& request: this->batch)
+      this->requests.push_back(request);
+    this->batch.clear();
+    this->stopping = true;
+  }
+  this->request_cond.notify_all();
+
+  for (std::thread& thread: this->threads) thread.join();
+}
+
+/* ***************************************************************  */
+
+bool libathome_common::AsyncIO::
+_setup_uring(unsigned entries)
+{
+#ifdef __linux__
+  ::io_uring_params params;
+  ::memset(&params, 0, sizeof(params));
+
+  int fd = (int) ::syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0) return false;
+  this->ring_fd = fd;
+
+  /* IORING_OP_READ and IORING_OP_WRITE came with Linux 5.6, such like
+   * this feature
+   */
+  if (0 == (params.features & IORING_FEAT_RW_CUR_POS)) {
+    this->_teardown_uring();
+    return false;
+  }
+
+  this->sq_ring_size = params.sq_off.array
+    + params.sq_entries * sizeof(unsigned);
+  this->cq_ring_size = params.cq_off.cqes
+    + params.cq_entries * sizeof(::io_uring_cqe);
+  bool single = 0 != (params.features & IORING_FEAT_SINGLE_MMAP);
+  if (single) {
+    this->sq_ring_size = std::max(this->sq_ring_size, this->cq_ring_size);
+    this->cq_ring_size = this->sq_ring_size;
+  }
+
+  this->sq_ring = ::mmap(NULL, this->sq_ring_size,
+                         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_SQ_RING);
+  if (this->sq_ring == MAP_FAILED) {
+    this->sq_ring = NULL;
+    this->_teardown_uring();
+    return false;
+  }
+
+  if (single) {
+    this->cq_ring = this->sq_ring;
+  } else {
+    this->cq_ring = ::mmap(NULL, this->cq_ring_size,
+                           PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd,
+                           IORING_OFF_CQ_RING);
+    if (this->cq_ring == MAP_FAILED) {
+      this->cq_ring = NULL;
+      this->_teardown_uring();
+      return false;
+    }
+  }
+
+  this->sqes_size = params.sq_entries * sizeof(::io_uring_sqe);
+  this->sqes = ::mmap(NULL, this->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (this->sqes == MAP_FAILED) {
+    this->sqes = NULL;
+    this->_teardown_uring();
+    return false;
+  }
+
+  char* sq = (char*) this->sq_ring;
+  char* cq = (char*) this->cq_ring;
+  this->sq_head = (unsigned*) (sq + params.sq_off.head);
+  this->sq_tail = (unsigned*) (sq + params.sq_off.tail);
+  this->sq_mask = (unsigned*) (sq + params.sq_off.ring_mask);
+  this->sq_array = (unsigned*) (sq + params.sq_off.array);
+  this->cq_head = (unsigned*) (cq + params.cq_off.head);
+  this->cq_tail = (unsigned*) (cq + params.cq_off.tail);
+  this->cq_mask = (unsigned*) (cq + params.cq_off.ring_mask);
+  this->cqes = cq + params.cq_off.cqes;
+
+  /* SQ_ENTRIES is ENTRIES rounded up to a power of 2, the completion
+   * queue has twice as many.  So DEPTH operations never overflow it.
+   */
+  return true;
+#else /* ifdef __linux__  */
+  (void) entries;
+  return false;
+#endif /* ifdef __linux__  */
+}
+
+void libathome_common::AsyncIO::
+_teardown_uring()
+{
+#ifdef __linux__
+  if (this->sqes != NULL) ::munmap(this->sqes, this->sqes_size);
+  if (this->cq_ring != NULL && this->cq_ring != this->sq_ring)
+    ::munmap(this->cq_ring, this->cq_ring_size);
+  if (this->sq_ring != NULL) ::munmap(this->sq_ring, this->sq_ring_size);
+  if (this->ring_fd >= 0) ::close(this->ring_fd);
+#endif /* ifdef __linux__  */
+
+  this->sqes = NULL;
+  this->cq_ring = NULL;
+  this->sq_ring = NULL;
+  this->ring_fd = -1;
+}
+
+/* ***************************************************************  */
+
+libathome_common::AsyncIO::backend_t libathome_common::AsyncIO::
+get_backend() const
+{
+  return this->backend;
+}
+
+unsigned libathome_common::AsyncIO::
+get_free() const
+{
+  return this->depth - this->prepared - this->running;
+}
+
+void libathome_common::AsyncIO::
+register_buffers(void* const* buffers, const size_t* lengths,
+                 unsigned count) noexcept(false)
+{
+  if (this->prepared + this->running > 0)
+    throw Err("Could not register buffers, %u operations are running!",
+              this->prepared + this->running);
+
+  /* The threads use the buffers as they are  */
+  if (this->backend != AsyncIO::backend_t::uring_e) return;
+
+#ifdef __linux__
+  if (this->has_buffers) {
+    ::syscall(__NR_io_uring_register, this->ring_fd,
+              IORING_UNREGISTER_BUFFERS, NULL, 0);
+    this->has_buffers = false;
+  }
+  if (count == 0) return;
+
+  std::vector<::iovec> iov(count);
+  for (unsigned i=0; i<count; i++) {
+    iov[i].iov_base = buffers[i];
+    iov[i].iov_len = lengths[i];
+  }
+
+  if (0 > ::syscall(__NR_io_uring_register, this->ring_fd,
+                    IORING_REGISTER_BUFFERS, iov.data(), count)) {
+    int code = errno;
+    throw Err("Could not register %u buffers: %s!", count,
+              ::strerror(code));
+  }
+  this->has_buffers = true;
+#else /* ifdef __linux__  */
+  (void) buffers;
+  (void) lengths;
+#endif /* ifdef __linux__  */
+}
+
+/* ***************************************************************  */
+
+bool libathome_common::AsyncIO::
+_prepare(AsyncIO::op_t op, int fd, void* data, size_t length,
+         uint64_t offset, uint64_t tag, int buffer)
+{
+  if (this->prepared + this->running >= this->depth) return false;
+
+  if (this->backend == AsyncIO::backend_t::threads_e) {
+    this->batch.push_back({op, fd, data, length, offset, tag});
+    this->prepared++;
+    return true;
+  }
+
+#ifdef __linux__
+  /* Only this thread writes SQ_TAIL  */
+  unsigned tail = *this->sq_tail;
+  unsigned index = tail & *this->sq_mask;
+
+  ::io_uring_sqe* sqe = (::io_uring_sqe*) this->sqes + index;
+  ::memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = fd;
+  sqe->user_data = tag;
+
+  switch (op) {
+  case read_e:
+  case write_e:
+    if (buffer >= 0) {
+      sqe->opcode = op == read_e? IORING_OP_READ_FIXED: IORING_OP_WRITE_FIXED;
+      sqe->buf_index = (uint16_t) buffer;
+    } else {
+      sqe->opcode = op == read_e? IORING_OP_READ: IORING_OP_WRITE;
+    }
+    sqe->addr = (uint64_t) (uintptr_t) data;
+    /* Larger ones are just short  */
+    sqe->len = length > UINT32_MAX? UINT32_MAX: (uint32_t) length;
+    sqe->off = offset;
+    break;
+  case fsync_e:
+  case fdatasync_e:
+    sqe->opcode = IORING_OP_FSYNC;
+    if (op == fdatasync_e) sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    break;
+  }
+
+  this->sq_array[index] = index;
+  /* The kernel may read the entry after it sees the new tail  */
+  __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  this->prepared++;
+#else /* ifdef __linux__  */
+  (void) op;
+  (void) fd;
+  (void) data;
+  (void) length;
+  (void) offset;
+  (void) tag;
+  (void) buffer;
+#endif /* ifdef __linux__  */
+
+  return true;
+}
+
+bool libathome_common::AsyncIO::
+read(int fd, void* data, size_t length, uint64_t offset, uint64_t tag,
+     int buffer)
+{
+  return this->_prepare(AsyncIO::op_t::read_e, fd, data, length, offset,
+                        tag, buffer);
+}
+
+bool libathome_common::AsyncIO::
+write(int fd, const void* data, size_t length, uint64_t offset,
+      uint64_t tag, int buffer)
+{
+  return this->_prepare(AsyncIO::op_t::write_e, fd, (void*) data, length,
+                        offset, tag, buffer);
+}
+
+bool libathome_common::AsyncIO::
+fsync(int fd, uint64_t tag, bool datasync)
+{
+  return this->_prepare(datasync? AsyncIO::op_t::fdatasync_e
+                        : AsyncIO::op_t::fsync_e,
+                        fd, NULL, 0, 0, tag, -1);
+}
+
+/* ***************************************************************  */
+
+unsigned libathome_common::AsyncIO::
+submit() noexcept(false)
+{
+  unsigned result = this->prepared;
+  if (result == 0) return 0;
+
+  if (this->backend == AsyncIO::backend_t::threads_e) {
+    {
+      std::lock_guard<std::mutex> lock(this->threads_mutex);
+      for (const request_t& request: this->batch)
+        this->requests.push_back(request);
+    }
+    this->batch.clear();
+    this->request_cond.notify_all();
+
+    this->running += this->prepared;
+    this->prepared = 0;
+    return result;
+  }
+
+#ifdef __linux__
+  /* One syscall for the whole batch  */
+  long submitted;
+  do {
+    submitted = ::syscall(__NR_io_uring_enter, this->ring_fd,
+                          this->prepared, 0, 0, NULL, 0);
+  } while (submitted < 0 && errno == EINTR);
+
+  if (submitted < 0) {
+    throw Err("Could not submit %u operations: %s!", this->prepared,
+              ::strerror(errno));
+  }
+  if (submitted == 0) {
+    throw Err("Kernel accepted none of %u operations!", this->prepared);
+  }
+
+  /* On a short submission the rest stays in the submission queue,
+   * the next call starts them.
+   */
+  result = (unsigned) submitted;
+  this->prepared -= result;
+  this->running += result;
+#endif /* ifdef __linux__  */
+
+  return result;
+}
+
+size_t libathome_common::AsyncIO::
+_reap(AsyncIO::completion_t* completions, size_t max)
+{
+  size_t result = 0;
+
+  if (this->backend == AsyncIO::backend_t::threads_e) {
+    std::lock_guard<std::mutex> lock(this->threads_mutex);
+    while (result < max && !this->completions.empty()) {
+      completions[result++] = this->completions.front();
+      this->completions.pop_front();
+    }
+  } else {
+#ifdef __linux__
+    /* Completions are read from shared memory, no syscall  */
+    unsigned head = *this->cq_head;
+    unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (result < max && head != tail) {
+      const ::io_uring_cqe* cqe
+        = (const ::io_uring_cqe*) this->cqes + (head & *this->cq_mask);
+      completions[result].tag = cqe->user_data;
+      completions[result].result = cqe->res;
+      result++;
+      head++;
+    }
+
+    __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+#endif /* ifdef __linux__  */
+  }
+
+  this->running -= (unsigned) result;
+  return result;
+}
+
+size_t libathome_common::AsyncIO::
+complete(AsyncIO::completion_t* completions, size_t max, size_t wait)
+  noexcept(false)
+{
+  this->submit();
+
+  if (wait > this->running) wait = this->running;
+  if (wait > max) wait = max;
+
+  size_t result = this->_reap(completions, max);
+  while (result < wait) {
+    if (this->backend == AsyncIO::backend_t::threads_e) {
+      std::unique_lock<std::mutex> lock(this->threads_mutex);
+      this->completion_cond.wait(lock, [this]() {
+          return !this->completions.empty();
+        });
+    } else {
+#ifdef __linux__
+      if (0 > ::syscall(__NR_io_uring_enter, this->ring_fd, 0,
+                        (unsigned) (wait - result),
+                        IORING_ENTER_GETEVENTS, NULL, 0)) {
+        int code = errno;
+        if (code != EINTR)
+          throw Err("Could not wait for %lu operations: %s!",
+                    (unsigned long) (wait - result), ::strerror(code));
+      }
+#endif /* ifdef __linux__  */
+    }
+
+    result += this->_reap(completions + result, max - result);
+  }
+
+  return result;
+}
+
+/* ***************************************************************  */
+
+void libathome_common::AsyncIO::
+_thread_main()
+{
+#ifndef OSWIN
+  std::unique_lock<std::mutex> lock(this->threads_mutex);
+
+  for (;;) {
+    this->request_cond.wait(lock, [this]() {
+        return this->stopping || !this->requests.empty();
+      });
+    /* Finish all requests before stopping  */
+    if (this->requests.empty()) return;
+
+    request_t request = this->requests.front();
+    this->requests.pop_front();
+    lock.unlock();
+
+    ::ssize_t result = 0;
+    switch (request.op) {
+    case read_e:
+      result = ::pread(request.fd, request.data, request.length,
+                       (::off_t) request.offset);
+      break;
+    case write_e:
+      result = ::pwrite(request.fd, request.data, request.length,
+                        (::off_t) request.offset);
+      break;
+    case fsync_e:
+      result = ::fsync(request.fd);
+      break;
+    case fdatasync_e:
+      result = ::fdatasync(request.fd);
+      break;
+    }
+    int64_t value = result < 0? -(int64_t) errno: (int64_t) result;
+
+    lock.lock();
+    this->completions.push_back({request.tag, value});
+    this->completion_cond.notify_one();
+  }
+#endif /* ifndef OSWIN  */
+}
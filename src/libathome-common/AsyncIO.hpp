@@ -0,0 +1,290 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LIBATHOME_COMMON_ASYNCIO_H__
+#define LIBATHOME_COMMON_ASYNCIO_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::AsyncIO.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace libathome_common
+{
+
+/**
+ * Asynchronous file I/O, so no thread blocks on the disk.
+ *
+ * Operations are prepared with ::libathome_common::AsyncIO::read(),
+ * ::libathome_common::AsyncIO::write() and
+ * ::libathome_common::AsyncIO::fsync(), then passed to the kernel
+ * together by ::libathome_common::AsyncIO::submit().  Their results
+ * are fetched by ::libathome_common::AsyncIO::complete(), in the
+ * order they finished, identified by a user-defined tag.
+ *
+ * On Linux it uses `io_uring` by raw syscalls, so one syscall submits
+ * a whole batch and completions are read from shared memory without
+ * any syscall.  If `io_uring` is not available (old kernel, seccomp),
+ * then a few own threads do blocking `pread()`, `pwrite()` and
+ * `fsync()`.  They are not the workers of
+ * ::libathome_common::ThreadPool, which must not block on I/O.
+ *
+ * An instance is NOT thread-safe, use one per thread.
+ *
+ * **Example**
+ * ```cpp
+ * AsyncIO io(32);
+ *
+ * for (uint64_t i=0; i<32; i++)
+ *   io.read(fd, buffers[i], 4096, i * 4096, i);
+ * io.submit();
+ *
+ * AsyncIO::completion_t done[32];
+ * size_t n = io.complete(done, 32, 32);
+ * ```
+ */
+class AsyncIO
+{
+public:
+
+  /**
+   * The implementation which does the I/O.
+   */
+  typedef enum {
+    uring_e = 0,    ///< Linux `io_uring`
+    threads_e = 1   ///< Blocking syscalls on own threads
+  } backend_t;
+
+  /**
+   * Convert a ::libathome_common::AsyncIO::backend_t to string.
+   *
+   * @param backend The backend to convert
+   * @return The string which names the backend. `static` allocated,
+   *         need NOT to be `free()`d.
+   */
+  static const char* to_string(AsyncIO::backend_t backend);
+
+  /**
+   * A finished operation.
+   */
+  typedef struct {
+    /** The `tag` which was passed on preparing  */
+    uint64_t tag;
+    /** Transferred bytes, `0` for `fsync()`, or `-errno` on error.
+     * Reads and writes may be short, such like `pread()`.  */
+    int64_t result;
+  } completion_t;
+
+  /**
+   * Number of threads of ::libathome_common::AsyncIO::threads_e.
+   */
+  static const unsigned THREADS = 4;
+
+  /**
+   * Constructs the engine.
+   *
+   * @param depth Maximum number of prepared and running operations,
+   *              greater than `0`
+   * @param backend ::libathome_common::AsyncIO::threads_e to not try
+   *                `io_uring`
+   * @exception ::libathome_common::Error will be thrown if no backend
+   *            could be set up
+   */
+  explicit AsyncIO(unsigned depth = 64,
+    AsyncIO::backend_t backend = AsyncIO::backend_t::uring_e)
+    noexcept(false);
+  /**
+   * Waits for all running operations, their results are dropped.
+   */
+  virtual ~AsyncIO();
+
+  /**
+   * Returns the backend which is used.
+   *
+   * @return ::libathome_common::AsyncIO::threads_e if `io_uring` is not
+   *         available
+   */
+  virtual AsyncIO::backend_t get_backend() const;
+  /**
+   * Returns the number of operations which may be prepared now.
+   *
+   * @return `depth` minus the prepared and running operations
+   */
+  virtual unsigned get_free() const;
+
+  /**
+   * Registers buffers in the kernel, so it doesn't need to map them
+   * for every operation.
+   *
+   * Replaces the buffers of the last call.  Pass their index as
+   * `buffer` to ::libathome_common::AsyncIO::read() and
+   * ::libathome_common::AsyncIO::write().  No operation may be
+   * running.
+   *
+   * @param buffers Start addresses of the buffers
+   * @param lengths Lengths of the buffers
+   * @param count Number of buffers, `0` to unregister
+   * @exception ::libathome_common::Error will be thrown if operations
+   *            are running or the kernel refused them, such like by
+   *            `RLIMIT_MEMLOCK`
+   */
+  virtual void register_buffers(void* const* buffers,
+    const size_t* lengths, unsigned count) noexcept(false);
+
+  /**
+   * Prepares reading, like `pread()`.
+   *
+   * @param fd Opened file descriptor
+   * @param data Output buffer, must stay valid until completed
+   * @param length Number of bytes to read
+   * @param offset Position in the file
+   * @param tag Returned with the completion
+   * @param buffer Index of the registered buffer which contains
+   *               `data`, `-1` for none
+   * @return `false` if there are already `depth` operations, then
+   *         fetch completions first
+   */
+  virtual bool read(int fd, void* data, size_t length, uint64_t offset,
+    uint64_t tag, int buffer = -1);
+  /**
+   * Prepares writing, like `pwrite()`.
+   *
+   * @param fd Opened file descriptor
+   * @param data The bytes to write, must stay valid until completed
+   * @param length Number of bytes to write
+   * @param offset Position in the file
+   * @param tag Returned with the completion
+   * @param buffer Index of the registered buffer which contains
+   *               `data`, `-1` for none
+   * @return `false` if there are already `depth` operations
+   */
+  virtual bool write(int fd, const void* data, size_t length,
+    uint64_t offset, uint64_t tag, int buffer = -1);
+  /**
+   * Prepares flushing a file to the disk, like `fsync()`.
+   *
+   * It is not ordered with other operations, prepare it after the
+   * writes were completed.
+   *
+   * @param fd Opened file descriptor
+   * @param tag Returned with the completion
+   * @param datasync `true` for `fdatasync()`
+   * @return `false` if there are already `depth` operations
+   */
+  virtual bool fsync(int fd, uint64_t tag, bool datasync = false);
+
+  /**
+   * Starts all prepared operations.
+   *
+   * The kernel may start less than prepared, then the others stay
+   * prepared and will be started by the next call.
+   *
+   * @return Number of started operations
+   * @exception ::libathome_common::Error will be thrown if the kernel
+   *            refused them or started none of them
+   */
+  virtual unsigned submit() noexcept(false);
+  /**
+   * Fetches results of finished operations.
+   *
+   * Prepared operations will be submitted before.
+   *
+   * @param completions Output, at most `max` will be written
+   * @param max Size of `completions`
+   * @param wait Blocks until at least this many are finished, at most
+   *             the number of running operations
+   * @return Number of written `completions`
+   * @exception ::libathome_common::Error will be thrown if waiting has
+   *            failed
+   */
+  virtual size_t complete(AsyncIO::completion_t* completions, size_t max,
+    size_t wait = 0) noexcept(false);
+
+private:
+  typedef enum {
+    read_e = 0, write_e, fsync_e, fdatasync_e
+  } op_t;
+
+  /** Operation of ::libathome_common::AsyncIO::threads_e  */
+  typedef struct {
+    op_t op;
+    int fd;
+    void* data;
+    size_t length;
+    uint64_t offset;
+    uint64_t tag;
+  } request_t;
+
+  AsyncIO::backend_t backend;
+  unsigned depth;
+  /** Prepared, not yet submitted  */
+  unsigned prepared;
+  /** Submitted, not yet fetched  */
+  unsigned running;
+
+  /* io_uring, see `man 7 io_uring`  */
+  int ring_fd;
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  void* sqes;
+  size_t sqes_size;
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  void* cqes;
+  bool has_buffers;
+
+  /* Threads  */
+  std::vector<std::thread> threads;
+  std::mutex threads_mutex;
+  /** Woken on new requests or stop  */
+  std::condition_variable request_cond;
+  /** Woken on new completions  */
+  std::condition_variable completion_cond;
+  bool stopping;
+  std::vector<request_t> batch;
+  std::deque<request_t> requests;
+  std::deque<completion_t> completions;
+
+  bool _setup_uring(unsigned entries);
+  void _teardown_uring();
+  bool _prepare(AsyncIO::op_t op, int fd, void* data, size_t length,
+    uint64_t offset, uint64_t tag, int buffer);
+  size_t _reap(AsyncIO::completion_t* completions, size_t max);
+  void _thread_main();
+
+  AsyncIO(const AsyncIO&) = delete;
+  AsyncIO& operator=(const AsyncIO&) = delete;
+
+}; /* class AsyncIO  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_ASYNCIO_H__  */
@@ -18,6 +18,12 @@
 
 #include "libathome-common/Common.hpp"
 #include "libathome-common/Logger.hpp"
+#include "libathome-common/CrashHandler.hpp"
+#include "libathome-common/Metrics.hpp"
+#include "libathome-common/Tracer.hpp"
+#include "libathome-common/ThreadPool.hpp"
+
+#include <cstdlib>
 
 
 libathome_common::Common*
@@ -43,14 +49,68 @@ Common(int argc, char** argv)
   libathome_common::Log = new Logger(
     Logger::loglevel_t::info_e, RealtimeClock::timezone_t::local_e,
     "log", "%Y-%m-%d.log", 365);
+  libathome_common::Log->async_start(4096, LogRingbuffer::drop_oldest_e);
 #else /* ifndef DEBUG  */
   libathome_common::Log = new Logger(
     Logger::loglevel_t::all_e, RealtimeClock::timezone_t::local_e);
 #endif /* ifndef DEBUG  */
 
+  try {
+    this->crash_handler = new CrashHandler("log", "crash.txt");
+
+    if (!this->crash_handler->get_previous().empty()) {
+      Log->error("Previous run crashed!\n%s",
+                 this->crash_handler->get_previous().c_str());
+    }
+  } catch (Error& e) {
+    /* Run without crash reports  */
+    this->crash_handler = NULL;
+    Log->error(e);
+  }
+
+#ifdef TRACE
+  /* Cheapest timestamps for the spans  */
+  if (!MonotonicClock::enable_tsc())
+    Log->warn("Tracing without TSC, spans are more expensive");
+#endif /* ifdef TRACE  */
+
+  this->metrics = new Metrics("log", "metrics.prom");
+#ifndef DEBUG
+  this->metrics->start(60);
+#endif /* ifndef DEBUG  */
+
+  /* Options of the thread pool, others are left to the project  */
+  unsigned threads = 0;
+  std::vector<unsigned> cpus;
+  for (int i=1; i<argc; i++) {
+    if (0 == ::strncmp(argv[i], "--threads=", 10)) {
+      char* end;
+      unsigned long value = ::strtoul(argv[i] + 10, &end, 10);
+      if (*end != '\0' || end == argv[i] + 10 || value > 4096)
+        Log->error("Ignoring invalid option '%s'", argv[i]);
+      else
+        threads = (unsigned) value;
+    } else if (0 == ::strncmp(argv[i], "--cpus=", 7)) {
+      try {
+        cpus = ThreadPool::parse_cpus(argv[i] + 7);
+      } catch (Error& e) {
+        Log->error(e);
+      }
+    }
+  }
+
+  try {
+    this->pool = new ThreadPool(threads, cpus);
+  } catch (Error& e) {
+    /* Pinning may be denied, run unpinned then  */
+    if (cpus.empty()) throw;
+    Log->error(e);
+    this->pool = new ThreadPool(threads);
+  }
+  LogInfo("Thread pool with %u workers started",
+          this->pool->get_threads());
+
   this->hello = new std::string("Hello World!");
-  /* Prevent unsued warning for now  */
-  if (argc || argv) {};
 
   try {
     File x(NULL, "<nullstream>");
@@ -58,7 +118,7 @@ Common(int argc, char** argv)
     Log->error(e);
   }
 
-  Log->debug("%s", this->hello->c_str());
+  LogDebug("%s", this->hello->c_str());
   Log->warn(*this->hello);
   Log->error("Hello %s, how are you (%d)?", "World", -999);
   //Log->fatal(3, this->hello->c_str());
@@ -69,7 +129,37 @@ libathome_common::Common::
 {
   delete this->hello;
 
+  /* Runs the queued tasks, they may log and record metrics  */
+  delete this->pool;
+
+#ifdef TRACE
+  try {
+    size_t events = Tracer::dump("log", "trace.json");
+    Log->info("Trace with %lu events written to 'log/trace.json'",
+              (unsigned long) events);
+  } catch (Error& e) {
+    Log->error(e);
+  }
+#endif /* ifdef TRACE  */
+
+  /* Writes the last snapshot, needs LOG  */
+  delete this->metrics;
+
+  delete this->crash_handler;
+
   delete libathome_common::Log;
 
   Common::instance = NULL;
 }
+
+libathome_common::Metrics* libathome_common::Common::
+get_metrics() const
+{
+  return this->metrics;
+}
+
+libathome_common::ThreadPool* libathome_common::Common::
+get_pool() const
+{
+  return this->pool;
+}
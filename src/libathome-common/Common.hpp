@@ -127,6 +127,10 @@ const unsigned STRING_LEN          = 256;
  */
 typedef char                       string_t[STRING_LEN];
 
+class CrashHandler;
+class Metrics;
+class ThreadPool;
+
 /**
  * Abstract singleton initialisator class, needed for everything :P
  *
@@ -136,6 +140,10 @@ typedef char                       string_t[STRING_LEN];
  * ::libathome_common::Common::get() static method to get the
  * singleton instance from anywhere in your program.  Also implicitly
  * includes STL stuff, stdlibs, etc ...
+ *
+ * It installs a ::libathome_common::CrashHandler, which writes crash
+ * reports to `"log/crash.txt"`.  They will be logged as error on the
+ * next start.
  */
 class Common
 {
@@ -154,6 +162,15 @@ public:
    *
    * See ::libathome_common::Common for more details.
    *
+   * Understands the following options in `argv`, others will be
+   * ignored:
+   *
+   * - `--threads=N`: Number of workers of
+   *   ::libathome_common::Common::get_pool(), default is one per
+   *   hardware thread
+   * - `--cpus=LIST`: Pin the workers to the CPUs in `LIST`, such like
+   *   `0,2,4-7`, see ::libathome_common::ThreadPool::parse_cpus()
+   *
    * @param argc Pass the first parameter of `int main(int argc, char**
    *             argv)` here
    * @param argv Pass the second parameter of `int main(int argc, char**
@@ -168,6 +185,26 @@ public:
    */
   virtual ~Common();
 
+  /**
+   * Registry of the metrics of this process.
+   *
+   * In release builds a snapshot will be written every minute to
+   * `"log/metrics.prom"` and logged.
+   *
+   * @return The registry, valid as long as this instance lives
+   */
+  virtual Metrics* get_metrics() const;
+  /**
+   * Work-stealing pool for the calculations of this process.
+   *
+   * Its size is set by the command-line options of `argv`, see
+   * ::libathome_common::Common::Common().  Queued tasks will be run
+   * before this instance is destructed.
+   *
+   * @return The pool, valid as long as this instance lives
+   */
+  virtual ThreadPool* get_pool() const;
+
 private:
   virtual void _abstract_class() = 0;
 
@@ -175,6 +212,13 @@ private:
 
   std::string* hello;
 
+  /** `NULL` if it could not be installed  */
+  CrashHandler* crash_handler;
+
+  Metrics* metrics;
+
+  ThreadPool* pool;
+
 }; /* class Common  */
 
 } /* namespace libathome_common  */
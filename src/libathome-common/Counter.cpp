@@ -0,0 +1,48 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-common/Counter.hpp"
+
+
+std::atomic<unsigned> libathome_common::Counter::_shard_next(0);
+
+/* ***************************************************************  */
+
+libathome_common::Counter::
+Counter()
+{
+  for (unsigned i=0; i<Counter::SHARDS; i++)
+    this->shards[i].value.store(0, std::memory_order_relaxed);
+}
+
+libathome_common::Counter::
+~Counter()
+{
+}
+
+uint64_t libathome_common::Counter::
+get() const
+{
+  uint64_t result = 0;
+
+  for (unsigned i=0; i<Counter::SHARDS; i++)
+    result += this->shards[i].value.load(std::memory_order_relaxed);
+
+  return result;
+}
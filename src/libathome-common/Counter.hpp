@@ -0,0 +1,112 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_COUNTER_H__
+#define LIBATHOME_COMMON_COUNTER_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::Counter.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <atomic>
+#include <climits>
+
+namespace libathome_common
+{
+
+/**
+ * Monotonically increasing counter metric, such like finished tasks.
+ *
+ * The count is spread over ::libathome_common::Counter::SHARDS cache
+ * lines.  Every thread increments its own shard, so threads don't
+ * contend with each other.  ::libathome_common::Counter::get() sums
+ * up all shards.
+ *
+ * Usually created by ::libathome_common::Metrics::counter().
+ */
+class Counter
+{
+public:
+  /**
+   * Number of shards, threads are assigned round-robin.
+   */
+  static const unsigned SHARDS = 16;
+
+  /**
+   * Constructs a counter, starting at `0`.
+   */
+  explicit Counter();
+  /**
+   * Default destructor.
+   */
+  virtual ~Counter();
+
+  /**
+   * Increments the counter.
+   *
+   * Thread-safe, lock-free and does not allocate.  Not `virtual`, to
+   * be inlined in hot paths.
+   *
+   * @param value Increment
+   */
+  void add(uint64_t value = 1)
+  {
+    this->shards[Counter::_shard()].value.fetch_add(
+      value, std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the current count.
+   *
+   * @return Sum of all shards
+   */
+  virtual uint64_t get() const;
+
+private:
+  /** One cache line per shard, against false sharing  */
+  typedef struct {
+    std::atomic<uint64_t> value;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  } shard_t;
+
+  shard_t shards[SHARDS];
+
+  static std::atomic<unsigned> _shard_next;
+
+  static unsigned _shard()
+  {
+    /* Constant initialized, so no guard variable  */
+    static thread_local unsigned shard = UINT_MAX;
+    if (shard == UINT_MAX) {
+      shard = Counter::_shard_next.fetch_add(1, std::memory_order_relaxed)
+        % Counter::SHARDS;
+    }
+
+    return shard;
+  }
+
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+
+}; /* class Counter  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_COUNTER_H__  */
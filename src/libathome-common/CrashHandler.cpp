@@ -0,0 +1,417 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-common/CrashHandler.hpp"
+#include "libathome-common/Error.hpp"
+#include "libathome-common/Filesystem.hpp"
+#include "libathome-common/RealtimeClock.hpp"
+
+#include <vector>
+#include <cerrno>
+#include <cinttypes>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+#ifndef OSWIN
+const int libathome_common::CrashHandler::
+_SIGNALS[CrashHandler::_SIGNALS_SIZE] = {
+  SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT
+};
+#endif /* ifndef OSWIN  */
+
+std::atomic<int> libathome_common::CrashHandler::_fd(-1);
+std::atomic<bool> libathome_common::CrashHandler::_crashing(false);
+
+/* Lines of the raw crash report  */
+#define CRASHHANDLER_BEGIN         "--- libathome crash ---"
+#define CRASHHANDLER_END           "--- end ---"
+
+/* ---------------------------------------------------------------  */
+
+void libathome_common::CrashHandler::
+_write(int fd, const char* data, size_t length)
+{
+  while (length > 0) {
+    ssize_t written = ::write(fd, data, length);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return;
+
+    data += written;
+    length -= written;
+  }
+}
+
+void libathome_common::CrashHandler::
+_write_str(int fd, const char* str)
+{
+  CrashHandler::_write(fd, str, ::strlen(str));
+}
+
+void libathome_common::CrashHandler::
+_write_num(int fd, uint64_t value, unsigned base)
+{
+  char buf[24];
+  char* pos = buf + sizeof(buf);
+
+  do {
+    *--pos = "0123456789abcdef"[value % base];
+    value /= base;
+  } while (value > 0);
+
+  if (base == 16) {
+    *--pos = 'x';
+    *--pos = '0';
+  }
+
+  CrashHandler::_write(fd, pos, buf + sizeof(buf) - pos);
+}
+
+#ifndef OSWIN
+void libathome_common::CrashHandler::
+_handler(int signum, ::siginfo_t* info, void* context)
+{
+  /* Async-signal-safe only from here!  No malloc(), no locks, no
+   * printf(), no exceptions.
+   */
+  (void) context;
+
+  if (CrashHandler::_crashing.exchange(true)) {
+    /* Another thread is writing its report, it will terminate the
+     * process
+     */
+    for (;;) ::pause();
+  }
+
+  int fd = CrashHandler::_fd.load();
+  if (fd >= 0) {
+    ::timespec now;
+    if (0 != ::clock_gettime(CLOCK_REALTIME, &now)) now.tv_sec = 0;
+
+    CrashHandler::_write_str(fd, CRASHHANDLER_BEGIN "\nsignal ");
+    CrashHandler::_write_num(fd, signum, 10);
+    if (info->si_code > 0) {
+      /* Sent by the kernel, not by kill() or abort()  */
+      CrashHandler::_write_str(fd, "\naddress ");
+      CrashHandler::_write_num(fd, (uintptr_t) info->si_addr, 16);
+    }
+    CrashHandler::_write_str(fd, "\ntime ");
+    CrashHandler::_write_num(fd, now.tv_sec, 10);
+    CrashHandler::_write_str(fd, "\n");
+
+    void* frames[CrashHandler::_FRAMES_MAX];
+    int size = Error::_backtrace(frames, CrashHandler::_FRAMES_MAX);
+    for (int i=CrashHandler::_FRAMES_OFFSET; i<size; i++) {
+      CrashHandler::_write_str(fd, "frame ");
+      CrashHandler::_write_num(fd, (uintptr_t) frames[i], 16);
+      CrashHandler::_write_str(fd, "\n");
+    }
+
+    /* Needed to resolve the addresses offline, the load addresses
+     * will differ in the next run
+     */
+    CrashHandler::_write_str(fd, "maps\n");
+    int maps = ::open("/proc/self/maps", O_RDONLY);
+    if (maps >= 0) {
+      char buf[4096];
+      ssize_t length;
+      while (0 < (length = ::read(maps, buf, sizeof(buf))))
+        CrashHandler::_write(fd, buf, length);
+      ::close(maps);
+    }
+
+    CrashHandler::_write_str(fd, CRASHHANDLER_END "\n");
+    ::fsync(fd);
+  }
+
+  /* Die with the default action, i.e. core dump  */
+  ::signal(signum, SIG_DFL);
+  ::raise(signum);
+}
+#endif /* ifndef OSWIN  */
+
+/* ***************************************************************  */
+
+libathome_common::CrashHandler::
+CrashHandler(const std::string& path, const std::string& filename)
+  noexcept(false)
+{
+#ifndef OSWIN
+  if (CrashHandler::_fd.load() >= 0)
+    throw Err("An instance of CrashHandler does already exist!");
+
+  Filesystem::mkdir_p(path);
+  std::string filename_full = path + Filesystem::PATH_SEPERATOR + filename;
+
+  /* Resolve the reports of the previous run, before truncating  */
+  ::FILE* in = ::fopen(filename_full.c_str(), "rb");
+  if (in != NULL) {
+    std::string raw;
+    char buf[4096];
+    size_t length;
+    while (0 < (length = ::fread(buf, 1, sizeof(buf), in)))
+      raw.append(buf, length);
+    ::fclose(in);
+
+    this->previous = CrashHandler::symbolize(raw);
+  } else if (errno != ENOENT) {
+    throw Err("Could not read file '%s': %s!", filename_full.c_str(),
+              ::strerror(errno));
+  }
+
+  int fd = ::open(filename_full.c_str(),
+                  O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd < 0) {
+    throw Err("Could not open file '%s': %s!", filename_full.c_str(),
+              ::strerror(errno));
+  }
+
+  /* BACKTRACE() loads its unwinder on the first call, which
+   * allocates.  Do it now instead of in the handler.
+   */
+  void* frame;
+  Error::_backtrace(&frame, 1);
+  CrashHandler::prepare_thread();
+
+  CrashHandler::_crashing.store(false);
+  CrashHandler::_fd.store(fd);
+
+  struct ::sigaction action;
+  ::memset(&action, 0, sizeof(action));
+  action.sa_sigaction = CrashHandler::_handler;
+  ::sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+
+  for (int i=0; i<CrashHandler::_SIGNALS_SIZE; i++) {
+    ::sigaction(
+      CrashHandler::_SIGNALS[i], &action, &this->previous_actions[i]);
+  }
+#else /* ifndef OSWIN  */
+  (void) path;
+  (void) filename;
+#endif /* ifndef OSWIN  */
+}
+
+libathome_common::CrashHandler::
+~CrashHandler()
+{
+#ifndef OSWIN
+  for (int i=0; i<CrashHandler::_SIGNALS_SIZE; i++) {
+    ::sigaction(
+      CrashHandler::_SIGNALS[i], &this->previous_actions[i], NULL);
+  }
+
+  int fd = CrashHandler::_fd.exchange(-1);
+  if (fd >= 0) ::close(fd);
+#endif /* ifndef OSWIN  */
+}
+
+/* ***************************************************************  */
+
+const std::string& libathome_common::CrashHandler::
+get_previous() const
+{
+  return this->previous;
+}
+
+void libathome_common::CrashHandler::
+prepare_thread()
+{
+#ifndef OSWIN
+  /* Frees the stack on thread exit  */
+  struct altstack_t {
+    char* memory;
+
+    altstack_t(): memory(NULL)
+    {
+      /* Keep a big enough stack of someone else, i.e. sanitizers  */
+      ::stack_t current;
+      if (0 == ::sigaltstack(NULL, &current)
+          && !(current.ss_flags & SS_DISABLE)
+          && current.ss_size >= CrashHandler::_ALTSTACK_SIZE)
+        return;
+
+      this->memory = new char[CrashHandler::_ALTSTACK_SIZE];
+
+      ::stack_t stack;
+      stack.ss_sp = this->memory;
+      stack.ss_size = CrashHandler::_ALTSTACK_SIZE;
+      stack.ss_flags = 0;
+      if (0 != ::sigaltstack(&stack, NULL)) {
+        delete[] this->memory;
+        this->memory = NULL;
+      }
+    }
+
+    ~altstack_t()
+    {
+      if (this->memory == NULL) return;
+
+      ::stack_t stack;
+      ::memset(&stack, 0, sizeof(stack));
+      stack.ss_flags = SS_DISABLE;
+      ::sigaltstack(&stack, NULL);
+
+      delete[] this->memory;
+    }
+  };
+
+  static thread_local altstack_t altstack;
+  (void) altstack;
+#endif /* ifndef OSWIN  */
+}
+
+std::string libathome_common::CrashHandler::
+symbolize(const std::string& raw)
+{
+  typedef struct {
+    uint64_t begin;
+    uint64_t end;
+    uint64_t offset;
+    std::string path;
+  } mapping_t;
+
+  /* Parses one line of `/proc/PID/maps`  */
+  struct parser_t {
+    static bool mapping(const char* line, mapping_t& result)
+    {
+      int path_pos = -1;
+      if (3 > ::sscanf(line, "%" SCNx64 "-%" SCNx64 " %*s %" SCNx64
+                       " %*s %*s %n", &result.begin, &result.end,
+                       &result.offset, &path_pos)
+          || path_pos < 0)
+        return false;
+
+      result.path = line + path_pos;
+      while (!result.path.empty() && ::isspace(result.path.back()))
+        result.path.pop_back();
+      return true;
+    }
+  };
+
+  /* The mappings of this process  */
+  std::vector<mapping_t> current;
+  ::FILE* maps = ::fopen("/proc/self/maps", "r");
+  if (maps != NULL) {
+    char line[4096];
+    mapping_t mapping;
+    while (NULL != ::fgets(line, sizeof(line), maps)) {
+      if (parser_t::mapping(line, mapping)) current.push_back(mapping);
+    }
+    ::fclose(maps);
+  }
+
+  std::string result;
+  string_t buf;
+
+  int signum = 0;
+  bool has_address = false;
+  uint64_t address = 0;
+  ::time_t time = 0;
+  std::vector<uint64_t> frames;
+  std::vector<mapping_t> crashed;
+  bool in_maps = false;
+
+  size_t pos = 0;
+  while (pos < raw.length()) {
+    size_t eol = raw.find('\n', pos);
+    if (eol == std::string::npos) eol = raw.length();
+    std::string line = raw.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    if (line == CRASHHANDLER_BEGIN) {
+      signum = 0; has_address = false; address = 0; time = 0;
+      frames.clear(); crashed.clear();
+      in_maps = false;
+    } else if (line == "maps") {
+      in_maps = true;
+    } else if (in_maps && line != CRASHHANDLER_END) {
+      mapping_t mapping;
+      if (parser_t::mapping(line.c_str(), mapping))
+        crashed.push_back(mapping);
+    } else if (line.compare(0, 7, "signal ") == 0) {
+      signum = ::atoi(line.c_str() + 7);
+    } else if (line.compare(0, 8, "address ") == 0) {
+      has_address = true;
+      address = ::strtoull(line.c_str() + 8, NULL, 16);
+    } else if (line.compare(0, 5, "time ") == 0) {
+      time = (::time_t) ::strtoll(line.c_str() + 5, NULL, 10);
+    } else if (line.compare(0, 6, "frame ") == 0) {
+      frames.push_back(::strtoull(line.c_str() + 6, NULL, 16));
+    } else if (line == CRASHHANDLER_END) {
+      /* Render it, like Error::bt()  */
+      Result<RealtimeClock> rtc = RealtimeClock::from_timestamp(
+        RealtimeClock::local_e, time, 0, std::nothrow);
+      Result<std::string> time_str = rtc
+        ? rtc.get().to_string("%Y-%m-%d %H:%M:%S", std::nothrow)
+        : Result<std::string>(rtc.get_status());
+
+      ::snprintf(buf, STRING_LEN, "*(CRASH)* Signal %d (%s)",
+                 signum, ::strsignal(signum));
+      result += buf;
+      if (has_address) {
+        ::snprintf(buf, STRING_LEN, " at address 0x%" PRIx64, address);
+        result += buf;
+      }
+      result += ", " + time_str.get_or("<unknown time>");
+      result += "\n\nbacktrace:";
+
+      for (uint64_t frame: frames) {
+        const mapping_t* from = NULL;
+        for (const mapping_t& mapping: crashed) {
+          if (mapping.begin <= frame && frame < mapping.end) {
+            from = &mapping;
+            break;
+          }
+        }
+
+        if (from == NULL || from->path.empty() || from->path[0] == '[') {
+          ::snprintf(buf, STRING_LEN, "\n  [0x%" PRIx64 "]", frame);
+          result += buf;
+          continue;
+        }
+
+        /* Same file offset in the same binary of this process  */
+        uint64_t offset = frame - from->begin + from->offset;
+        const mapping_t* to = NULL;
+        for (const mapping_t& mapping: current) {
+          if (mapping.path == from->path && mapping.offset <= offset
+              && offset < mapping.offset + mapping.end - mapping.begin) {
+            to = &mapping;
+            break;
+          }
+        }
+
+        if (to == NULL) {
+          ::snprintf(buf, STRING_LEN, "\n  %s+0x%" PRIx64 " [0x%" PRIx64 "]",
+            from->path.c_str(), offset, frame);
+        } else {
+          ::snprintf(buf, STRING_LEN, "\n  %s", Error::_symbol(
+            (void*) (uintptr_t) (to->begin + offset - to->offset)));
+        }
+        result += buf;
+      } /* for (uint64_t frame: frames)  */
+
+      result += "\n";
+      in_maps = false;
+    }
+  } /* while (pos < raw.length())  */
+
+  return result;
+}
@@ -0,0 +1,147 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_CRASHHANDLER_H__
+#define LIBATHOME_COMMON_CRASHHANDLER_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::CrashHandler.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <atomic>
+#include <csignal>
+
+namespace libathome_common
+{
+
+/**
+ * Writes a backtrace if the process crashes, such like on `SIGSEGV`.
+ *
+ * Installed by ::libathome_common::Common::Common().  On a fatal
+ * signal (`SIGSEGV`, `SIGBUS`, `SIGFPE`, `SIGILL` and `SIGABRT`) the
+ * handler writes the signal, the raw addresses of the backtrace
+ * (same unwinding as ::libathome_common::Error) and
+ * `/proc/self/maps` to a file which was opened on construction.
+ * Afterwards the signal will be raised again with its default
+ * action, so core dumps still work.
+ *
+ * The handler uses async-signal-safe system calls only.  It does not
+ * allocate and does not lock, so it works even if the heap or a
+ * mutex is broken.  It runs on an alternate signal stack, so stack
+ * overflows can be reported too.  The stack of the constructing
+ * thread is prepared automatically, other threads need to call
+ * ::libathome_common::CrashHandler::prepare_thread().
+ *
+ * The raw addresses will be resolved **offline** to symbols, on the
+ * next start of the process with the same binaries, see
+ * ::libathome_common::CrashHandler::get_previous().
+ *
+ * Only one instance per process may exist.  Does nothing on systems
+ * without POSIX signals, such like Windows.
+ */
+class CrashHandler
+{
+public:
+  /**
+   * Resolves the crash reports of the previous run, opens the file
+   * for the next one and installs the signal handlers.
+   *
+   * @param path Directory of the crash report file, will be created
+   *             if not exist
+   * @param filename Filename of the crash report file
+   * @exception ::libathome_common::Error will be thrown if another
+   *            instance already exists, or if the file could not be
+   *            read or opened
+   */
+  explicit CrashHandler(const std::string& path,
+    const std::string& filename) noexcept(false);
+  /**
+   * Restores the previous signal handlers and closes the file.
+   */
+  virtual ~CrashHandler();
+
+  /**
+   * Returns the crash reports of the previous run.
+   *
+   * Every report looks like the ::libathome_common::Error::what()
+   * message of ::libathome_common::Error::bt().
+   *
+   * @return The resolved crash reports, `""` if the previous run did
+   *         not crash
+   */
+  virtual const std::string& get_previous() const;
+
+  /**
+   * Prepares the alternate signal stack of the calling thread.
+   *
+   * Without it, the crash handler can't report stack overflows in
+   * this thread.  Call it at the start of every long-living thread.
+   * The stack will be freed when the thread exits.  Multiple calls
+   * will be ignored.
+   */
+  static void prepare_thread();
+
+  /**
+   * Resolves the symbols of raw crash reports.
+   *
+   * The binaries must be the same as the ones of the crashed
+   * process.  Their load addresses may differ.  Frames of binaries
+   * which are not loaded into this process will be rendered as
+   * `"path+0xoffset"`.
+   *
+   * @param raw Content of a crash report file
+   * @return The resolved crash reports
+   */
+  static std::string symbolize(const std::string& raw);
+
+private:
+  static const int _SIGNALS[];
+  static const int _SIGNALS_SIZE = 5;
+  static const int _FRAMES_MAX = 64;
+  /**
+   * The first 2 frames are Error::_backtrace() and
+   * CrashHandler::_handler(), which we don´t want to see.
+   */
+  static const int _FRAMES_OFFSET = 2;
+  static const size_t _ALTSTACK_SIZE = 64*1024;
+
+  /** File descriptor of the report file, `-1` if not installed  */
+  static std::atomic<int> _fd;
+  /** Set by the first crashing thread  */
+  static std::atomic<bool> _crashing;
+
+  std::string previous;
+
+#ifndef OSWIN
+  struct ::sigaction previous_actions[_SIGNALS_SIZE];
+
+  static void _handler(int signum, ::siginfo_t* info, void* context);
+#endif /* ifndef OSWIN  */
+
+  /* Async-signal-safe output, no `printf()`  */
+  static void _write(int fd, const char* data, size_t length);
+  static void _write_str(int fd, const char* str);
+  static void _write_num(int fd, uint64_t value, unsigned base);
+
+}; /* class CrashHandler  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_CRASHHANDLER_H__  */
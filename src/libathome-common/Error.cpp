@@ -18,6 +18,8 @@
 
 #include "libathome-common/Error.hpp"
 
+#include <cctype>
+
 #if defined __GNUC__ && !defined OSWIN
 #  /* For backtrace stuff, GNU extension && Linux  */
 #  include <execinfo.h>
@@ -30,11 +32,80 @@
 #endif /* ifdef __GNUC__  */
 
 
-const std::regex libathome_common::Error::
-REGEX_FUNCNAME("^(.* )?([^ (]*)\\(.*$");
+const char* libathome_common::Error::
+_funcname(const char* pretty_func, size_t& length)
+{
+  /* Hand-written instead of std::regex, which is slow and allocates
+   * on every match.  Works for `__PRETTY_FUNCTION__` and
+   * `__FUNCSIG__`, like
+   *
+   *   std::map<int, int> ns::Class<T>::method(int) const [with T = int]
+   *
+   * The name ends at the first '(' outside of brackets and begins
+   * after the last space before it, outside of brackets.
+   */
+  const char* begin = pretty_func;
+  int depth = 0;
+
+  for (const char* pos = pretty_func; *pos != '\0'; pos++) {
+    if (0 == ::strncmp(pos, "operator", 8)
+        && (pos == pretty_func || pos[-1] == ':' || pos[-1] == ' ')) {
+      /* Skip the symbol, so `operator<()`, `operator()()` or
+       * `operator new()` don't confuse the bracket counting
+       */
+      pos += 8;
+      if (pos[0] == '(' && pos[1] == ')') {
+        pos += 2;
+      } else if (pos[0] == ' ') {
+        pos++;
+        while (::isalnum(*pos) || *pos == '_' || *pos == '[' || *pos == ']')
+          pos++;
+      } else {
+        while (*pos != '\0' && ::strchr("<>=!+-*/%^&|~[],", *pos))
+          pos++;
+      }
+      if (*pos == '\0') break;
+    }
+
+    switch (*pos) {
+    case '(':
+      if (depth == 0 && begin < pos) {
+        length = pos - begin;
+        return begin;
+      } else if (depth == 0) {
+        /* Returns a function pointer, `void (* ns::func(int))(int)`  */
+        begin = pos + 1;
+        break;
+      }
+      depth++;
+      break;
+    case '<': case '[':
+      depth++;
+      break;
+    case '>': case ')': case ']':
+      if (depth > 0) depth--;
+      break;
+    case ' ':
+      if (depth == 0) begin = pos + 1;
+      break;
+    }
+  }
 
-const std::regex libathome_common::Error::
-REGEX_LIBNAME("^(.*[/\\\\])?([^/\\\\].*)$");
+  length = 0;
+  return pretty_func;
+} /* _funcname()  */
+
+const char* libathome_common::Error::
+_basename(const char* path)
+{
+  const char* result = path;
+
+  for (const char* pos = path; *pos != '\0'; pos++) {
+    if (*pos == '/' || *pos == '\\') result = pos + 1;
+  }
+
+  return *result != '\0'? result: path;
+}
 
 /* ---------------------------------------------------------------  */
 
@@ -42,19 +113,23 @@ void libathome_common::Error::
 _init(bool _backtrace_append,
   const char* _pretty_func, const char* reason_fmt, va_list ap)
 {
+  /* Just the raw frames, symbols will be resolved on demand in
+   * _symbolize()
+   */
   this->backtrace_size
-    = this->_backtrace(this->backtrace_frames, Error::BACKTRACE_MAX);
-  this->backtrace_symbolz = this->
-    _backtrace_symbols(this->backtrace_frames, this->backtrace_size);
+    = Error::_backtrace(this->backtrace_frames, Error::BACKTRACE_MAX);
+  this->backtrace_symbolized = false;
 
   /* ---  */
 
-  std::string func = _pretty_func != NULL
-    ? std::regex_replace(_pretty_func, Error::REGEX_FUNCNAME, "$2")
-    : "";
+  size_t func_length = 0;
+  const char* func = _pretty_func != NULL
+    ? Error::_funcname(_pretty_func, func_length): NULL;
 
-  if (func.empty())
+  if (func_length == 0) {
     func = _pretty_func != NULL? _pretty_func: "???";
+    func_length = ::strlen(func);
+  }
 
   string_t buf;
   if (0 >= ::vsnprintf(buf, STRING_LEN, reason_fmt, ap)) {
@@ -64,7 +139,16 @@ _init(bool _backtrace_append,
     ::strncpy(buf, reason_fmt, STRING_LEN-1);
   }
 
-  this->what_msg = "*(RUNTIME)* " + func + "(): " + buf;
+  /* One allocation, no temporaries  */
+  static const char PREFIX[] = "*(RUNTIME)* ";
+  static const char INFIX[] = "(): ";
+  size_t buf_length = ::strnlen(buf, STRING_LEN);
+  this->what_msg.reserve(
+    sizeof(PREFIX)-1 + func_length + sizeof(INFIX)-1 + buf_length);
+  this->what_msg.append(PREFIX, sizeof(PREFIX)-1);
+  this->what_msg.append(func, func_length);
+  this->what_msg.append(INFIX, sizeof(INFIX)-1);
+  this->what_msg.append(buf, buf_length);
 
   /* ---  */
 
@@ -149,64 +233,70 @@ _backtrace(void** buffer, int size)
 #endif /* ifdef __GNUC__  */
 } /* _backtrace()  */
 
-char** libathome_common::Error::
-_backtrace_symbols(void* const* buffer, int size)
+libathome_common::Error::symbols_cache_t& libathome_common::Error::
+_symbols_cache()
 {
-  if (size <= 0) return NULL;
+  static Error::symbols_cache_t* result = new Error::symbols_cache_t();
 
-  typedef struct {
-    char* ptr[Error::BACKTRACE_MAX];
-    string_t strings[Error::BACKTRACE_MAX];
-  } symbols_t;
+  return *result;
+}
 
+bool libathome_common::Error::
+_backtrace_symbols(void* const* buffer, int size, std::string* result)
+{
+  if (size <= 0) return true;
+
+  string_t buf;
 
 #if defined __GNUC__ && !defined OSWIN
   char** symbols_fallback = ::backtrace_symbols(buffer, size);
-  symbols_t* result = (symbols_t*) ::malloc(sizeof(symbols_t));
 
   ::Dl_info dlinfo;
   char* demangle_cur = NULL;
   size_t demangle_length = 0;
   int demangle_status;
   for (int i=0; i<size; i++) {
-    result->ptr[i] = result->strings[i];
-
     if (!::dladdr(buffer[i], &dlinfo) || dlinfo.dli_sname == NULL) {
-      ::snprintf(
-        result->strings[i], STRING_LEN, "%s", symbols_fallback[i]);
+      if (symbols_fallback != NULL) {
+        result[i] = symbols_fallback[i];
+      } else {
+        ::snprintf(buf, STRING_LEN, "[%p]", buffer[i]);
+        result[i] = buf;
+      }
 
       continue;
     }
 
-    std::string libname =
-      std::regex_replace(dlinfo.dli_fname, Error::REGEX_LIBNAME, "$2");
+    const char* libname = Error::_basename(dlinfo.dli_fname);
     unsigned long offset
       = (unsigned long) buffer[i] - (unsigned long) dlinfo.dli_saddr;
 
     char* dem_result = abi::__cxa_demangle(dlinfo.dli_sname,
       demangle_cur, &demangle_length, &demangle_status);
     if (dem_result == NULL) {
-      ::snprintf(result->strings[i], STRING_LEN, "%20s::%s()+0x%02lx [%p]",
-        libname.c_str(), dlinfo.dli_sname, offset, buffer[i]);
+      ::snprintf(buf, STRING_LEN, "%20s::%s()+0x%02lx [%p]",
+        libname, dlinfo.dli_sname, offset, buffer[i]);
+      result[i] = buf;
 
       continue;
     }
     demangle_cur = dem_result;
 
-    ::snprintf(result->strings[i], STRING_LEN, "%20s::%s+0x%02lx [%p]",
-      libname.c_str(), demangle_cur, offset, buffer[i]);
+    ::snprintf(buf, STRING_LEN, "%20s::%s+0x%02lx [%p]",
+      libname, demangle_cur, offset, buffer[i]);
+    result[i] = buf;
   } /* for (int i=0; i<size; i++)  */
 
   ::free(demangle_cur);
   ::free(symbols_fallback);
-  return result->ptr;
+  return true;
 #elif defined OSWIN
   /* The StackWalk64 API reference you can find here:
    *
    * https://docs.microsoft.com/en-us/windows/win32/api/dbghelp/nf-dbghelp-stackwalk64
    */
   ::HANDLE process = ::GetCurrentProcess();
-  if (!::SymInitialize(process, NULL, true)) return NULL;
+  if (!::SymInitialize(process, NULL, true)) return false;
 
   ::IMAGEHLP_MODULE64 module;
   module.SizeOfStruct = sizeof(::IMAGEHLP_MODULE64);
@@ -220,10 +310,7 @@ _backtrace_symbols(void* const* buffer, int size)
   ::IMAGEHLP_LINE64 fileline;
   fileline.SizeOfStruct = sizeof(::IMAGEHLP_LINE64);
 
-  symbols_t* result = (symbols_t*) ::malloc(sizeof(symbols_t));
-
   for (int i=0; i<size; i++) {
-    result->ptr[i] = result->strings[i];
     ::DWORD64 cur_stackframe = (::DWORD64) buffer[i];
 
     if (!::SymGetModuleInfo64(process, cur_stackframe, &module))
@@ -232,36 +319,113 @@ _backtrace_symbols(void* const* buffer, int size)
     ::DWORD64 displacement = 0;
     if (!::SymGetSymFromAddr64(
            process, cur_stackframe, &displacement, symbol)) {
-      ::snprintf(result->strings[i], STRING_LEN,
+      ::snprintf(buf, STRING_LEN,
         "%s [0x%01x%07x]", module.ModuleName,
         (uint32_t) (cur_stackframe >> 32), (uint32_t) cur_stackframe);
+      result[i] = buf;
 
       continue;
     }
 
     if (!::SymGetLineFromAddr64(
          process, cur_stackframe, (::PDWORD) &displacement, &fileline)) {
-      ::snprintf(result->strings[i], STRING_LEN,
+      ::snprintf(buf, STRING_LEN,
         "%s::%s()+0x%02x [0x%01x%07x]", module.ModuleName, symbol->Name,
         (uint32_t) displacement, (uint32_t) (cur_stackframe >> 32),
         (uint32_t) cur_stackframe);
+      result[i] = buf;
 
       continue;
     }
 
-    ::snprintf(result->strings[i], STRING_LEN,
+    ::snprintf(buf, STRING_LEN,
       "%20s:%03lu: %s::%s() [0x%01x%07x]", fileline.FileName,
       fileline.LineNumber, module.ModuleName, symbol->Name,
       (uint32_t) (cur_stackframe >> 32), (uint32_t) cur_stackframe);
+    result[i] = buf;
   } /* for (int i=0; i<size; i++)  */
 
   ::SymCleanup(process);
-  return result->ptr;
+  return true;
 #else /* elif defined OSWIN  */
-  return NULL;
+  (void) buf;
+  return false;
 #endif /* ifdef __GNUC__  */
 } /* _backtrace_symbols()  */
 
+void libathome_common::Error::
+_symbolize() const noexcept
+{
+  if (this->backtrace_symbolized) return;
+  this->backtrace_symbolized = true;
+
+  static const char* const UNKNOWN = "<unknown>";
+
+  Error::symbols_cache_t& cache = Error::_symbols_cache();
+
+  try {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    /* Resolve the missing frames in one batch, the backends have
+     * some setup costs per call
+     */
+    void* missing[Error::BACKTRACE_MAX];
+    int missing_size = 0;
+    for (int i=Error::BACKTRACE_OFFSET; i<this->backtrace_size; i++) {
+      if (cache.symbols.count(this->backtrace_frames[i]) == 0)
+        missing[missing_size++] = this->backtrace_frames[i];
+    }
+
+    if (missing_size > 0) {
+      std::string resolved[Error::BACKTRACE_MAX];
+      if (Error::_backtrace_symbols(missing, missing_size, resolved)) {
+        for (int i=0; i<missing_size; i++)
+          cache.symbols[missing[i]] = resolved[i];
+      }
+    }
+
+    /* Nodes of std::map are never moved, so the pointers are valid
+     * as long as the process lives
+     */
+    for (int i=Error::BACKTRACE_OFFSET; i<this->backtrace_size; i++) {
+      std::map<const void*, std::string>::const_iterator it
+        = cache.symbols.find(this->backtrace_frames[i]);
+
+      this->backtrace_symbolz[i]
+        = it != cache.symbols.end()? it->second.c_str(): UNKNOWN;
+    }
+  } catch (...) {
+    /* Throwing Error in Error is a bad idea.  So we are making the
+     * best what is possible.
+     */
+    for (int i=Error::BACKTRACE_OFFSET; i<this->backtrace_size; i++)
+      this->backtrace_symbolz[i] = UNKNOWN;
+  }
+} /* _symbolize()  */
+
+const char* libathome_common::Error::
+_symbol(void* frame) noexcept
+{
+  Error::symbols_cache_t& cache = Error::_symbols_cache();
+
+  try {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    std::map<const void*, std::string>::const_iterator it
+      = cache.symbols.find(frame);
+    if (it != cache.symbols.end()) return it->second.c_str();
+
+    std::string resolved;
+    if (!Error::_backtrace_symbols(&frame, 1, &resolved))
+      return "<unknown>";
+
+    return (cache.symbols[frame] = resolved).c_str();
+  } catch (...) {
+    /* Throwing Error in Error is a bad idea.  */
+    return "<unknown>";
+  }
+}
+
 /* ---------------------------------------------------------------  */
 
 libathome_common::Error::
@@ -286,7 +450,6 @@ Error(bool _backtrace_append, const char* _pretty_func,
 libathome_common::Error::
 ~Error()
 {
-  if (this->backtrace_symbolz) ::free(this->backtrace_symbolz);
 }
 
 /* ---------------------------------------------------------------  */
@@ -303,6 +466,8 @@ bt() noexcept
   if (this->backtrace_size == 0)
     this->what_msg += "\n  <Not implemented for your compiler or OS>";
 
+  this->_symbolize();
+
   string_t buf;
   int output_size = this->get_backtrace_size();
   for (int i=0; i<output_size; i++) {
@@ -354,5 +519,7 @@ get_backtrace_symbol(int i) const noexcept
   if (i < 0 || i >= (this->backtrace_size - Error::BACKTRACE_OFFSET))
     return NULL;
 
+  this->_symbolize();
+
   return this->backtrace_symbolz[i + Error::BACKTRACE_OFFSET];
 }
@@ -25,7 +25,8 @@
 
 #include "libathome-common/Common.hpp"
 
-#include <regex>
+#include <map>
+#include <mutex>
 
 /* Debugging stuff
  */
@@ -41,6 +42,19 @@
 /* C++ compiler depending stuff
  */
 
+/// @cond Doxygen_Suppress
+#ifdef __GNUC__
+#  /* GNU extension  */
+#  define _ERROR_FUNC              (__PRETTY_FUNCTION__)
+#elif defined OSWIN
+#  /* Microsoft extension  */
+#  define _ERROR_FUNC              (__FUNCSIG__)
+#else
+#  /* C++ standard  */
+#  define _ERROR_FUNC              (__func__)
+#endif /* ifdef __GNUC__  */
+/// @endcond
+
 /**
  * **Constructor** macro to `throw` an ::libathome_common::Error.
  *
@@ -66,19 +80,8 @@
  * }
  * ```
  */
-#ifdef __GNUC__
-#  /* GNU extension  */
-#  define Err(reason ...) libathome_common::Error( \
-          _ERROR_BT, (__PRETTY_FUNCTION__), reason)
-#elif defined OSWIN
-#  /* Microsoft extension  */
-#  define Err(reason ...) libathome_common::Error( \
-          _ERROR_BT, (__FUNCSIG__), reason)
-#else
-#  /* C++ standard  */
-#  define Err(reason ...) libathome_common::Error( \
-          _ERROR_BT, (__func__), reason)
-#endif /* ifdef __GNUC__  */
+#define Err(reason ...) libathome_common::Error( \
+        _ERROR_BT, _ERROR_FUNC, reason)
 
 
 namespace libathome_common
@@ -102,6 +105,13 @@ namespace libathome_common
  * defining the preprocessor constant `DEBUG`, i.e. passing the flag
  * `-DDEBUG` through the C++ compiler.
  *
+ * Only the raw stack frames are captured on construction, which is
+ * cheap.  They will be resolved to symbols not before
+ * ::libathome_common::Error::bt() or
+ * ::libathome_common::Error::get_backtrace_symbol() is called.
+ * Resolved symbols are cached process-wide, so errors thrown
+ * repeatedly from the same site will be resolved only once.
+ *
  * **Example**
  * ```cpp
  * try {
@@ -193,6 +203,9 @@ public:
    * Returns a symbolic representation of the `i`-th stack frame of
    * the backtrace.
    *
+   * The first call resolves the symbols of the whole backtrace, so
+   * don't call it concurrently on the same instance.
+   *
    * @param i Index of the stack frame you want to get
    * @return Symbolic representation of the `i`-th stack frame.  Or
    *         `NULL` if `i` is out of range.
@@ -200,8 +213,22 @@ public:
   virtual const char* get_backtrace_symbol(int i) const noexcept;
 
 private:
-  static const std::regex REGEX_FUNCNAME;
-  static const std::regex REGEX_LIBNAME;
+  /** Reuses the unwinding and symbol resolution  */
+  friend class CrashHandler;
+
+  /**
+   * Extracts `Class::method` of `__PRETTY_FUNCTION__`, without
+   * allocation.
+   *
+   * @param pretty_func Passed by `::Err()` macro
+   * @param length Output, length of the name or `0` if not found
+   * @return Begin of the name in `pretty_func`
+   */
+  static const char* _funcname(const char* pretty_func, size_t& length);
+  /**
+   * @return Filename of `path` without directory, points into `path`
+   */
+  static const char* _basename(const char* path);
 
   std::string what_msg;
   bool backtrace_appended;
@@ -213,8 +240,23 @@ private:
    */
   static const int BACKTRACE_OFFSET = 3;
   void* backtrace_frames[BACKTRACE_MAX];
-  char** backtrace_symbolz;
   int backtrace_size;
+  /** Resolved lazily, pointing into Error::_symbols_cache()  */
+  mutable const char* backtrace_symbolz[BACKTRACE_MAX];
+  mutable bool backtrace_symbolized;
+
+  /** Process-wide cache, resolved symbol per stack frame address  */
+  typedef struct {
+    std::mutex mutex;
+    std::map<const void*, std::string> symbols;
+  } symbols_cache_t;
+
+  /**
+   * Function-local `static`, so it is also usable by errors which
+   * are thrown during static initialization.  Never destructed, for
+   * errors during static destruction.
+   */
+  static symbols_cache_t& _symbols_cache();
 
   /**
    * `__attribute__((noinline))` makes sure that
@@ -227,16 +269,31 @@ private:
   /**
    * `__attribute__((noinline))` makes sure that
    * Error::BACKTRACE_OFFSET is set correct.
+   *
+   * Async-signal-safe on Linux, after it was called once.
    */
-  int _backtrace(void** buffer, int size) __attribute__((noinline));
+  static int _backtrace(void** buffer, int size)
+    __attribute__((noinline));
 
   /**
-   * The result must be `free()`, usally in destructor `~Error()`!
+   * Resolves the symbols of `buffer`.
+   *
+   * @param result Output, array with at least `size` strings
+   * @return `false` if not implemented
+   */
+  static bool _backtrace_symbols(void* const* buffer, int size,
+    std::string* result);
+
+  /**
+   * Fills Error::backtrace_symbolz, using Error::_symbols_cache().
+   */
+  void _symbolize() const noexcept;
+  /**
+   * Resolves one stack frame, using Error::_symbols_cache().
    *
-   * @return Is allocated with `malloc()` and mus be `free()` by
-   *         caller.  Or NULL if not implemented.
+   * @return Never `NULL`, valid as long as the process lives
    */
-  char** _backtrace_symbols(void* const* buffer, int size);
+  static const char* _symbol(void* frame) noexcept;
 
 }; /* class Error  */
 
@@ -21,13 +21,22 @@
 #include "libathome-common/Filesystem.hpp"
 
 #include <cerrno>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifndef OSWIN
+#  include <sys/mman.h>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#endif /* ifndef OSWIN  */
 
 
 libathome_common::File::
 File(::FILE* fstream, const std::string& stream_name) noexcept(false)
   :extern_fstream(fstream), binary(true), path("<no path>"),
    filename("<extern fstream>"), fstream(NULL),
-   mode(File::access_t::read_e)
+   mode(File::access_t::read_e), buffer_size(0), mapped(false),
+   map_data(NULL), map_length(0)
 {
   if (fstream == NULL) {
     throw
@@ -40,7 +49,8 @@ File(::FILE* fstream, const std::string& stream_name) noexcept(false)
 libathome_common::File::
 File(const std::string& path, const std::string& filename, bool binary)
   :extern_fstream(NULL), binary(binary), path(path), filename(filename),
-   fstream(NULL), mode(File::access_t::read_e)
+   fstream(NULL), mode(File::access_t::read_e), buffer_size(0),
+   mapped(false), map_data(NULL), map_length(0)
 {
   this->filename_full
     = this->path + Filesystem::PATH_SEPERATOR + this->filename;
@@ -61,26 +71,69 @@ to_string(File::access_t access)
   case read_e: return "read";
   case write_e: return "write";
   case append_e: return "append";
+  case replace_e: return "replace";
+  }
+
+  return "<not implemented!>";
+}
+
+const char* libathome_common::File::
+to_string(File::advice_t advice)
+{
+  switch (advice) {
+  case normal_e: return "normal";
+  case sequential_e: return "sequential";
+  case random_e: return "random";
+  case willneed_e: return "willneed";
+  case dontneed_e: return "dontneed";
   }
 
   return "<not implemented!>";
 }
 
+void libathome_common::File::
+set_filename(const std::string& filename)
+{
+  if (this->extern_fstream != NULL) return;
+
+  this->filename = filename;
+  this->filename_full
+    = this->path + Filesystem::PATH_SEPERATOR + this->filename;
+}
+
+const std::string& libathome_common::File::
+get_path() const
+{
+  return this->path;
+}
+
+const std::string& libathome_common::File::
+get_filename() const
+{
+  return this->filename;
+}
+
 void libathome_common::File::
 open(File::access_t mode) noexcept(false)
+{
+  this->open(mode, std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::File::
+open(File::access_t mode, const std::nothrow_t&)
 {
   this->mode = mode;
 
   if (this->extern_fstream != NULL) {
     this->fstream = this->extern_fstream;
-    return;
+    return Status();
   }
 
-  /* Don't Log here, just throw exceptions.  It's part of writing log!
+  /* Don't Log here, just return errors.  It's part of writing log!
    */
-  if (this->mode == File::access_t::write_e ||
-      this->mode == File::access_t::append_e) {
-    Filesystem::mkdir(this->path);
+  if (this->mode != File::access_t::read_e) {
+    Result<bool> mkdir_res = Filesystem::mkdir_p(this->path, std::nothrow);
+    if (!mkdir_res) return mkdir_res.get_status();
   }
 
   char mode_str[3] = {'r', '\0', '\0'};
@@ -90,14 +143,36 @@ open(File::access_t mode) noexcept(false)
   case read_e:   mode_str[0] = 'r'; break;
   case write_e:  mode_str[0] = 'w'; break;
   case append_e: mode_str[0] = 'a'; break;
+  case replace_e: mode_str[0] = 'w'; break;
   }
 
-  this->fstream = fopen(this->filename_full.c_str(), mode_str);
+  std::string filename_open = this->mode == File::access_t::replace_e
+    ? this->_get_filename_tmp(): this->filename_full;
+  this->fstream = fopen(filename_open.c_str(), mode_str);
+
+  /* The cached directory was removed meanwhile  */
+  if (this->fstream == NULL && errno == ENOENT
+      && this->mode != File::access_t::read_e) {
+    Filesystem::forget_dir(this->path);
+    Result<bool> mkdir_res = Filesystem::mkdir_p(this->path, std::nothrow);
+    if (!mkdir_res) return mkdir_res.get_status();
+
+    this->fstream = fopen(filename_open.c_str(), mode_str);
+  }
   if (this->fstream == NULL) {
-    throw Err("Could not open file '%s' for '%s': %s!",
-              this->filename_full.c_str(), File::to_string(this->mode),
-              ::strerror(errno));
+    int code = errno;
+    return ErrStatus(code, "Could not open file '%s' for '%s': %s!",
+                     this->filename_full.c_str(),
+                     File::to_string(this->mode), ::strerror(code));
   }
+
+  if (this->buffer_size > 0) {
+    this->buffer.resize(this->buffer_size);
+    ::setvbuf(
+      this->fstream, this->buffer.data(), _IOFBF, this->buffer_size);
+  }
+
+  return Status();
 }
 
 void libathome_common::File::
@@ -106,26 +181,204 @@ close()
   /* Ignore double closes  */
   if (this->fstream == NULL) return;
 
+  this->unmap();
+  this->read_buffer.clear();
+  this->read_buffer.shrink_to_fit();
+
   if (this->extern_fstream == NULL) fclose(this->fstream);
 
+  /* Not committed, the old file stays  */
+  if (this->mode == File::access_t::replace_e && this->extern_fstream == NULL)
+    ::remove(this->_get_filename_tmp().c_str());
+
   this->mode = File::access_t::read_e;
   this->fstream = NULL;
 }
 
+void libathome_common::File::
+commit() noexcept(false)
+{
+  this->commit(std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::File::
+commit(const std::nothrow_t&)
+{
+  if (this->fstream == NULL || this->mode != File::access_t::replace_e) {
+    return ErrStatus(EBADF, "File '%s' not opened for replace-access!",
+                     this->filename_full.c_str());
+  }
+
+  /* Externally managed filestreams can't be replaced  */
+  if (this->extern_fstream != NULL) return this->flush(std::nothrow);
+
+  /* The data must be on the disk before the rename, otherwise a
+   * power loss may leave an empty file behind it
+   */
+  Status status = this->flush(std::nothrow);
+  if (status) {
+    status = File::_sync(::fileno(this->fstream), this->filename_full);
+  }
+  if (!status) {
+    this->close();
+    return status;
+  }
+
+  this->unmap();
+  int fclose_res = ::fclose(this->fstream);
+  this->fstream = NULL;
+  this->mode = File::access_t::read_e;
+
+  std::string filename_tmp = this->_get_filename_tmp();
+  if (fclose_res != 0) {
+    int code = errno;
+    ::remove(filename_tmp.c_str());
+    return ErrStatus(code, "Could not close file '%s': %s!",
+                     filename_tmp.c_str(), ::strerror(code));
+  }
+
+  status = Filesystem::rename(filename_tmp, this->filename_full,
+                              std::nothrow);
+  if (!status) {
+    ::remove(filename_tmp.c_str());
+    return status;
+  }
+
+#ifndef OSWIN
+  /* Persist the rename itself, it's an entry of the directory  */
+  int dir_fd = ::open(this->path.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dir_fd < 0) {
+    int code = errno;
+    return ErrStatus(code, "Could not open directory '%s': %s!",
+                     this->path.c_str(), ::strerror(code));
+  }
+  status = File::_sync(dir_fd, this->path);
+  ::close(dir_fd);
+#endif /* ifndef OSWIN  */
+
+  return status;
+}
+
+std::string libathome_common::File::
+_get_filename_tmp() const
+{
+  return this->filename_full + ".tmp";
+}
+
+bool libathome_common::File::
+_is_writable() const
+{
+  return this->fstream != NULL && this->mode != File::access_t::read_e;
+}
+
+libathome_common::Status libathome_common::File::
+_sync(int fd, const std::string& name)
+{
+#ifndef OSWIN
+  if (0 != ::fsync(fd)) {
+#else /* ifndef OSWIN  */
+  if (0 != ::_commit(fd)) {
+#endif /* ifndef OSWIN  */
+    int code = errno;
+    return ErrStatus(code, "Could not sync '%s' to disk: %s!",
+                     name.c_str(), ::strerror(code));
+  }
+
+  return Status();
+}
+
+bool libathome_common::File::
+is_open() const
+{
+  return this->fstream != NULL;
+}
+
+void libathome_common::File::
+set_buffer(size_t size)
+{
+  if (this->extern_fstream != NULL) return;
+
+  /* The current buffer may still be in use by an opened FSTREAM, it
+   * will be resized on next open().
+   */
+  this->buffer_size = size;
+}
+
+void libathome_common::File::
+flush() noexcept(false)
+{
+  this->flush(std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::File::
+flush(const std::nothrow_t&)
+{
+  if (this->fstream == NULL) return Status();
+
+  if (0 != ::fflush(this->fstream)) {
+    int code = errno;
+    return ErrStatus(code, "Could not flush '%s': %s!",
+                     this->filename_full.c_str(), ::strerror(code));
+  }
+
+  return Status();
+}
+
+bool libathome_common::File::
+reopen_if_moved() noexcept(false)
+{
+  return this->reopen_if_moved(std::nothrow).get();
+}
+
+libathome_common::Result<bool> libathome_common::File::
+reopen_if_moved(const std::nothrow_t&)
+{
+  if (this->fstream == NULL || this->extern_fstream != NULL
+      || this->mode == File::access_t::replace_e) {
+    return false;
+  }
+
+  struct ::stat stat_path, stat_open;
+  if (0 == ::stat(this->filename_full.c_str(), &stat_path)
+      && 0 == ::fstat(::fileno(this->fstream), &stat_open)
+      && stat_path.st_dev == stat_open.st_dev
+      && stat_path.st_ino == stat_open.st_ino) {
+    return false;
+  }
+
+  File::access_t mode = this->mode;
+  this->close();
+  Status status = this->open(mode == File::access_t::write_e
+                             ? File::access_t::append_e: mode,
+                             std::nothrow);
+  if (!status) return status;
+
+  return true;
+}
+
 /* ***************************************************************  */
 
 void libathome_common::File::
 vprintf(const char* fmt, ::va_list ap) const noexcept(false)
 {
-  if (this->fstream == NULL
-      || (this->mode != File::access_t::write_e &&
-          this->mode != File::access_t::append_e)) {
-    throw Err("File '%s' not opened for write- or append-access!",
-              this->filename_full.c_str());
+  this->vprintf(fmt, ap, std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::File::
+vprintf(const char* fmt, ::va_list ap, const std::nothrow_t&) const
+{
+  if (!this->_is_writable()) {
+    return ErrStatus(EBADF,
+      "File '%s' not opened for write- or append-access!",
+      this->filename_full.c_str());
+  }
+
+  if (0 >= ::vfprintf(this->fstream, fmt, ap)) {
+    return ErrStatus(EIO, "Could not write to '%s'!",
+                     this->filename_full.c_str());
   }
 
-  if (0 >= ::vfprintf(this->fstream, fmt, ap))
-    throw Err("Could not write to '%s'!", this->filename_full.c_str());
+  return Status();
 }
 
 /* ***************************************************************  */
@@ -140,8 +393,387 @@ printf(const char* fmt, ...) const noexcept(false)
   ::va_end(ap);
 }
 
+libathome_common::Status libathome_common::File::
+printf(const std::nothrow_t&, const char* fmt, ...) const
+{
+  ::va_list ap;
+
+  ::va_start(ap, fmt);
+  Status result = this->vprintf(fmt, ap, std::nothrow);
+  ::va_end(ap);
+
+  return result;
+}
+
 void libathome_common::File::
 print(const std::string& output) const noexcept(false)
 {
-  this->printf("%s", output.c_str());
+  this->write(output.data(), output.length());
+}
+
+libathome_common::Status libathome_common::File::
+print(const std::string& output, const std::nothrow_t&) const
+{
+  return this->write(output.data(), output.length(), std::nothrow);
+}
+
+void libathome_common::File::
+write(const void* data, size_t length) const noexcept(false)
+{
+  this->write(data, length, std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::File::
+write(const void* data, size_t length, const std::nothrow_t&) const
+{
+  if (!this->_is_writable()) {
+    return ErrStatus(EBADF,
+      "File '%s' not opened for write- or append-access!",
+      this->filename_full.c_str());
+  }
+
+  /* An instance is not thread-safe anyway, so the lock of FSTREAM can
+   * be skipped if it's owned.  Externally managed filestreams, such
+   * like `stdout`, may be shared with other code of the process.
+   */
+  size_t written;
+#ifdef __GLIBC__
+  if (this->extern_fstream == NULL)
+    written = ::fwrite_unlocked(data, 1, length, this->fstream);
+  else
+    written = ::fwrite(data, 1, length, this->fstream);
+#else /* ifdef __GLIBC__  */
+  written = ::fwrite(data, 1, length, this->fstream);
+#endif /* ifdef __GLIBC__  */
+
+  if (length != written) {
+    return ErrStatus(EIO, "Could not write to '%s'!",
+                     this->filename_full.c_str());
+  }
+
+  return Status();
+}
+
+void libathome_common::File::
+writev(const File::span_t* spans, size_t count) const noexcept(false)
+{
+  this->writev(spans, count, std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::File::
+writev(const File::span_t* spans, size_t count, const std::nothrow_t&)
+  const
+{
+  size_t total = 0;
+  for (size_t i=0; i<count; i++) total += spans[i].length;
+
+  size_t buffer_size = this->buffer_size > 0? this->buffer_size: BUFSIZ;
+
+#ifndef OSWIN
+  if (total >= buffer_size && this->_is_writable()) {
+    /* Copying wouldn't save syscalls, keep the order with the
+     * buffered data
+     */
+    if (0 != ::fflush(this->fstream)) {
+      int code = errno;
+      return ErrStatus(code, "Could not flush '%s': %s!",
+                       this->filename_full.c_str(), ::strerror(code));
+    }
+
+    int fd = ::fileno(this->fstream);
+    ::iovec iov[File::_WRITEV_MAX];
+    size_t i = 0;
+    size_t skip = 0;
+    while (i < count) {
+      int n = 0;
+      for (size_t j=i; j<count && n<(int) File::_WRITEV_MAX; j++, n++) {
+        iov[n].iov_base = (void*) (spans[j].data + (j == i? skip: 0));
+        iov[n].iov_len = spans[j].length - (j == i? skip: 0);
+      }
+
+      ::ssize_t written = ::writev(fd, iov, n);
+      if (written < 0) {
+        int code = errno;
+        if (code == EINTR) continue;
+        return ErrStatus(code, "Could not write to '%s': %s!",
+                         this->filename_full.c_str(), ::strerror(code));
+      }
+
+      /* Partial writes continue in the middle of a span  */
+      size_t left = (size_t) written;
+      while (i < count && left >= spans[i].length - skip) {
+        left -= spans[i].length - skip;
+        skip = 0;
+        i++;
+      }
+      skip += left;
+    }
+
+    return Status();
+  }
+#endif /* ifndef OSWIN  */
+
+  for (size_t i=0; i<count; i++) {
+    Status status = this->write(spans[i].data, spans[i].length,
+                                std::nothrow);
+    if (!status) return status;
+  }
+
+  return Status();
+}
+
+/* ***************************************************************  */
+
+size_t libathome_common::File::
+read(void* data, size_t length) noexcept(false)
+{
+  return this->read(data, length, std::nothrow).get();
+}
+
+libathome_common::Result<size_t> libathome_common::File::
+read(void* data, size_t length, const std::nothrow_t&)
+{
+  if (this->fstream == NULL || this->mode != File::access_t::read_e) {
+    return ErrStatus(EBADF, "File '%s' not opened for read-access!",
+                     this->filename_full.c_str());
+  }
+
+  size_t result = ::fread(data, 1, length, this->fstream);
+  if (result < length && ::ferror(this->fstream)) {
+    ::clearerr(this->fstream);
+    return ErrStatus(EIO, "Could not read from '%s'!",
+                     this->filename_full.c_str());
+  }
+
+  return result;
+}
+
+libathome_common::File::span_t libathome_common::File::
+read_span(size_t max) noexcept(false)
+{
+  return this->read_span(max, std::nothrow).get();
+}
+
+libathome_common::Result<libathome_common::File::span_t>
+libathome_common::File::
+read_span(size_t max, const std::nothrow_t&)
+{
+  size_t size = this->buffer_size > 0
+    ? this->buffer_size: File::READ_BUFFER_DEFAULT;
+  if (max == 0 || max > size) max = size;
+
+  if (this->read_buffer.size() < max) this->read_buffer.resize(max);
+
+  /* FREAD() reads directly into READ_BUFFER if MAX is not smaller
+   * than the buffer of FSTREAM, so there is only one copy
+   */
+  Result<size_t> length
+    = this->read(this->read_buffer.data(), max, std::nothrow);
+  if (!length) return length.get_status();
+
+  return File::span_t{this->read_buffer.data(), length.get()};
+}
+
+/* ***************************************************************  */
+
+int libathome_common::File::
+_madvise_advice(File::advice_t advice)
+{
+#ifndef OSWIN
+  switch (advice) {
+  case normal_e: return MADV_NORMAL;
+  case sequential_e: return MADV_SEQUENTIAL;
+  case random_e: return MADV_RANDOM;
+  case willneed_e: return MADV_WILLNEED;
+  case dontneed_e: return MADV_DONTNEED;
+  }
+#else /* ifndef OSWIN  */
+  (void) advice;
+#endif /* ifndef OSWIN  */
+
+  return 0;
+}
+
+libathome_common::File::span_t libathome_common::File::
+map(File::advice_t advice) noexcept(false)
+{
+  return this->map(advice, std::nothrow).get();
+}
+
+libathome_common::Result<libathome_common::File::span_t>
+libathome_common::File::
+map(File::advice_t advice, const std::nothrow_t&)
+{
+  if (this->mapped) {
+    return File::span_t{(const char*) this->map_data, this->map_length};
+  }
+
+  if (this->fstream == NULL || this->mode != File::access_t::read_e) {
+    return ErrStatus(EBADF, "File '%s' not opened for read-access!",
+                     this->filename_full.c_str());
+  }
+
+#ifndef OSWIN
+  int fd = ::fileno(this->fstream);
+
+  struct ::stat st;
+  if (0 != ::fstat(fd, &st)) {
+    int code = errno;
+    return ErrStatus(code, "Could not stat '%s': %s!",
+                     this->filename_full.c_str(), ::strerror(code));
+  }
+  if (!S_ISREG(st.st_mode)) {
+    return ErrStatus(ENODEV, "Could not map '%s', not a regular file!",
+                     this->filename_full.c_str());
+  }
+
+  /* MMAP() refuses length 0  */
+  if (st.st_size == 0) {
+    this->mapped = true;
+    return File::span_t{"", 0};
+  }
+
+  void* data = ::mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+                      fd, 0);
+  if (data == MAP_FAILED) {
+    int code = errno;
+    return ErrStatus(code, "Could not map '%s': %s!",
+                     this->filename_full.c_str(), ::strerror(code));
+  }
+
+  /* Just a hint, ignore failures  */
+  ::madvise(data, (size_t) st.st_size, File::_madvise_advice(advice));
+
+  this->mapped = true;
+  this->map_data = data;
+  this->map_length = (size_t) st.st_size;
+
+  return File::span_t{(const char*) data, this->map_length};
+#else /* ifndef OSWIN  */
+  (void) advice;
+  return ErrStatus(ENOSYS, "Mapping files is not supported on Windows!");
+#endif /* ifndef OSWIN  */
+}
+
+void libathome_common::File::
+advise(size_t offset, size_t length, File::advice_t advice)
+  noexcept(false)
+{
+  this->advise(offset, length, advice, std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::File::
+advise(size_t offset, size_t length, File::advice_t advice,
+       const std::nothrow_t&)
+{
+  if (!this->mapped) {
+    return ErrStatus(EINVAL, "File '%s' is not mapped!",
+                     this->filename_full.c_str());
+  }
+
+#ifndef OSWIN
+  if (offset >= this->map_length || length == 0) return Status();
+  if (length > this->map_length - offset)
+    length = this->map_length - offset;
+
+  /* MADVISE() needs a page aligned address  */
+  static const size_t page = (size_t) ::sysconf(_SC_PAGESIZE);
+  size_t begin = offset - offset % page;
+
+  if (0 != ::madvise((char*) this->map_data + begin,
+                     offset + length - begin,
+                     File::_madvise_advice(advice))) {
+    int code = errno;
+    return ErrStatus(code, "Could not advise '%s' for '%s': %s!",
+                     File::to_string(advice), this->filename_full.c_str(),
+                     ::strerror(code));
+  }
+#else /* ifndef OSWIN  */
+  (void) offset;
+  (void) length;
+  (void) advice;
+#endif /* ifndef OSWIN  */
+
+  return Status();
+}
+
+void libathome_common::File::
+unmap()
+{
+  if (!this->mapped) return;
+
+#ifndef OSWIN
+  if (this->map_data != NULL) ::munmap(this->map_data, this->map_length);
+#endif /* ifndef OSWIN  */
+
+  this->mapped = false;
+  this->map_data = NULL;
+  this->map_length = 0;
+}
+
+/* ***************************************************************  */
+
+bool libathome_common::File::
+read_async(AsyncIO& io, void* data, size_t length, uint64_t offset,
+           uint64_t tag) noexcept(false)
+{
+  return this->read_async(io, data, length, offset, tag, std::nothrow)
+    .get();
+}
+
+libathome_common::Result<bool> libathome_common::File::
+read_async(AsyncIO& io, void* data, size_t length, uint64_t offset,
+           uint64_t tag, const std::nothrow_t&)
+{
+  if (this->fstream == NULL || this->mode != File::access_t::read_e) {
+    return ErrStatus(EBADF, "File '%s' not opened for read-access!",
+                     this->filename_full.c_str());
+  }
+
+  return io.read(::fileno(this->fstream), data, length, offset, tag);
+}
+
+bool libathome_common::File::
+write_async(AsyncIO& io, const void* data, size_t length,
+            uint64_t offset, uint64_t tag) noexcept(false)
+{
+  return this->write_async(io, data, length, offset, tag, std::nothrow)
+    .get();
+}
+
+libathome_common::Result<bool> libathome_common::File::
+write_async(AsyncIO& io, const void* data, size_t length,
+            uint64_t offset, uint64_t tag, const std::nothrow_t&)
+{
+  if (!this->_is_writable()) {
+    return ErrStatus(EBADF,
+      "File '%s' not opened for write- or append-access!",
+      this->filename_full.c_str());
+  }
+
+  Status status = this->flush(std::nothrow);
+  if (!status) return status;
+
+  return io.write(::fileno(this->fstream), data, length, offset, tag);
+}
+
+bool libathome_common::File::
+sync_async(AsyncIO& io, uint64_t tag, bool datasync) noexcept(false)
+{
+  return this->sync_async(io, tag, datasync, std::nothrow).get();
+}
+
+libathome_common::Result<bool> libathome_common::File::
+sync_async(AsyncIO& io, uint64_t tag, bool datasync,
+           const std::nothrow_t&)
+{
+  if (this->fstream == NULL) {
+    return ErrStatus(EBADF, "File '%s' not opened!",
+                     this->filename_full.c_str());
+  }
+
+  Status status = this->flush(std::nothrow);
+  if (!status) return status;
+
+  return io.fsync(::fileno(this->fstream), tag, datasync);
 }
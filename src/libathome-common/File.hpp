@@ -24,6 +24,10 @@
  */
 
 #include "libathome-common/Common.hpp"
+#include "libathome-common/Result.hpp"
+#include "libathome-common/AsyncIO.hpp"
+
+#include <vector>
 
 namespace libathome_common
 {
@@ -39,9 +43,19 @@ namespace libathome_common
  * After constructed you need to open the file with
  * ::libathome_common::File::open().  Then you can write to it with
  * ::libathome_common::File::print(),
- * ::libathome_common::File::printf() or read with
- * ::libathome_common::File::scanf().  If you finished then
+ * ::libathome_common::File::printf(),
+ * ::libathome_common::File::write() or read with
+ * ::libathome_common::File::read(),
+ * ::libathome_common::File::read_span() or
+ * ::libathome_common::File::map().  If you finished then
  * ::libathome_common::File::close() the file.
+ *
+ * Most methods have a non-throwing overload taking `std::nothrow`,
+ * which returns a ::libathome_common::Status instead.
+ *
+ * An instance is NOT thread-safe.  Subclasses which are used by
+ * several threads, such like ::libathome_common::Logger, must make
+ * sure that only one thread at a time accesses the file.
  */
 class File
 {
@@ -55,7 +69,9 @@ public:
   typedef enum {
     read_e = 0,    ///< Open file for read
     write_e = 1,   ///< Open file for write; will be created if not exist.
-    append_e = 2   ///< Append to file; will be created if not exist.
+    append_e = 2,  ///< Append to file; will be created if not exist.
+    replace_e = 3  ///< Write to a temporary file, which replaces the
+                   ///< file on ::libathome_common::File::commit()
   } access_t;
 
   /**
@@ -67,6 +83,48 @@ public:
    */
   static const char* to_string(File::access_t access);
 
+  /**
+   * Expected access pattern of a mapped file, passed to `madvise()`.
+   *
+   * Pass it via ::libathome_common::File::map() or
+   * ::libathome_common::File::advise().
+   */
+  typedef enum {
+    normal_e = 0,      ///< No special treatment
+    sequential_e = 1,  ///< Read ahead aggressively, drop pages behind
+    random_e = 2,      ///< Don't read ahead
+    willneed_e = 3,    ///< Start reading the pages in now
+    dontneed_e = 4     ///< Pages are not needed anymore, free them
+  } advice_t;
+
+  /**
+   * Convert a ::libathome_common::File::advice_t to string.
+   *
+   * @param advice The advice to convert
+   * @return The string which names the advice. `static` allocated,
+   *         NOT needed to be `free()`d.
+   */
+  static const char* to_string(File::advice_t advice);
+
+  /**
+   * Read-only view into memory.
+   *
+   * Returned by ::libathome_common::File::read_span() and
+   * ::libathome_common::File::map(), then the memory is owned by the
+   * ::libathome_common::File.  Passed to
+   * ::libathome_common::File::writev().
+   */
+  typedef struct {
+    const char* data;
+    size_t length;
+  } span_t;
+
+  /**
+   * Size of the buffer of ::libathome_common::File::read_span(), if
+   * ::libathome_common::File::set_buffer() was not called.
+   */
+  static const size_t READ_BUFFER_DEFAULT = 1 << 20;
+
   /**
    * Construct a file with an externally opened `fstream`.
    *
@@ -107,6 +165,29 @@ public:
    */
   virtual ~File();
 
+  /**
+   * Change the filename.
+   *
+   * Takes effect on the next ::libathome_common::File::open().  Will
+   * be ignored for externally managed filestreams.
+   *
+   * @param filename The new filename, without path
+   */
+  virtual void set_filename(const std::string& filename);
+
+  /**
+   * Returns the directory of the file.
+   *
+   * @return The `path` which was passed to the constructor
+   */
+  virtual const std::string& get_path() const;
+  /**
+   * Returns the filename.
+   *
+   * @return The filename without `path`
+   */
+  virtual const std::string& get_filename() const;
+
   /**
    * Open file with access permissions ::libathome_common::File::access_t.
    *
@@ -119,6 +200,14 @@ public:
    *            not be opened
    */
   virtual void open(File::access_t mode) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::open(File::access_t).
+   *
+   * @param mode Mode for opening, likes read/write/append
+   * @return Failed if file could not be opened
+   */
+  virtual Status open(File::access_t mode, const std::nothrow_t&);
   /**
    * Close the file and write to disk or unlock to write.
    *
@@ -126,10 +215,103 @@ public:
    * ::libathome_common::File::append_e then on closing the file it
    * will be written to disk.  If ::libathome_common::File::read_e
    * then closing will make other file descriptors available to write
-   * to the file.
+   * to the file.  If
+   * ::libathome_common::File::replace_e then the written data will be
+   * dropped, see ::libathome_common::File::commit().
    */
   virtual void close();
 
+  /**
+   * Replace the file by the written one, crash-safe.
+   *
+   * Only for ::libathome_common::File::replace_e.  The written data
+   * will be flushed and synced to disk, then renamed over the file
+   * and the directory will be synced.  So after a crash or power loss
+   * there is either the old or the new file, never a torn one.  The
+   * file is closed afterwards.
+   *
+   * A file opened with ::libathome_common::File::replace_e which is
+   * closed without `commit()` leaves the old file untouched.
+   *
+   * @exception ::libathome_common::Error will be thrown if the file is
+   *            not opened with ::libathome_common::File::replace_e or
+   *            writing, syncing or renaming has failed.  Then the old
+   *            file stays and the file is closed.
+   */
+  virtual void commit() noexcept(false);
+  /**
+   * Non-throwing variant of ::libathome_common::File::commit().
+   *
+   * @return Failed if the file could not be replaced
+   */
+  virtual Status commit(const std::nothrow_t&);
+
+  /**
+   * Returns `true` if the file is opened.
+   *
+   * @return `true` between ::libathome_common::File::open() and
+   *         ::libathome_common::File::close()
+   */
+  virtual bool is_open() const;
+
+  /**
+   * Set the size of the user-space write buffer.
+   *
+   * Takes effect on the next ::libathome_common::File::open().
+   * Written data stays in this buffer until it is full or
+   * ::libathome_common::File::flush() was called.  `0` uses the
+   * default buffer of the C library.  Will be ignored for externally
+   * managed filestreams.
+   *
+   * It also sets the maximum size of the spans of
+   * ::libathome_common::File::read_span(), then `0` uses
+   * ::libathome_common::File::READ_BUFFER_DEFAULT.
+   *
+   * @param size Size of the write buffer in bytes
+   */
+  virtual void set_buffer(size_t size);
+
+  /**
+   * Write the user-space write buffer to the operating system.
+   *
+   * @exception ::libathome_common::Error will be thrown if writing to
+   *            file has failed
+   */
+  virtual void flush() noexcept(false);
+  /**
+   * Non-throwing variant of ::libathome_common::File::flush().
+   *
+   * @return Failed if writing to file has failed
+   */
+  virtual Status flush(const std::nothrow_t&);
+
+  /**
+   * Re-open the file if it was deleted or replaced on the
+   * filesystem.
+   *
+   * Long-living handles, such like the one of
+   * ::libathome_common::Logger, would write into a deleted or
+   * renamed file (i.e. moved away by an external log-rotation)
+   * forever.  This method compares the opened handle with the file
+   * at ::libathome_common::File::File() `path`.  If they differ then
+   * the file will be closed and re-opened with the same
+   * ::libathome_common::File::access_t.  Does nothing if the file is
+   * closed or an externally managed filestream.
+   *
+   * @return `true` if the file was re-opened
+   * @exception ::libathome_common::Error will be thrown if the file
+   *            could not be re-opened
+   */
+  virtual bool reopen_if_moved() noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::reopen_if_moved().
+   *
+   * @return `true` if the file was re-opened, failed if the file
+   *         could not be re-opened
+   */
+  virtual Result<bool> reopen_if_moved(const std::nothrow_t&);
+
   /**
    * Write string to file.
    *
@@ -140,14 +322,294 @@ public:
    */
   virtual void printf(const char* fmt, ...) const noexcept(false)
     __attribute__((format (printf, 2, 3)));
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::printf(const char*, ...).
+   *
+   * @param fmt `printf()`-like format string
+   * @param ... Arguments of `fmt` string
+   * @return Failed if writing to file has failed
+   */
+  virtual Status printf(const std::nothrow_t&, const char* fmt, ...)
+    const __attribute__((format (printf, 3, 4)));
   /**
    * Write string to file.
    *
+   * Written as raw bytes, without parsing a format string, so
+   * `output` may contain `'\0'` characters.
+   *
    * @param output String which should be logged
    * @exception ::libathome_common::Error will be thrown if writing to
    *            file has failed
    */
   virtual void print(const std::string& output) const noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::print(const std::string&).
+   *
+   * @param output String which should be logged
+   * @return Failed if writing to file has failed
+   */
+  virtual Status print(const std::string& output, const std::nothrow_t&)
+    const;
+  /**
+   * Write raw bytes to file.
+   *
+   * Unlike ::libathome_common::File::printf() the data may contain
+   * `'\0'` characters, such like binary records.
+   *
+   * @param data The bytes to write
+   * @param length Number of bytes in `data`
+   * @exception ::libathome_common::Error will be thrown if writing to
+   *            file has failed
+   */
+  virtual void write(const void* data, size_t length) const
+    noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::write(const void*, size_t).
+   *
+   * @param data The bytes to write
+   * @param length Number of bytes in `data`
+   * @return Failed if writing to file has failed
+   */
+  virtual Status write(const void* data, size_t length,
+    const std::nothrow_t&) const;
+  /**
+   * Write several buffers to file, such like many small records.
+   *
+   * The buffers are copied into the write buffer of
+   * ::libathome_common::File::set_buffer() and written with one
+   * syscall per full buffer.  If all together are not smaller than
+   * the write buffer, then it will be flushed and the buffers will be
+   * written directly with `writev()`, without copying.
+   *
+   * @param spans The buffers to write, in this order
+   * @param count Number of `spans`
+   * @exception ::libathome_common::Error will be thrown if writing to
+   *            file has failed
+   */
+  virtual void writev(const File::span_t* spans, size_t count) const
+    noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::writev(const File::span_t*, size_t).
+   *
+   * @param spans The buffers to write, in this order
+   * @param count Number of `spans`
+   * @return Failed if writing to file has failed
+   */
+  virtual Status writev(const File::span_t* spans, size_t count,
+    const std::nothrow_t&) const;
+
+  /**
+   * Read raw bytes from file.
+   *
+   * @param data Output buffer
+   * @param length Maximum number of bytes to read into `data`
+   * @return Number of bytes which were read, less than `length` only
+   *         at the end of the file
+   * @exception ::libathome_common::Error will be thrown if the file is
+   *            not opened for read-access or reading has failed
+   */
+  virtual size_t read(void* data, size_t length) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::read(void*, size_t).
+   *
+   * @param data Output buffer
+   * @param length Maximum number of bytes to read into `data`
+   * @return Number of bytes which were read, failed if reading has
+   *         failed
+   */
+  virtual Result<size_t> read(void* data, size_t length,
+    const std::nothrow_t&);
+  /**
+   * Streaming read of files which are too large to map.
+   *
+   * Reads the next chunk into a buffer of the instance, so it costs
+   * one copy but only one `read()` syscall per chunk.
+   *
+   * @param max Maximum length of the span, `0` for the size of the
+   *            buffer, see ::libathome_common::File::set_buffer()
+   * @return The next bytes of the file.  Valid until the next call
+   *         or ::libathome_common::File::close().  Empty at the end of
+   *         the file.
+   * @exception ::libathome_common::Error will be thrown if the file is
+   *            not opened for read-access or reading has failed
+   */
+  virtual File::span_t read_span(size_t max = 0) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::read_span(size_t).
+   *
+   * @param max Maximum length of the span, `0` for the size of the
+   *            buffer
+   * @return The next bytes of the file, failed if reading has failed
+   */
+  virtual Result<File::span_t> read_span(size_t max,
+    const std::nothrow_t&);
+
+  /**
+   * Map the whole file read-only into memory.
+   *
+   * No data will be copied, the pages are read on first access.  The
+   * file must be opened with ::libathome_common::File::read_e and must
+   * not be truncated while it is mapped.  Mapping twice returns the
+   * same view.
+   *
+   * @param advice Expected access pattern
+   * @return The content of the file.  Valid until
+   *         ::libathome_common::File::unmap() or
+   *         ::libathome_common::File::close().
+   * @exception ::libathome_common::Error will be thrown if the file is
+   *            not opened for read-access or could not be mapped, such
+   *            like pipes
+   */
+  virtual File::span_t map(File::advice_t advice = sequential_e)
+    noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::map(File::advice_t).
+   *
+   * @param advice Expected access pattern
+   * @return The content of the file, failed if it could not be mapped
+   */
+  virtual Result<File::span_t> map(File::advice_t advice,
+    const std::nothrow_t&);
+  /**
+   * Change the expected access pattern of a part of the mapped file.
+   *
+   * Such like ::libathome_common::File::willneed_e for the next part
+   * which will be processed and ::libathome_common::File::dontneed_e
+   * for the finished one.  `offset` will be rounded down to the page
+   * size, the range will be clipped to the file.
+   *
+   * @param offset Begin of the part, in bytes
+   * @param length Length of the part, in bytes
+   * @param advice Expected access pattern
+   * @exception ::libathome_common::Error will be thrown if the file
+   *            is not mapped or `madvise()` has failed
+   */
+  virtual void advise(size_t offset, size_t length,
+    File::advice_t advice) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::advise(size_t, size_t, File::advice_t).
+   *
+   * @param offset Begin of the part, in bytes
+   * @param length Length of the part, in bytes
+   * @param advice Expected access pattern
+   * @return Failed if the file is not mapped or `madvise()` has failed
+   */
+  virtual Status advise(size_t offset, size_t length,
+    File::advice_t advice, const std::nothrow_t&);
+  /**
+   * Remove the mapping of ::libathome_common::File::map().
+   *
+   * Called by ::libathome_common::File::close(), ignored if the file
+   * is not mapped.
+   */
+  virtual void unmap();
+
+  /**
+   * Prepares reading with ::libathome_common::AsyncIO, see
+   * ::libathome_common::AsyncIO::read().
+   *
+   * It does not change the position of
+   * ::libathome_common::File::read().
+   *
+   * @param io The engine which should do the I/O
+   * @param data Output buffer, must stay valid until completed
+   * @param length Number of bytes to read
+   * @param offset Position in the file
+   * @param tag Returned with the completion
+   * @return `false` if `io` has no free slot
+   * @exception ::libathome_common::Error will be thrown if the file is
+   *            not opened for read-access
+   */
+  virtual bool read_async(AsyncIO& io, void* data, size_t length,
+    uint64_t offset, uint64_t tag) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::read_async(AsyncIO&, void*, size_t,
+   * uint64_t, uint64_t).
+   *
+   * @param io The engine which should do the I/O
+   * @param data Output buffer, must stay valid until completed
+   * @param length Number of bytes to read
+   * @param offset Position in the file
+   * @param tag Returned with the completion
+   * @return `false` if `io` has no free slot, failed if the file is
+   *         not opened for read-access
+   */
+  virtual Result<bool> read_async(AsyncIO& io, void* data, size_t length,
+    uint64_t offset, uint64_t tag, const std::nothrow_t&);
+  /**
+   * Prepares writing with ::libathome_common::AsyncIO, see
+   * ::libathome_common::AsyncIO::write().
+   *
+   * The write buffer will be flushed before, so buffered data reaches
+   * the operating system first.  Files opened with
+   * ::libathome_common::File::append_e ignore `offset` and append.
+   *
+   * @param io The engine which should do the I/O
+   * @param data The bytes to write, must stay valid until completed
+   * @param length Number of bytes to write
+   * @param offset Position in the file
+   * @param tag Returned with the completion
+   * @return `false` if `io` has no free slot
+   * @exception ::libathome_common::Error will be thrown if the file is
+   *            not opened for write- or append-access or flushing has
+   *            failed
+   */
+  virtual bool write_async(AsyncIO& io, const void* data, size_t length,
+    uint64_t offset, uint64_t tag) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::write_async(AsyncIO&, const void*,
+   * size_t, uint64_t, uint64_t).
+   *
+   * @param io The engine which should do the I/O
+   * @param data The bytes to write, must stay valid until completed
+   * @param length Number of bytes to write
+   * @param offset Position in the file
+   * @param tag Returned with the completion
+   * @return `false` if `io` has no free slot, failed if the file is
+   *         not opened for write- or append-access or flushing has
+   *         failed
+   */
+  virtual Result<bool> write_async(AsyncIO& io, const void* data,
+    size_t length, uint64_t offset, uint64_t tag, const std::nothrow_t&);
+  /**
+   * Prepares flushing the file to the disk with
+   * ::libathome_common::AsyncIO, see
+   * ::libathome_common::AsyncIO::fsync().
+   *
+   * The write buffer will be flushed before.
+   *
+   * @param io The engine which should do the I/O
+   * @param tag Returned with the completion
+   * @param datasync `true` to skip metadata which is not needed to
+   *                 read the data, like `fdatasync()`
+   * @return `false` if `io` has no free slot
+   * @exception ::libathome_common::Error will be thrown if the file is
+   *            not opened or flushing has failed
+   */
+  virtual bool sync_async(AsyncIO& io, uint64_t tag,
+    bool datasync = false) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::sync_async(AsyncIO&, uint64_t, bool).
+   *
+   * @param io The engine which should do the I/O
+   * @param tag Returned with the completion
+   * @param datasync `true` to skip metadata, like `fdatasync()`
+   * @return `false` if `io` has no free slot, failed if the file is
+   *         not opened or flushing has failed
+   */
+  virtual Result<bool> sync_async(AsyncIO& io, uint64_t tag,
+    bool datasync, const std::nothrow_t&);
 
 protected:
   /**
@@ -160,6 +622,16 @@ protected:
    */
   virtual void vprintf(const char* fmt, ::va_list ap)
     const noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::File::vprintf(const char*, ::va_list).
+   *
+   * @param fmt `printf()`-like format string
+   * @param ap Arguments of `fmt` string as `va_list`
+   * @return Failed if writing to file has failed
+   */
+  virtual Status vprintf(const char* fmt, ::va_list ap,
+    const std::nothrow_t&) const;
 
 private:
   ::FILE* extern_fstream;
@@ -187,6 +659,39 @@ private:
    */
   File::access_t mode;
 
+  /**
+   * Size of ::libathome_common::File::buffer, `0` for C library
+   * default.
+   */
+  size_t buffer_size;
+  /**
+   * Passed to `setvbuf()`, must live longer than the opened
+   * ::libathome_common::File::fstream.
+   */
+  std::vector<char> buffer;
+  /**
+   * Chunks of ::libathome_common::File::read_span().
+   */
+  std::vector<char> read_buffer;
+
+  /**
+   * `true` between ::libathome_common::File::map() and
+   * ::libathome_common::File::unmap().  `map_data` is `NULL` for
+   * empty files, they can't be mapped.
+   */
+  bool mapped;
+  void* map_data;
+  size_t map_length;
+
+  /** Buffers per `writev()` syscall, the minimum of `IOV_MAX`  */
+  static const size_t _WRITEV_MAX = 1024;
+
+  static int _madvise_advice(File::advice_t advice);
+  static Status _sync(int fd, const std::string& name);
+
+  std::string _get_filename_tmp() const;
+  bool _is_writable() const;
+
 }; /* class File  */
 
 } /* namespace libathome_common  */
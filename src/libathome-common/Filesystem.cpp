@@ -20,7 +20,9 @@
 #include "libathome-common/Error.hpp"
 
 #include <sys/stat.h>
+#include <dirent.h>
 #include <cerrno>
+#include <algorithm>
 
 
 #ifndef OSWIN
@@ -33,9 +35,20 @@ const char* libathome_common::Filesystem::PATH_DOT = ".";
 const char* libathome_common::Filesystem::PATH_DOTDOT = "..";
 const unsigned libathome_common::Filesystem::_UMODE_DEFAULT = 0777;
 
+/* Constant-initialized, so it may be used during static
+ * initialization of other translation units
+ */
+std::mutex libathome_common::Filesystem::_known_dirs_mutex;
+
 
 bool libathome_common::Filesystem::
 mkdir(const std::string& path) noexcept(false)
+{
+  return Filesystem::mkdir(path, std::nothrow).get();
+}
+
+libathome_common::Result<bool> libathome_common::Filesystem::
+mkdir(const std::string& path, const std::nothrow_t&)
 {
 #ifndef OSWIN
   int mkdir_res = ::mkdir(path.c_str(), Filesystem::_UMODE_DEFAULT);
@@ -44,11 +57,214 @@ mkdir(const std::string& path) noexcept(false)
 #endif /* ifndef OSWIN  */
 
   if (0 != mkdir_res) {
-    if (errno == EEXIST) return false;
+    int code = errno;
+    if (code == EEXIST) return false;
 
-    throw Err("Could not create directory '%s': %s!", path.c_str(),
-              ::strerror(errno));
+    return ErrStatus(code, "Could not create directory '%s': %s!",
+                     path.c_str(), ::strerror(code));
   }
 
   return true;
 }
+
+std::unordered_set<std::string>& libathome_common::Filesystem::
+_known_dirs()
+{
+  /* Constructed on first use, for the same reason  */
+  static std::unordered_set<std::string> known_dirs;
+
+  return known_dirs;
+}
+
+std::string libathome_common::Filesystem::
+_strip_seperators(const std::string& path)
+{
+  size_t end = path.length();
+  while (end > 1 && (path[end-1] == '/'
+                     || path[end-1] == Filesystem::PATH_SEPERATOR[0])) {
+    end--;
+  }
+
+  return path.substr(0, end);
+}
+
+bool libathome_common::Filesystem::
+mkdir_p(const std::string& path) noexcept(false)
+{
+  return Filesystem::mkdir_p(path, std::nothrow).get();
+}
+
+libathome_common::Result<bool> libathome_common::Filesystem::
+mkdir_p(const std::string& path, const std::nothrow_t&)
+{
+  std::string dir = Filesystem::_strip_seperators(path);
+  if (dir.empty()) return false;
+
+  {
+    std::lock_guard<std::mutex> lock(Filesystem::_known_dirs_mutex);
+    if (Filesystem::_known_dirs().count(dir) > 0) return false;
+  }
+
+  /* Optimistic, usually the parent does exist  */
+  Result<bool> mkdir_res = Filesystem::mkdir(dir, std::nothrow);
+  if (!mkdir_res && mkdir_res.get_status().get_code() == ENOENT) {
+    size_t pos = dir.find_last_of(std::string("/") + PATH_SEPERATOR);
+    if (pos != std::string::npos && pos > 0) {
+      std::string parent = dir.substr(0, pos);
+      Result<bool> parent_res = Filesystem::mkdir_p(parent, std::nothrow);
+      if (!parent_res) return parent_res;
+      mkdir_res = Filesystem::mkdir(dir, std::nothrow);
+
+      /* The cached parent was removed meanwhile  */
+      if (!mkdir_res && mkdir_res.get_status().get_code() == ENOENT) {
+        Filesystem::forget_dir(parent);
+        parent_res = Filesystem::mkdir_p(parent, std::nothrow);
+        if (!parent_res) return parent_res;
+        mkdir_res = Filesystem::mkdir(dir, std::nothrow);
+      }
+    }
+  }
+  if (!mkdir_res) return mkdir_res;
+
+  /* Once per directory, it's cached afterwards  */
+  if (!mkdir_res.get()) {
+    struct ::stat dir_stat;
+    if (0 != ::stat(dir.c_str(), &dir_stat)) {
+      int code = errno;
+      return ErrStatus(code, "Could not stat '%s': %s!", dir.c_str(),
+                       ::strerror(code));
+    }
+    if (!S_ISDIR(dir_stat.st_mode)) {
+      return ErrStatus(ENOTDIR, "Could not create directory '%s': %s!",
+                       dir.c_str(), ::strerror(ENOTDIR));
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(Filesystem::_known_dirs_mutex);
+  Filesystem::_known_dirs().insert(std::move(dir));
+
+  return mkdir_res;
+}
+
+size_t libathome_common::Filesystem::
+mkdir_tree(const std::vector<std::string>& paths) noexcept(false)
+{
+  return Filesystem::mkdir_tree(paths, std::nothrow).get();
+}
+
+libathome_common::Result<size_t> libathome_common::Filesystem::
+mkdir_tree(const std::vector<std::string>& paths, const std::nothrow_t&)
+{
+  /* Parents before their children, then no MKDIR() fails with ENOENT
+   * more than once per missing parent
+   */
+  std::vector<const std::string*> sorted;
+  sorted.reserve(paths.size());
+  for (const std::string& path: paths) sorted.push_back(&path);
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::string* a, const std::string* b) {
+              return *a < *b;
+            });
+
+  size_t created = 0;
+  for (const std::string* path: sorted) {
+    Result<bool> mkdir_res = Filesystem::mkdir_p(*path, std::nothrow);
+    if (!mkdir_res) return mkdir_res.get_status();
+    if (mkdir_res.get()) created++;
+  }
+
+  return created;
+}
+
+void libathome_common::Filesystem::
+forget_dir(const std::string& path)
+{
+  std::string dir = Filesystem::_strip_seperators(path);
+
+  std::lock_guard<std::mutex> lock(Filesystem::_known_dirs_mutex);
+  std::unordered_set<std::string>& known_dirs = Filesystem::_known_dirs();
+
+  for (auto it = known_dirs.begin(); it != known_dirs.end(); ) {
+    bool is_sub = it->length() > dir.length()
+      && 0 == it->compare(0, dir.length(), dir)
+      && ((*it)[dir.length()] == '/'
+          || (*it)[dir.length()] == Filesystem::PATH_SEPERATOR[0]);
+
+    if (*it == dir || is_sub) it = known_dirs.erase(it);
+    else ++it;
+  }
+}
+
+std::vector<std::string> libathome_common::Filesystem::
+list(const std::string& path) noexcept(false)
+{
+  return std::move(Filesystem::list(path, std::nothrow).get());
+}
+
+libathome_common::Result<std::vector<std::string>>
+libathome_common::Filesystem::
+list(const std::string& path, const std::nothrow_t&)
+{
+  ::DIR* dir = ::opendir(path.c_str());
+  if (dir == NULL) {
+    int code = errno;
+    return ErrStatus(code, "Could not open directory '%s': %s!",
+                     path.c_str(), ::strerror(code));
+  }
+
+  std::vector<std::string> result;
+
+  ::dirent* entry;
+  while ((entry = ::readdir(dir)) != NULL) {
+    if (0 == ::strcmp(entry->d_name, Filesystem::PATH_DOT)
+        || 0 == ::strcmp(entry->d_name, Filesystem::PATH_DOTDOT))
+      continue;
+
+    result.push_back(entry->d_name);
+  }
+
+  ::closedir(dir);
+  return result;
+}
+
+void libathome_common::Filesystem::
+remove(const std::string& path) noexcept(false)
+{
+  Filesystem::remove(path, std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::Filesystem::
+remove(const std::string& path, const std::nothrow_t&)
+{
+  if (0 != ::remove(path.c_str())) {
+    int code = errno;
+    return ErrStatus(code, "Could not remove '%s': %s!", path.c_str(),
+                     ::strerror(code));
+  }
+
+  return Status();
+}
+
+void libathome_common::Filesystem::
+rename(const std::string& from, const std::string& to) noexcept(false)
+{
+  Filesystem::rename(from, to, std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::Filesystem::
+rename(const std::string& from, const std::string& to,
+  const std::nothrow_t&)
+{
+#ifdef OSWIN
+  /* RENAME() does not replace existing files on Windows  */
+  ::remove(to.c_str());
+#endif /* ifdef OSWIN  */
+
+  if (0 != ::rename(from.c_str(), to.c_str())) {
+    int code = errno;
+    return ErrStatus(code, "Could not rename '%s' to '%s': %s!",
+                     from.c_str(), to.c_str(), ::strerror(code));
+  }
+
+  return Status();
+}
@@ -24,6 +24,11 @@
  */
 
 #include "libathome-common/Common.hpp"
+#include "libathome-common/Result.hpp"
+
+#include <vector>
+#include <mutex>
+#include <unordered_set>
 
 namespace libathome_common
 {
@@ -73,6 +78,151 @@ public:
    *            occurs, such like no permission, etc
    */
   static bool mkdir(const std::string& path) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::Filesystem::mkdir(const std::string&).
+   *
+   * @param path The path (relative or absolute) where to create the
+   *             directory
+   * @return `true` on success, `false` if directory does already
+   *         exist.  Failed on error, such like no permission, etc
+   */
+  static Result<bool> mkdir(const std::string& path,
+    const std::nothrow_t&);
+
+  /**
+   * Creates the directory `path` and all missing parents.
+   *
+   * Directories which were created or found are kept in a
+   * process-wide cache, so creating them again costs no syscall.
+   * Uncached directories cost one `mkdir()` if the parent exists.
+   * Thread-safe.
+   *
+   * If a cached directory gets removed, then call
+   * ::libathome_common::Filesystem::forget_dir().
+   *
+   * @param path The path (relative or absolute) of the directory
+   * @return `true` if `path` was created, `false` if it did already
+   *         exist
+   * @exception ::libathome_common::Error will be thrown if an error
+   *            occurs, such like no permission or a part of `path` is
+   *            a file
+   */
+  static bool mkdir_p(const std::string& path) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::Filesystem::mkdir_p(const std::string&).
+   *
+   * @param path The path (relative or absolute) of the directory
+   * @return `true` if `path` was created, `false` if it did already
+   *         exist.  Failed on error.
+   */
+  static Result<bool> mkdir_p(const std::string& path,
+    const std::nothrow_t&);
+  /**
+   * Creates many directories by
+   * ::libathome_common::Filesystem::mkdir_p(), in one pass.
+   *
+   * Meant for sharded trees, such like `results/00/00` to
+   * `results/ff/ff`.  `paths` will be created in sorted order, so
+   * every parent is created once and then found in the cache.  Then
+   * every new directory costs one `mkdir()`.
+   *
+   * @param paths The directories to create
+   * @return Number of created directories of `paths`
+   * @exception ::libathome_common::Error will be thrown on the first
+   *            error, the directories before were created
+   */
+  static size_t mkdir_tree(const std::vector<std::string>& paths)
+    noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::Filesystem::mkdir_tree(const std::vector<std::string>&).
+   *
+   * @param paths The directories to create
+   * @return Number of created directories of `paths`, failed on the
+   *         first error
+   */
+  static Result<size_t> mkdir_tree(const std::vector<std::string>& paths,
+    const std::nothrow_t&);
+  /**
+   * Removes `path` and its subdirectories from the cache of
+   * ::libathome_common::Filesystem::mkdir_p().
+   *
+   * Must be called after removing a directory, otherwise
+   * ::libathome_common::Filesystem::mkdir_p() would not create it
+   * again.
+   *
+   * @param path The directory as passed to
+   *             ::libathome_common::Filesystem::mkdir_p()
+   */
+  static void forget_dir(const std::string& path);
+
+  /**
+   * Lists all entries of the directory `path`.
+   *
+   * The entries ::libathome_common::Filesystem::PATH_DOT and
+   * ::libathome_common::Filesystem::PATH_DOTDOT will be skipped.  The
+   * result is not sorted.
+   *
+   * @param path The directory to list
+   * @return The names of all entries, without `path` prefix
+   * @exception ::libathome_common::Error will be thrown if the
+   *            directory could not be opened
+   */
+  static std::vector<std::string> list(const std::string& path)
+    noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::Filesystem::list(const std::string&).
+   *
+   * @param path The directory to list
+   * @return The names of all entries, failed if the directory could
+   *         not be opened
+   */
+  static Result<std::vector<std::string>> list(const std::string& path,
+    const std::nothrow_t&);
+
+  /**
+   * Removes the file `path`.
+   *
+   * @param path The file to remove
+   * @exception ::libathome_common::Error will be thrown if the file
+   *            could not be removed
+   */
+  static void remove(const std::string& path) noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::Filesystem::remove(const std::string&).
+   *
+   * @param path The file to remove
+   * @return Failed if the file could not be removed
+   */
+  static Status remove(const std::string& path, const std::nothrow_t&);
+
+  /**
+   * Renames the file `from` to `to`.
+   *
+   * Replaces `to` if it already exists.  On POSIX systems this is
+   * atomic, so readers see either the old or the new file.
+   *
+   * @param from The file to rename
+   * @param to The new path
+   * @exception ::libathome_common::Error will be thrown if the file
+   *            could not be renamed
+   */
+  static void rename(const std::string& from, const std::string& to)
+    noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::Filesystem::rename(const std::string&, const std::string&).
+   *
+   * @param from The file to rename
+   * @param to The new path
+   * @return Failed if the file could not be renamed
+   */
+  static Status rename(const std::string& from, const std::string& to,
+    const std::nothrow_t&);
 
 private:
   /**
@@ -84,6 +234,12 @@ private:
    */
   static const unsigned _UMODE_DEFAULT;
 
+  /** Cache of ::libathome_common::Filesystem::mkdir_p()  */
+  static std::mutex _known_dirs_mutex;
+  static std::unordered_set<std::string>& _known_dirs();
+
+  static std::string _strip_seperators(const std::string& path);
+
   virtual void _abstract_class() = 0;
 }; /* class Filesystem  */
 
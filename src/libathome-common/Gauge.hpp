@@ -0,0 +1,90 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_GAUGE_H__
+#define LIBATHOME_COMMON_GAUGE_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::Gauge.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <atomic>
+
+namespace libathome_common
+{
+
+/**
+ * Metric which can go up and down, such like queued tasks.
+ *
+ * Usually created by ::libathome_common::Metrics::gauge().
+ */
+class Gauge
+{
+public:
+  /**
+   * Constructs a gauge, starting at `0`.
+   */
+  explicit Gauge();
+  /**
+   * Default destructor.
+   */
+  virtual ~Gauge();
+
+  /**
+   * Sets the value.
+   *
+   * Thread-safe, lock-free and does not allocate.
+   *
+   * @param value The new value
+   */
+  void set(int64_t value)
+  {
+    this->value.store(value, std::memory_order_relaxed);
+  }
+  /**
+   * Adds to the value.
+   *
+   * Thread-safe, lock-free and does not allocate.
+   *
+   * @param value Increment, may be negative
+   */
+  void add(int64_t value = 1)
+  {
+    this->value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the current value.
+   *
+   * @return The value
+   */
+  virtual int64_t get() const;
+
+private:
+  std::atomic<int64_t> value;
+
+  Gauge(const Gauge&) = delete;
+  Gauge& operator=(const Gauge&) = delete;
+
+}; /* class Gauge  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_GAUGE_H__  */
@@ -0,0 +1,186 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-common/Histogram.hpp"
+
+#include <limits>
+
+
+uint64_t libathome_common::Histogram::
+bucket_lower(unsigned bucket)
+{
+  if (bucket < Histogram::SUB_BUCKETS) return bucket;
+
+  unsigned shift = (bucket - Histogram::SUB_BUCKETS) / Histogram::SUB_BUCKETS;
+  uint64_t sub = (bucket - Histogram::SUB_BUCKETS) % Histogram::SUB_BUCKETS;
+
+  return (Histogram::SUB_BUCKETS + sub) << shift;
+}
+
+uint64_t libathome_common::Histogram::
+bucket_upper(unsigned bucket)
+{
+  if (bucket < Histogram::SUB_BUCKETS) return bucket;
+  if (bucket >= Histogram::BUCKETS - 1)
+    return std::numeric_limits<uint64_t>::max();
+
+  return Histogram::bucket_lower(bucket + 1) - 1;
+}
+
+/* ***************************************************************  */
+
+libathome_common::Histogram::
+Histogram()
+{
+  this->reset();
+}
+
+libathome_common::Histogram::
+~Histogram()
+{
+}
+
+void libathome_common::Histogram::
+merge(const Histogram& other)
+{
+  for (unsigned i=0; i<Histogram::BUCKETS; i++) {
+    uint64_t count = other.buckets[i].load(std::memory_order_relaxed);
+    if (count > 0)
+      this->buckets[i].fetch_add(count, std::memory_order_relaxed);
+  }
+
+  uint64_t count = other.count.load(std::memory_order_relaxed);
+  if (count == 0) return;
+
+  this->count.fetch_add(count, std::memory_order_relaxed);
+  this->sum.fetch_add(
+    other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+  uint64_t value = other.min.load(std::memory_order_relaxed);
+  uint64_t cur = this->min.load(std::memory_order_relaxed);
+  while (value < cur && !this->min.compare_exchange_weak(
+           cur, value, std::memory_order_relaxed)) {}
+  value = other.max.load(std::memory_order_relaxed);
+  cur = this->max.load(std::memory_order_relaxed);
+  while (value > cur && !this->max.compare_exchange_weak(
+           cur, value, std::memory_order_relaxed)) {}
+}
+
+void libathome_common::Histogram::
+reset()
+{
+  for (unsigned i=0; i<Histogram::BUCKETS; i++)
+    this->buckets[i].store(0, std::memory_order_relaxed);
+
+  this->count.store(0, std::memory_order_relaxed);
+  this->sum.store(0, std::memory_order_relaxed);
+  this->min.store(
+    std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+  this->max.store(0, std::memory_order_relaxed);
+}
+
+/* ***************************************************************  */
+
+uint64_t libathome_common::Histogram::
+get_count() const
+{
+  return this->count.load(std::memory_order_relaxed);
+}
+
+uint64_t libathome_common::Histogram::
+get_sum() const
+{
+  return this->sum.load(std::memory_order_relaxed);
+}
+
+uint64_t libathome_common::Histogram::
+get_min() const
+{
+  uint64_t result = this->min.load(std::memory_order_relaxed);
+
+  return result == std::numeric_limits<uint64_t>::max()? 0: result;
+}
+
+uint64_t libathome_common::Histogram::
+get_max() const
+{
+  return this->max.load(std::memory_order_relaxed);
+}
+
+double libathome_common::Histogram::
+get_mean() const
+{
+  uint64_t count = this->get_count();
+
+  return count == 0? 0.0: (double) this->get_sum() / count;
+}
+
+uint64_t libathome_common::Histogram::
+get_percentile(double percentile) const
+{
+  /* Sum up the buckets, COUNT may be ahead of them while recording  */
+  uint64_t total = 0;
+  for (unsigned i=0; i<Histogram::BUCKETS; i++)
+    total += this->buckets[i].load(std::memory_order_relaxed);
+  if (total == 0) return 0;
+
+  if (percentile < 0.0) percentile = 0.0;
+  if (percentile > 100.0) percentile = 100.0;
+
+  uint64_t rank = (uint64_t) (percentile / 100.0 * total + 0.5);
+  if (rank == 0) rank = 1;
+
+  uint64_t seen = 0;
+  unsigned bucket = 0;
+  for (; bucket<Histogram::BUCKETS; bucket++) {
+    seen += this->buckets[bucket].load(std::memory_order_relaxed);
+    if (seen >= rank) break;
+  }
+
+  uint64_t result = Histogram::bucket_upper(bucket);
+  uint64_t max = this->get_max();
+  return result < max? result: max;
+}
+
+uint64_t libathome_common::Histogram::
+get_bucket(unsigned bucket) const
+{
+  if (bucket >= Histogram::BUCKETS) return 0;
+
+  return this->buckets[bucket].load(std::memory_order_relaxed);
+}
+
+std::string libathome_common::Histogram::
+to_string(uint64_t unit_divisor) const
+{
+  if (unit_divisor == 0) unit_divisor = 1;
+
+  string_t buf;
+  ::snprintf(buf, STRING_LEN,
+    "count=%llu min=%llu p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu",
+    (unsigned long long) this->get_count(),
+    (unsigned long long) (this->get_min() / unit_divisor),
+    (unsigned long long) (this->get_percentile(50.0) / unit_divisor),
+    (unsigned long long) (this->get_percentile(90.0) / unit_divisor),
+    (unsigned long long) (this->get_percentile(99.0) / unit_divisor),
+    (unsigned long long) (this->get_percentile(99.9) / unit_divisor),
+    (unsigned long long) (this->get_max() / unit_divisor));
+
+  return std::string(buf);
+}
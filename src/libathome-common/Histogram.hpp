@@ -0,0 +1,213 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_HISTOGRAM_H__
+#define LIBATHOME_COMMON_HISTOGRAM_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::Histogram.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <atomic>
+
+namespace libathome_common
+{
+
+/**
+ * Lock-free log-linear histogram of `uint64_t` values, such like
+ * latencies in nanoseconds.
+ *
+ * Like HDR histograms, every power of two is split into
+ * ::libathome_common::Histogram::SUB_BUCKETS linear buckets.  So the
+ * relative error of a percentile is below `1/16`, for the whole range
+ * of `uint64_t` and with a fixed size of about 8 KiB.  Values below
+ * ::libathome_common::Histogram::SUB_BUCKETS are counted exactly.
+ *
+ * ::libathome_common::Histogram::record() is thread-safe, lock-free
+ * and does not allocate, so it can be used in hot paths.  Reading
+ * while other threads are recording returns a consistent enough
+ * snapshot for monitoring purposes.
+ */
+class Histogram
+{
+public:
+  /**
+   * Number of linear buckets per power of two.
+   */
+  static const unsigned SUB_BUCKETS = 16;
+  /**
+   * Total number of buckets.
+   */
+  static const unsigned BUCKETS = SUB_BUCKETS + (64 - 4) * SUB_BUCKETS;
+
+  /**
+   * Returns the bucket which counts `value`.
+   *
+   * @param value The value
+   * @return Index of the bucket, `[0, BUCKETS)`
+   */
+  static unsigned bucket_of(uint64_t value)
+  {
+    if (value < Histogram::SUB_BUCKETS) return (unsigned) value;
+
+    /* Position of the highest bit, at least 4  */
+    unsigned msb = 63 - ::__builtin_clzll(value);
+    unsigned shift = msb - 4;
+
+    return Histogram::SUB_BUCKETS + shift * Histogram::SUB_BUCKETS
+      + (unsigned) ((value >> shift) - Histogram::SUB_BUCKETS);
+  }
+  /**
+   * Returns the smallest value of a bucket.
+   *
+   * @param bucket Index of the bucket, `[0, BUCKETS)`
+   * @return The smallest value which is counted by `bucket`
+   */
+  static uint64_t bucket_lower(unsigned bucket);
+  /**
+   * Returns the largest value of a bucket.
+   *
+   * @param bucket Index of the bucket, `[0, BUCKETS)`
+   * @return The largest value which is counted by `bucket`
+   */
+  static uint64_t bucket_upper(unsigned bucket);
+
+  /**
+   * Constructs an empty histogram.
+   */
+  explicit Histogram();
+  /**
+   * Default destructor.
+   */
+  virtual ~Histogram();
+
+  /**
+   * Counts a value.
+   *
+   * Thread-safe, lock-free and does not allocate.  Not `virtual`, to
+   * be inlined in hot paths.
+   *
+   * @param value The value to count
+   * @param count How often to count it
+   */
+  void record(uint64_t value, uint64_t count = 1)
+  {
+    this->buckets[Histogram::bucket_of(value)]
+      .fetch_add(count, std::memory_order_relaxed);
+    this->count.fetch_add(count, std::memory_order_relaxed);
+    this->sum.fetch_add(value * count, std::memory_order_relaxed);
+
+    /* Usually no store needed, after warm-up  */
+    uint64_t cur = this->min.load(std::memory_order_relaxed);
+    while (value < cur && !this->min.compare_exchange_weak(
+             cur, value, std::memory_order_relaxed)) {}
+    cur = this->max.load(std::memory_order_relaxed);
+    while (value > cur && !this->max.compare_exchange_weak(
+             cur, value, std::memory_order_relaxed)) {}
+  }
+
+  /**
+   * Adds all values of `other` to this histogram.
+   *
+   * @param other Histogram to add
+   */
+  virtual void merge(const Histogram& other);
+  /**
+   * Removes all values.
+   *
+   * Values which are recorded concurrently may get lost.
+   */
+  virtual void reset();
+
+  /**
+   * Returns the number of counted values.
+   *
+   * @return Number of values
+   */
+  virtual uint64_t get_count() const;
+  /**
+   * Returns the sum of all counted values.
+   *
+   * @return Sum, wraps around on overflow
+   */
+  virtual uint64_t get_sum() const;
+  /**
+   * Returns the smallest counted value.
+   *
+   * @return Smallest value, `0` if empty
+   */
+  virtual uint64_t get_min() const;
+  /**
+   * Returns the largest counted value.
+   *
+   * @return Largest value, `0` if empty
+   */
+  virtual uint64_t get_max() const;
+  /**
+   * Returns the average of all counted values.
+   *
+   * @return Average, `0.0` if empty
+   */
+  virtual double get_mean() const;
+  /**
+   * Returns the value which is greater than or equal to `percentile`
+   * percent of all counted values.
+   *
+   * @param percentile Such like `50.0` for the median or `99.9`
+   * @return Upper bound of the bucket, but never more than
+   *         ::libathome_common::Histogram::get_max().  `0` if empty.
+   */
+  virtual uint64_t get_percentile(double percentile) const;
+  /**
+   * Returns how many values were counted in `bucket`.
+   *
+   * @param bucket Index of the bucket, `[0, BUCKETS)`
+   * @return Number of values in `bucket`
+   */
+  virtual uint64_t get_bucket(unsigned bucket) const;
+
+  /**
+   * Summary for log messages.
+   *
+   * Such like `"count=100 min=5 p50=10 p90=20 p99=40 max=41"`, with
+   * the values divided by `unit_divisor`.
+   *
+   * @param unit_divisor I.e. `1000` for microseconds if the values
+   *                     are nanoseconds
+   * @return The summary
+   */
+  virtual std::string to_string(uint64_t unit_divisor = 1) const;
+
+private:
+  std::atomic<uint64_t> buckets[BUCKETS];
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> sum;
+  std::atomic<uint64_t> min;
+  std::atomic<uint64_t> max;
+
+  /* Copying atomics is not possible, use merge()  */
+  Histogram(const Histogram&) = delete;
+  Histogram& operator=(const Histogram&) = delete;
+
+}; /* class Histogram  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_HISTOGRAM_H__  */
@@ -0,0 +1,447 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "libathome-common/Journal.hpp"
+#include "libathome-common/Error.hpp"
+#include "libathome-common/Filesystem.hpp"
+#include "libathome-common/File.hpp"
+
+#include <cerrno>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#if defined(__x86_64__)
+#  include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#  include <arm_acle.h>
+#endif
+#ifndef OSWIN
+#  include <unistd.h>
+#else /* ifndef OSWIN  */
+#  include <io.h>
+#endif /* ifndef OSWIN  */
+
+
+uint32_t libathome_common::Journal::
+crc32c(uint32_t crc, const void* data, size_t length)
+{
+  static const bool has_hw = Journal::_has_crc32c_hw();
+
+  crc = ~crc;
+  crc = has_hw
+    ? Journal::_crc32c_hw(crc, (const char*) data, length)
+    : Journal::_crc32c_table(crc, (const char*) data, length);
+
+  return ~crc;
+}
+
+bool libathome_common::Journal::
+_has_crc32c_hw()
+{
+#if defined(__x86_64__)
+  return __builtin_cpu_supports("sse4.2");
+#elif defined(__ARM_FEATURE_CRC32)
+  return true;
+#else
+  return false;
+#endif
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+#endif
+uint32_t libathome_common::Journal::
+_crc32c_hw(uint32_t crc, const char* data, size_t length)
+{
+#if defined(__x86_64__)
+  uint64_t crc64 = crc;
+  for (; length >= 8; data += 8, length -= 8) {
+    uint64_t word;
+    ::memcpy(&word, data, 8);
+    crc64 = ::_mm_crc32_u64(crc64, word);
+  }
+  crc = (uint32_t) crc64;
+  for (; length > 0; data++, length--)
+    crc = ::_mm_crc32_u8(crc, (uint8_t) *data);
+
+  return crc;
+#elif defined(__ARM_FEATURE_CRC32)
+  for (; length >= 8; data += 8, length -= 8) {
+    uint64_t word;
+    ::memcpy(&word, data, 8);
+    crc = ::__crc32cd(crc, word);
+  }
+  for (; length > 0; data++, length--)
+    crc = ::__crc32cb(crc, (uint8_t) *data);
+
+  return crc;
+#else
+  return Journal::_crc32c_table(crc, data, length);
+#endif
+}
+
+uint32_t libathome_common::Journal::
+_crc32c_table(uint32_t crc, const char* data, size_t length)
+{
+  /* Slicing-by-8, the tables are built on the first call  */
+  static const struct table_t {
+    uint32_t t[8][256];
+
+    table_t()
+    {
+      for (uint32_t i=0; i<256; i++) {
+        uint32_t c = i;
+        for (int k=0; k<8; k++) c = (c & 1)? (c >> 1) ^ 0x82f63b78: c >> 1;
+        this->t[0][i] = c;
+      }
+      for (uint32_t i=0; i<256; i++) {
+        for (int s=1; s<8; s++) {
+          this->t[s][i] = (this->t[s-1][i] >> 8)
+            ^ this->t[0][this->t[s-1][i] & 0xff];
+        }
+      }
+    }
+  } table;
+  const uint32_t (*t)[256] = table.t;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  for (; length >= 8; data += 8, length -= 8) {
+    uint32_t lo, hi;
+    ::memcpy(&lo, data, 4);
+    ::memcpy(&hi, data + 4, 4);
+    lo ^= crc;
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff]
+      ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+      ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff]
+      ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+  }
+#endif /* if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__  */
+  for (; length > 0; data++, length--)
+    crc = (crc >> 8) ^ t[0][(crc ^ (uint8_t) *data) & 0xff];
+
+  return crc;
+}
+
+/* ***************************************************************  */
+
+libathome_common::Journal::
+Journal(const std::string& path, const std::string& filename)
+  :path(path), filename(filename),
+   filename_full(path + Filesystem::PATH_SEPERATOR + filename),
+   truncated(0), fd(-1), syncing(false), appended(0), synced(0)
+{
+}
+
+libathome_common::Journal::
+~Journal()
+{
+  this->close();
+}
+
+const std::string& libathome_common::Journal::
+get_filename_full() const
+{
+  return this->filename_full;
+}
+
+uint64_t libathome_common::Journal::
+get_truncated() const
+{
+  return this->truncated;
+}
+
+/* ***************************************************************  */
+
+std::string libathome_common::Journal::
+_header()
+{
+  std::string header("LAHJ", 4);
+  header.push_back((char) Journal::VERSION);
+  header.resize(Journal::_HEADER_SIZE, '\0');
+
+  return header;
+}
+
+uint64_t libathome_common::Journal::
+_scan(const char* data, size_t length, size_t& valid_end,
+      const Journal::replay_t& replay) const noexcept(false)
+{
+  std::string header = Journal::_header();
+
+  /* A crash right after creating it  */
+  if (length < Journal::_HEADER_SIZE) {
+    if (0 != ::memcmp(data, header.data(), length)) {
+      throw Err("File '%s' is not a journal!", this->filename_full.c_str());
+    }
+    valid_end = 0;
+    return 0;
+  }
+  if (0 != ::memcmp(data, header.data(), 4)) {
+    throw Err("File '%s' is not a journal!", this->filename_full.c_str());
+  }
+  if (0 != ::memcmp(data, header.data(), Journal::_HEADER_SIZE)) {
+    throw Err("Journal '%s' has unsupported version %u!",
+              this->filename_full.c_str(), (unsigned) (uint8_t) data[4]);
+  }
+
+  uint64_t records = 0;
+  size_t pos = Journal::_HEADER_SIZE;
+  while (length - pos >= Journal::_RECORD_HEADER_SIZE) {
+    uint32_t record_length, record_crc;
+    ::memcpy(&record_length, data + pos, 4);
+    ::memcpy(&record_crc, data + pos + 4, 4);
+
+    const char* payload = data + pos + Journal::_RECORD_HEADER_SIZE;
+    size_t left = length - pos - Journal::_RECORD_HEADER_SIZE;
+    if (record_length > left) break;
+    if (record_crc != Journal::crc32c(
+          Journal::crc32c(0, &record_length, 4), payload, record_length)) {
+      break;
+    }
+
+    if (replay) replay(payload, record_length);
+    records++;
+    pos += Journal::_RECORD_HEADER_SIZE + record_length;
+  }
+
+  valid_end = pos;
+  return records;
+}
+
+uint64_t libathome_common::Journal::
+open(const Journal::replay_t& replay) noexcept(false)
+{
+  this->close();
+  this->truncated = 0;
+
+  Filesystem::mkdir_p(this->path);
+
+#ifndef OSWIN
+  int fd = ::open(this->filename_full.c_str(),
+                  O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+#else /* ifndef OSWIN  */
+  int fd = ::_open(this->filename_full.c_str(),
+                   _O_RDWR | _O_CREAT | _O_APPEND | _O_BINARY,
+                   _S_IREAD | _S_IWRITE);
+#endif /* ifndef OSWIN  */
+  if (fd < 0) {
+    throw Err("Could not open journal '%s': %s!",
+              this->filename_full.c_str(), ::strerror(errno));
+  }
+
+  uint64_t records;
+  size_t length, valid_end;
+  try {
+    /* Scan in place, instead of copying it through a read buffer  */
+    File in(this->path, this->filename, true);
+    in.open(File::access_t::read_e);
+    File::span_t content = in.map(File::advice_t::sequential_e);
+
+    length = content.length;
+    records = this->_scan(content.data, length, valid_end, replay);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+
+  Status status;
+  if (valid_end < length) {
+#ifndef OSWIN
+    if (0 != ::ftruncate(fd, (off_t) valid_end)) {
+#else /* ifndef OSWIN  */
+    if (0 != ::_chsize_s(fd, (__int64) valid_end)) {
+#endif /* ifndef OSWIN  */
+      int code = errno;
+      status = ErrStatus(code, "Could not truncate journal '%s': %s!",
+                         this->filename_full.c_str(), ::strerror(code));
+    }
+    this->truncated = length - valid_end;
+  }
+  if (status && valid_end == 0) {
+    std::string header = Journal::_header();
+    status = Journal::_write_all(fd, header.data(), header.size(),
+                                 this->filename_full);
+  }
+  if (status && (valid_end < length || valid_end == 0)) {
+    status = Journal::_sync(fd, this->filename_full, false);
+  }
+  if (!status) {
+    ::close(fd);
+    status.throw_if_error();
+  }
+
+#ifndef OSWIN
+  /* A new file is an entry of the directory, which must be persisted
+   * too
+   */
+  if (valid_end == 0) {
+    int dir_fd = ::open(this->path.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+      status = Journal::_sync(dir_fd, this->path, false);
+      ::close(dir_fd);
+    } else {
+      int code = errno;
+      status = ErrStatus(code, "Could not open directory '%s': %s!",
+                         this->path.c_str(), ::strerror(code));
+    }
+    if (!status) {
+      ::close(fd);
+      status.throw_if_error();
+    }
+  }
+#endif /* ifndef OSWIN  */
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->fd = fd;
+  this->error = Status();
+
+  return records;
+}
+
+void libathome_common::Journal::
+close()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  if (this->fd < 0) return;
+
+  /* Let the running appends finish  */
+  while (this->syncing
+         || (this->synced < this->appended && this->error.is_ok())) {
+    this->synced_cond.wait(lock);
+  }
+
+#ifndef OSWIN
+  ::close(this->fd);
+#else /* ifndef OSWIN  */
+  ::_close(this->fd);
+#endif /* ifndef OSWIN  */
+  this->fd = -1;
+
+  this->pending.clear();
+  this->appended = 0;
+  this->synced = 0;
+}
+
+/* ***************************************************************  */
+
+void libathome_common::Journal::
+append(const void* data, size_t length) noexcept(false)
+{
+  this->append(data, length, std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::Journal::
+append(const void* data, size_t length, const std::nothrow_t&)
+{
+  if (length > Journal::RECORD_MAX) {
+    return ErrStatus(EINVAL, "Record of %zu bytes is too large for "
+                     "journal '%s'!", length, this->filename_full.c_str());
+  }
+
+  /* Outside of the lock, it's the expensive part  */
+  uint32_t record_length = (uint32_t) length;
+  uint32_t record_crc = Journal::crc32c(
+    Journal::crc32c(0, &record_length, 4), data, length);
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  if (this->fd < 0) {
+    return ErrStatus(EBADF, "Journal '%s' is not opened!",
+                     this->filename_full.c_str());
+  }
+  if (!this->error) return this->error;
+
+  this->pending.append((const char*) &record_length, 4);
+  this->pending.append((const char*) &record_crc, 4);
+  this->pending.append((const char*) data, length);
+  uint64_t sequence = ++this->appended;
+
+  /* Group commit: the first waiting thread writes and syncs the
+   * records of all others, which arrived meanwhile
+   */
+  while (this->synced < sequence) {
+    if (!this->error) return this->error;
+
+    if (this->syncing) {
+      this->synced_cond.wait(lock);
+      continue;
+    }
+
+    this->syncing = true;
+    this->writing.swap(this->pending);
+    uint64_t batch_end = this->appended;
+    lock.unlock();
+
+    Status status = Journal::_write_all(
+      this->fd, this->writing.data(), this->writing.size(),
+      this->filename_full);
+    if (status) status = Journal::_sync(this->fd, this->filename_full, true);
+
+    lock.lock();
+    this->writing.clear();
+    this->syncing = false;
+    if (status) this->synced = batch_end;
+    else this->error = status;
+    this->synced_cond.notify_all();
+  }
+
+  return Status();
+}
+
+/* ***************************************************************  */
+
+libathome_common::Status libathome_common::Journal::
+_write_all(int fd, const char* data, size_t length, const std::string& name)
+{
+  while (length > 0) {
+#ifndef OSWIN
+    ssize_t written = ::write(fd, data, length);
+#else /* ifndef OSWIN  */
+    int written = ::_write(fd, data, (unsigned) length);
+#endif /* ifndef OSWIN  */
+    if (written < 0) {
+      if (errno == EINTR) continue;
+
+      int code = errno;
+      return ErrStatus(code, "Could not write to '%s': %s!",
+                       name.c_str(), ::strerror(code));
+    }
+
+    data += written;
+    length -= (size_t) written;
+  }
+
+  return Status();
+}
+
+libathome_common::Status libathome_common::Journal::
+_sync(int fd, const std::string& name, bool datasync)
+{
+#ifndef OSWIN
+  int sync_res = datasync? ::fdatasync(fd): ::fsync(fd);
+#else /* ifndef OSWIN  */
+  (void) datasync;
+  int sync_res = ::_commit(fd);
+#endif /* ifndef OSWIN  */
+  if (sync_res != 0) {
+    int code = errno;
+    return ErrStatus(code, "Could not sync '%s' to disk: %s!",
+                     name.c_str(), ::strerror(code));
+  }
+
+  return Status();
+}
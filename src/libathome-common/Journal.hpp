@@ -0,0 +1,216 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LIBATHOME_COMMON_JOURNAL_H__
+#define LIBATHOME_COMMON_JOURNAL_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::Journal.
+ */
+
+#include "libathome-common/Common.hpp"
+#include "libathome-common/Result.hpp"
+
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+namespace libathome_common
+{
+
+/**
+ * Append-only journal file, which survives crashes and power loss.
+ *
+ * Every record is written as `[uint32_t length][uint32_t crc]` and
+ * the payload, in the byte order of the machine.  `crc` is the CRC32C
+ * of `length` and the payload, so a torn or corrupted record is
+ * detected on ::libathome_common::Journal::open().  Then it and
+ * everything behind it will be truncated, all records before are
+ * intact.
+ *
+ * ::libathome_common::Journal::append() returns after the record is
+ * on the disk.  It is thread-safe and uses group commit: while one
+ * writer syncs, the records of the others are collected and written
+ * with the next single `fdatasync()`.  So the number of syncs
+ * doesn't grow with the number of writers.
+ *
+ * **Example**
+ * ```cpp
+ * Journal journal("state", "server.journal");
+ * journal.open([&](const char* data, size_t length) {
+ *   state.apply(data, length);
+ * });
+ *
+ * journal.append(change.data(), change.size());
+ * ```
+ */
+class Journal
+{
+public:
+
+  /**
+   * Called by ::libathome_common::Journal::open() for every valid
+   * record, in the order they were appended.  `data` is valid only
+   * during the call.
+   */
+  typedef std::function<void(const char* data, size_t length)> replay_t;
+
+  /**
+   * Version of the file format, stored in the header of the file.
+   */
+  static const uint8_t VERSION = 1;
+
+  /**
+   * Maximum length of the payload of a record.
+   */
+  static const size_t RECORD_MAX = (size_t) 1 << 30;
+
+  /**
+   * Computes a CRC32C (Castagnoli), such as iSCSI, ext4 or SSE4.2 do.
+   *
+   * Uses the CRC32 instructions of the CPU if available, otherwise a
+   * table.  Can be chained, pass the result of the last call as `crc`.
+   *
+   * @param crc `0` for the first call
+   * @param data The bytes to add
+   * @param length Number of bytes
+   * @return The CRC of all bytes so far
+   */
+  static uint32_t crc32c(uint32_t crc, const void* data, size_t length);
+
+  /**
+   * Constructs a journal, the file will be opened by
+   * ::libathome_common::Journal::open().
+   *
+   * @param path The directory of the file, will be created
+   * @param filename The name of the file
+   */
+  explicit Journal(const std::string& path, const std::string& filename);
+  /**
+   * Closes the journal.
+   */
+  virtual ~Journal();
+
+  /**
+   * Returns the path and filename, such like `path/filename`.
+   *
+   * @return The full filename
+   */
+  virtual const std::string& get_filename_full() const;
+  /**
+   * Returns the number of bytes which were truncated by the last
+   * ::libathome_common::Journal::open(), a torn record after a crash.
+   *
+   * @return `0` if the journal was closed cleanly
+   */
+  virtual uint64_t get_truncated() const;
+
+  /**
+   * Opens the journal, creates it if it doesn't exist.
+   *
+   * The file is mapped and scanned up to the last valid record, which
+   * is much faster than reading it.  A torn tail will be truncated.
+   *
+   * @param replay Called for every valid record, may be empty
+   * @return Number of valid records
+   * @exception ::libathome_common::Error will be thrown if the file is
+   *            not a journal, could not be opened or repaired.  Any
+   *            exception of `replay` will be passed and the journal
+   *            stays closed.
+   */
+  virtual uint64_t open(const Journal::replay_t& replay = replay_t())
+    noexcept(false);
+  /**
+   * Appends a record and waits until it is on the disk.
+   *
+   * Thread-safe.  If writing or syncing has failed once, then all
+   * later calls fail too, because the state of the file is unknown.
+   * Reopen the journal to recover.
+   *
+   * @param data The payload
+   * @param length Length of the payload, up to
+   *               ::libathome_common::Journal::RECORD_MAX
+   * @exception ::libathome_common::Error will be thrown if the journal
+   *            is not opened or the record could not be written.
+   *            Then it may or may not be part of the journal after
+   *            reopening.
+   */
+  virtual void append(const void* data, size_t length) noexcept(false);
+  /**
+   * Non-throwing variant of ::libathome_common::Journal::append().
+   *
+   * @param data The payload
+   * @param length Length of the payload
+   * @return Failed if the record could not be written
+   */
+  virtual Status append(const void* data, size_t length,
+    const std::nothrow_t&);
+  /**
+   * Closes the journal, after all running
+   * ::libathome_common::Journal::append() returned.
+   */
+  virtual void close();
+
+  /* disable copy constructor and assignment operator  */
+  Journal(const Journal&) = delete;
+  Journal& operator=(const Journal&) = delete;
+
+private:
+  /** Magic bytes plus version, padded to 8 bytes  */
+  static const size_t _HEADER_SIZE = 8;
+  static const size_t _RECORD_HEADER_SIZE = 8;
+
+  static uint32_t _crc32c_table(uint32_t crc, const char* data,
+    size_t length);
+  static uint32_t _crc32c_hw(uint32_t crc, const char* data,
+    size_t length);
+  static bool _has_crc32c_hw();
+
+  static std::string _header();
+  static Status _write_all(int fd, const char* data, size_t length,
+    const std::string& name);
+  static Status _sync(int fd, const std::string& name, bool datasync);
+
+  std::string path;
+  std::string filename;
+  std::string filename_full;
+  uint64_t truncated;
+
+  int fd;
+
+  std::mutex mutex;
+  std::condition_variable synced_cond;
+  /** Encoded records which wait for the next sync  */
+  std::string pending;
+  /** Records which are written and synced right now, by the one
+   * thread which has set SYNCING  */
+  std::string writing;
+  bool syncing;
+  /** Sequence number of the last appended and last synced record  */
+  uint64_t appended;
+  uint64_t synced;
+  /** Latched error of writing or syncing  */
+  Status error;
+
+  uint64_t _scan(const char* data, size_t length, size_t& valid_end,
+    const Journal::replay_t& replay) const noexcept(false);
+
+}; /* class Journal  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_JOURNAL_H__  */
@@ -0,0 +1,764 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "libathome-common/LogBinary.hpp"
+#include "libathome-common/Logger.hpp"
+#include "libathome-common/Error.hpp"
+
+#include <cerrno>
+#include <ctime>
+#include <cstddef>
+#include <sys/types.h>
+
+
+/** Written into the session record to detect foreign byte orders  */
+#define LOGBINARY_BYTE_ORDER       ((uint16_t) 0x0102)
+
+
+libathome_common::LogBinary::
+LogBinary()
+  :strftime_fmt("[%H:%M:%S.%3N]"), has_timezone(false),
+   timezone(RealtimeClock::timezone_t::utc_e), print_thread(false)
+{
+}
+
+libathome_common::LogBinary::
+~LogBinary()
+{
+}
+
+libathome_common::LogBinary::format_slot_t
+libathome_common::LogBinary::_formats[LogBinary::FORMATS_MAX];
+
+std::atomic<uint32_t> libathome_common::LogBinary::_thread_next(0);
+
+/* ***************************************************************  */
+
+const char* libathome_common::LogBinary::
+to_string(LogBinary::record_t record)
+{
+  switch (record) {
+  case session_e: return "session";
+  case format_e: return "format";
+  case message_e: return "message";
+  case text_e: return "text";
+  }
+
+  return "<not implemented!>";
+}
+
+void libathome_common::LogBinary::
+set_time_format(const std::string& strftime_fmt)
+{
+  this->strftime_fmt = strftime_fmt;
+}
+
+void libathome_common::LogBinary::
+set_timezone(RealtimeClock::timezone_t timezone)
+{
+  this->has_timezone = true;
+  this->timezone = timezone;
+}
+
+void libathome_common::LogBinary::
+set_print_thread(bool print_thread)
+{
+  this->print_thread = print_thread;
+}
+
+/* ***************************************************************  */
+
+bool libathome_common::LogBinary::
+_parse_spec(const char* pos, LogBinary::spec_t& spec)
+{
+  const char* p = pos + 1;
+
+  spec.width_star = false;
+  spec.precision_star = false;
+  spec.precision = -1;
+
+  while (*p != '\0' && ::strchr("-+ #0'", *p) != NULL) p++;
+
+  if (*p == '*') {
+    spec.width_star = true;
+    p++;
+  } else {
+    while (*p >= '0' && *p <= '9') p++;
+  }
+
+  if (*p == '.') {
+    p++;
+    if (*p == '*') {
+      spec.precision_star = true;
+      p++;
+    } else {
+      spec.precision = 0;
+      while (*p >= '0' && *p <= '9')
+        spec.precision = spec.precision * 10 + (*p++ - '0');
+    }
+  }
+
+  spec.prefix_length = p - pos;
+
+  size_t modifier_len = 0;
+  if ((p[0] == 'h' && p[1] == 'h') || (p[0] == 'l' && p[1] == 'l'))
+    modifier_len = 2;
+  else if (*p != '\0' && ::strchr("hljztLq", *p) != NULL)
+    modifier_len = 1;
+  ::memcpy(spec.modifier, p, modifier_len);
+  spec.modifier[modifier_len] = '\0';
+  p += modifier_len;
+
+  spec.conversion = *p;
+  if (*p == '\0' || ::strchr("%diuoxXcfFeEgGaAsp", *p) == NULL)
+    return false;
+
+  /* Wide characters are not supported  */
+  if ((spec.conversion == 'c' || spec.conversion == 's')
+      && spec.modifier[0] == 'l')
+    return false;
+
+  spec.length = p + 1 - pos;
+  return true;
+}
+
+uint64_t libathome_common::LogBinary::
+_monotonic_ns() noexcept(false)
+{
+  ::timespec now;
+  if (0 != ::clock_gettime(CLOCK_MONOTONIC, &now)) {
+    throw Err("Could not fetch time from monotonic clock: %s!",
+              ::strerror(errno));
+  }
+
+  return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+uint32_t libathome_common::LogBinary::
+_thread_id()
+{
+  static thread_local uint32_t id = 0;
+
+  if (id == 0) id = ++LogBinary::_thread_next;
+  return id;
+}
+
+size_t libathome_common::LogBinary::
+_record_begin(std::string& out, LogBinary::record_t type)
+{
+  size_t begin = out.length();
+
+  out.push_back((char) type);
+  out.append(sizeof(uint32_t), '\0');
+
+  return begin;
+}
+
+void libathome_common::LogBinary::
+_record_end(std::string& out, size_t begin)
+{
+  uint32_t length = out.length() - begin - 1 - sizeof(uint32_t);
+  ::memcpy(&out[begin + 1], &length, sizeof(length));
+}
+
+void libathome_common::LogBinary::
+_read(const char*& pos, const char* end, void* value, size_t size)
+  noexcept(false)
+{
+  if ((size_t) (end - pos) < size)
+    throw Err("Binary log record is truncated!");
+
+  ::memcpy(value, pos, size);
+  pos += size;
+}
+
+/* ***************************************************************  */
+
+uint32_t libathome_common::LogBinary::
+register_format(const char* fmt, bool& is_new)
+{
+  is_new = false;
+
+  /* FNV-1a, 0 marks an empty slot
+   */
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char* p = fmt; *p != '\0'; p++) {
+    hash ^= (unsigned char) *p;
+    hash *= 1099511628211ULL;
+  }
+  if (hash == 0) hash = 1;
+
+  size_t mask = LogBinary::FORMATS_MAX - 1;
+  for (size_t i=0; i<LogBinary::FORMATS_MAX; i++) {
+    size_t slot = (hash + i) & mask;
+    format_slot_t& entry = LogBinary::_formats[slot];
+
+    uint64_t current = entry.hash.load(std::memory_order_acquire);
+    if (current == 0) {
+      if (!entry.hash.compare_exchange_strong(
+            current, hash, std::memory_order_acq_rel)) {
+        /* Someone else was faster, CURRENT was updated  */
+        if (current != hash) continue;
+        return slot + 1;
+      }
+
+      entry.fmt = fmt;
+      entry.supported = LogBinary::_compile(fmt, entry.fetches);
+      entry.ready.store(true, std::memory_order_release);
+      is_new = true;
+      return slot + 1;
+    }
+
+    if (current == hash) return slot + 1;
+  }
+
+  return 0;
+}
+
+void libathome_common::LogBinary::
+encode_session(std::string& out, RealtimeClock::timezone_t timezone)
+  noexcept(false)
+{
+  uint64_t mono = LogBinary::_monotonic_ns();
+
+  ::timespec now;
+  if (0 != ::clock_gettime(CLOCK_REALTIME, &now)) {
+    throw Err("Could not fetch time from system RTC: %s!",
+              ::strerror(errno));
+  }
+
+  uint16_t byte_order = LOGBINARY_BYTE_ORDER;
+  uint8_t version = LogBinary::VERSION, tz = (uint8_t) timezone;
+  int64_t sec = now.tv_sec;
+  uint32_t nsec = now.tv_nsec;
+
+  size_t begin = LogBinary::_record_begin(out, record_t::session_e);
+  out.append((const char*) &byte_order, sizeof(byte_order));
+  out.append((const char*) &version, sizeof(version));
+  out.append((const char*) &tz, sizeof(tz));
+  out.append((const char*) &sec, sizeof(sec));
+  out.append((const char*) &nsec, sizeof(nsec));
+  out.append((const char*) &mono, sizeof(mono));
+  LogBinary::_record_end(out, begin);
+}
+
+void libathome_common::LogBinary::
+encode_format(std::string& out, uint32_t id, const char* fmt)
+{
+  size_t begin = LogBinary::_record_begin(out, record_t::format_e);
+  out.append((const char*) &id, sizeof(id));
+  out.append(fmt);
+  LogBinary::_record_end(out, begin);
+}
+
+void libathome_common::LogBinary::
+encode_formats(std::string& out)
+{
+  for (size_t i=0; i<LogBinary::FORMATS_MAX; i++) {
+    format_slot_t& entry = LogBinary::_formats[i];
+
+    /* Not ready ones will be written by the registering thread  */
+    if (!entry.ready.load(std::memory_order_acquire)) continue;
+
+    LogBinary::encode_format(out, i + 1, entry.fmt.c_str());
+  }
+}
+
+bool libathome_common::LogBinary::
+_compile(const char* fmt, std::string& fetches)
+{
+  fetches.clear();
+
+  for (const char* p = ::strchr(fmt, '%'); p != NULL;
+       p = ::strchr(p, '%')) {
+    spec_t spec;
+    if (!LogBinary::_parse_spec(p, spec)) return false;
+    p += spec.length;
+    if (spec.conversion == '%') continue;
+
+    if (spec.width_star) fetches.push_back(fetch_t::int_f);
+    if (spec.precision_star) fetches.push_back(fetch_t::int_f);
+
+    std::string m = spec.modifier;
+    fetch_t fetch;
+    switch (spec.conversion) {
+    case 'c':
+      fetch = fetch_t::int_f;
+      break;
+    case 'd': case 'i':
+      if (m == "ll" || m == "q") fetch = fetch_t::longlong_f;
+      else if (m == "l") fetch = fetch_t::long_f;
+      else if (m == "j") fetch = fetch_t::intmax_f;
+      else if (m == "z") fetch = fetch_t::ssize_f;
+      else if (m == "t") fetch = fetch_t::ptrdiff_f;
+      else if (m == "hh") fetch = fetch_t::schar_f;
+      else if (m == "h") fetch = fetch_t::short_f;
+      else fetch = fetch_t::int_f;
+      break;
+    case 'u': case 'o': case 'x': case 'X':
+      if (m == "ll" || m == "q") fetch = fetch_t::ulonglong_f;
+      else if (m == "l") fetch = fetch_t::ulong_f;
+      else if (m == "j") fetch = fetch_t::uintmax_f;
+      else if (m == "z") fetch = fetch_t::size_f;
+      else if (m == "t") fetch = fetch_t::ptrdiff_f;
+      else if (m == "hh") fetch = fetch_t::uchar_f;
+      else if (m == "h") fetch = fetch_t::ushort_f;
+      else fetch = fetch_t::uint_f;
+      break;
+    case 'p':
+      fetch = fetch_t::pointer_f;
+      break;
+    case 's':
+      /* The argument may be not NUL-terminated if there is a
+       * precision, so it must be known while encoding.
+       */
+      if (spec.precision_star) {
+        fetch = fetch_t::string_star_f;
+      } else if (spec.precision >= 0) {
+        uint32_t precision = spec.precision;
+        fetches.push_back(fetch_t::string_precision_f);
+        fetches.append((const char*) &precision, sizeof(precision));
+        continue;
+      } else {
+        fetch = fetch_t::string_f;
+      }
+      break;
+    default:
+      fetch = m == "L"? fetch_t::longdouble_f: fetch_t::double_f;
+      break;
+    }
+    fetches.push_back(fetch);
+  }
+
+  return true;
+}
+
+bool libathome_common::LogBinary::
+encode_message(std::string& out, int level, uint32_t id,
+  const char* fmt, ::va_list ap) noexcept(false)
+{
+  /* Parsing FMT is done once during registration.  If the
+   * registering thread is not finished yet, then parse it here.
+   */
+  std::string local;
+  const std::string* fetches;
+  const format_slot_t& entry = LogBinary::_formats[id - 1];
+  if (entry.ready.load(std::memory_order_acquire)) {
+    if (!entry.supported) return false;
+    fetches = &entry.fetches;
+  } else {
+    if (!LogBinary::_compile(fmt, local)) return false;
+    fetches = &local;
+  }
+
+  uint8_t lvl = level;
+  uint32_t tid = LogBinary::_thread_id();
+  uint64_t mono = LogBinary::_monotonic_ns();
+
+  /* Reserve the maximum size without strings, then write via
+   * MEMCPY.  STD::STRING::APPEND() per field would be much slower.
+   */
+  size_t begin = LogBinary::_record_begin(out, record_t::message_e);
+  size_t pos = out.length();
+  out.resize(pos + sizeof(lvl) + sizeof(tid) + sizeof(mono) + sizeof(id)
+             + fetches->length() * (1 + sizeof(uint64_t)));
+
+#define LOGBINARY_PUT(value) do { \
+      ::memcpy(&out[pos], &(value), sizeof(value)); \
+      pos += sizeof(value); \
+    } while (0)
+
+  LOGBINARY_PUT(lvl);
+  LOGBINARY_PUT(tid);
+  LOGBINARY_PUT(mono);
+  LOGBINARY_PUT(id);
+
+  /* Last fetched INT, the precision of STRING_STAR_F  */
+  int64_t star = -1;
+
+  for (size_t i=0; i<fetches->length(); i++) {
+    char fetch = (*fetches)[i];
+    char tag;
+    union {
+      int64_t i;
+      uint64_t u;
+      double d;
+    } value;
+
+    switch ((fetch_t) fetch) {
+    case int_f:
+      tag = arg_t::int_e; value.i = star = va_arg(ap, int); break;
+    case long_f: tag = arg_t::int_e; value.i = va_arg(ap, long); break;
+    case longlong_f:
+      tag = arg_t::int_e; value.i = va_arg(ap, long long); break;
+    case intmax_f: tag = arg_t::int_e; value.i = va_arg(ap, intmax_t); break;
+    case ssize_f: tag = arg_t::int_e; value.i = va_arg(ap, ssize_t); break;
+    case ptrdiff_f:
+      tag = arg_t::int_e; value.i = va_arg(ap, ptrdiff_t); break;
+    case schar_f:
+      tag = arg_t::int_e; value.i = (signed char) va_arg(ap, int); break;
+    case short_f:
+      tag = arg_t::int_e; value.i = (short) va_arg(ap, int); break;
+    case uint_f: tag = arg_t::uint_e; value.u = va_arg(ap, unsigned); break;
+    case ulong_f:
+      tag = arg_t::uint_e; value.u = va_arg(ap, unsigned long); break;
+    case ulonglong_f:
+      tag = arg_t::uint_e; value.u = va_arg(ap, unsigned long long); break;
+    case uintmax_f:
+      tag = arg_t::uint_e; value.u = va_arg(ap, uintmax_t); break;
+    case size_f: tag = arg_t::uint_e; value.u = va_arg(ap, size_t); break;
+    case uchar_f:
+      tag = arg_t::uint_e; value.u = (unsigned char) va_arg(ap, unsigned);
+      break;
+    case ushort_f:
+      tag = arg_t::uint_e;
+      value.u = (unsigned short) va_arg(ap, unsigned);
+      break;
+    case double_f: tag = arg_t::double_e; value.d = va_arg(ap, double); break;
+    case longdouble_f:
+      tag = arg_t::double_e; value.d = va_arg(ap, long double); break;
+    case pointer_f:
+      tag = arg_t::pointer_e; value.u = (uintptr_t) va_arg(ap, void*);
+      break;
+    case string_f: case string_star_f: case string_precision_f: {
+      int64_t precision = -1;
+      if (fetch == string_star_f) {
+        precision = star;
+      } else if (fetch == string_precision_f) {
+        uint32_t fixed;
+        ::memcpy(&fixed, &(*fetches)[i + 1], sizeof(fixed));
+        i += sizeof(fixed);
+        precision = fixed;
+      }
+
+      const char* str = va_arg(ap, const char*);
+      if (str == NULL) str = "(null)";
+
+      /* Like PRINTF(), never read more than PRECISION characters  */
+      uint32_t len = precision < 0? ::strlen(str)
+        : ::strnlen(str, (size_t) precision);
+
+      /* Needs LEN bytes more than reserved, but 8 bytes less  */
+      tag = arg_t::string_e;
+      out.resize(out.length() + len - sizeof(uint64_t) + sizeof(len));
+      LOGBINARY_PUT(tag);
+      LOGBINARY_PUT(len);
+      ::memcpy(&out[pos], str, len);
+      pos += len;
+      continue;
+    }
+    default:
+      out.resize(begin);
+      return false;
+    }
+
+    LOGBINARY_PUT(tag);
+    LOGBINARY_PUT(value);
+  }
+#undef LOGBINARY_PUT
+
+  /* The precision of STRING_PRECISION_F was reserved too  */
+  out.resize(pos);
+
+  LogBinary::_record_end(out, begin);
+  return true;
+}
+
+void libathome_common::LogBinary::
+encode_text(std::string& out, int level, const char* text,
+  size_t length) noexcept(false)
+{
+  uint8_t lvl = level;
+  uint32_t tid = LogBinary::_thread_id();
+  uint64_t mono = LogBinary::_monotonic_ns();
+
+  size_t begin = LogBinary::_record_begin(out, record_t::text_e);
+  out.append((const char*) &lvl, sizeof(lvl));
+  out.append((const char*) &tid, sizeof(tid));
+  out.append((const char*) &mono, sizeof(mono));
+  out.append(text, length);
+  LogBinary::_record_end(out, begin);
+}
+
+/* ***************************************************************  */
+
+std::string libathome_common::LogBinary::
+_render(const std::string& fmt, const char* args, size_t length) const
+  noexcept(false)
+{
+  std::string result;
+  const char* end = args + length;
+
+  const char* p = fmt.c_str();
+  for (const char* conv = ::strchr(p, '%'); conv != NULL;
+       conv = ::strchr(p, '%')) {
+    result.append(p, conv - p);
+
+    spec_t spec;
+    if (!LogBinary::_parse_spec(conv, spec)) {
+      throw Err("Unsupported conversion in format string '%s'!",
+                fmt.c_str());
+    }
+    p = conv + spec.length;
+    if (spec.conversion == '%') {
+      result.push_back('%');
+      continue;
+    }
+
+    int stars[2], star_count = 0;
+    for (int i=0; i<(spec.width_star? 1: 0)
+                    + (spec.precision_star? 1: 0); i++) {
+      char tag;
+      int64_t star;
+      LogBinary::_read(args, end, &tag, sizeof(tag));
+      LogBinary::_read(args, end, &star, sizeof(star));
+      stars[star_count++] = (int) star;
+    }
+
+    char tag;
+    LogBinary::_read(args, end, &tag, sizeof(tag));
+
+    std::string conv_fmt(conv, spec.prefix_length);
+    string_t buf;
+    std::string big;
+    int len;
+
+    /* Pass the value with the type of the record, not the type of
+     * the original length modifier.
+     */
+#define LOGBINARY_SNPRINTF(dest, size, value) \
+    (star_count == 0? ::snprintf(dest, size, conv_fmt.c_str(), value) \
+     : star_count == 1 \
+       ? ::snprintf(dest, size, conv_fmt.c_str(), stars[0], value) \
+       : ::snprintf(dest, size, conv_fmt.c_str(), stars[0], stars[1], \
+                    value))
+#define LOGBINARY_FORMAT(value) do { \
+      len = LOGBINARY_SNPRINTF(buf, STRING_LEN, value); \
+      if (len >= (int) STRING_LEN) { \
+        big.resize(len + 1); \
+        LOGBINARY_SNPRINTF(&big[0], len + 1, value); \
+      } \
+    } while (0)
+
+    switch (tag) {
+    case arg_t::int_e: {
+      int64_t value;
+      LogBinary::_read(args, end, &value, sizeof(value));
+      if (spec.conversion == 'c') {
+        conv_fmt.push_back('c');
+        LOGBINARY_FORMAT((int) value);
+      } else {
+        conv_fmt.append("ll").push_back(spec.conversion);
+        LOGBINARY_FORMAT((long long) value);
+      }
+      break;
+    }
+    case arg_t::uint_e: {
+      uint64_t value;
+      LogBinary::_read(args, end, &value, sizeof(value));
+      conv_fmt.append("ll").push_back(spec.conversion);
+      LOGBINARY_FORMAT((unsigned long long) value);
+      break;
+    }
+    case arg_t::double_e: {
+      double value;
+      LogBinary::_read(args, end, &value, sizeof(value));
+      conv_fmt.push_back(spec.conversion);
+      LOGBINARY_FORMAT(value);
+      break;
+    }
+    case arg_t::pointer_e: {
+      uint64_t value;
+      LogBinary::_read(args, end, &value, sizeof(value));
+      conv_fmt.push_back('p');
+      LOGBINARY_FORMAT((void*) (uintptr_t) value);
+      break;
+    }
+    case arg_t::string_e: {
+      uint32_t value_len;
+      LogBinary::_read(args, end, &value_len, sizeof(value_len));
+      if ((size_t) (end - args) < value_len)
+        throw Err("Binary log record is truncated!");
+      std::string value(args, value_len);
+      args += value_len;
+
+      conv_fmt.push_back('s');
+      LOGBINARY_FORMAT(value.c_str());
+      break;
+    }
+    default:
+      throw Err("Unknown argument type 0x%02x in binary log record!",
+                (unsigned char) tag);
+    }
+#undef LOGBINARY_FORMAT
+#undef LOGBINARY_SNPRINTF
+
+    if (len < 0) {
+      throw Err("Could not render conversion '%s'!", conv_fmt.c_str());
+    }
+    if (big.empty()) result.append(buf, len);
+    else result.append(big.c_str(), len);
+  }
+  result.append(p);
+
+  return result;
+}
+
+size_t libathome_common::LogBinary::
+decode(const std::string& data, const File& out) noexcept(false)
+{
+  const char* pos = data.c_str();
+  const char* end = pos + data.length();
+
+  /* First pass, collect all format strings.  The registering thread
+   * may write them after another thread already used the ID.
+   */
+  this->formats.clear();
+  while (pos < end) {
+    uint8_t type;
+    uint32_t length;
+    LogBinary::_read(pos, end, &type, sizeof(type));
+    LogBinary::_read(pos, end, &length, sizeof(length));
+    if ((size_t) (end - pos) < length)
+      break; /* Reported by the second pass  */
+
+    if (type == record_t::format_e && length >= sizeof(uint32_t)) {
+      uint32_t id;
+      ::memcpy(&id, pos, sizeof(id));
+      if (id >= this->formats.size()) this->formats.resize(id + 1);
+      this->formats[id].assign(pos + sizeof(id), length - sizeof(id));
+    }
+    pos += length;
+  }
+
+  size_t count = 0;
+  bool has_session = false;
+  RealtimeClock::timezone_t timezone = this->timezone;
+  int64_t session_sec = 0;
+  uint32_t session_nsec = 0;
+  uint64_t session_mono = 0;
+
+  pos = data.c_str();
+  while (pos < end) {
+    size_t offset = pos - data.c_str();
+
+    uint8_t type;
+    uint32_t length;
+    LogBinary::_read(pos, end, &type, sizeof(type));
+    LogBinary::_read(pos, end, &length, sizeof(length));
+    if ((size_t) (end - pos) < length) {
+      throw Err("Binary log record at offset %lu is truncated!",
+                (unsigned long) offset);
+    }
+    const char* record = pos;
+    const char* record_end = pos + length;
+    pos = record_end;
+
+    if (type == record_t::format_e) continue;
+
+    if (type == record_t::session_e) {
+      uint16_t byte_order;
+      uint8_t version, tz;
+      LogBinary::_read(record, record_end, &byte_order,
+                       sizeof(byte_order));
+      LogBinary::_read(record, record_end, &version, sizeof(version));
+      if (byte_order != LOGBINARY_BYTE_ORDER
+          || version != LogBinary::VERSION) {
+        throw Err("Binary log session at offset %lu has version %u or"
+                  " foreign byte order, expected version %u!",
+                  (unsigned long) offset, (unsigned) version,
+                  (unsigned) LogBinary::VERSION);
+      }
+      LogBinary::_read(record, record_end, &tz, sizeof(tz));
+      LogBinary::_read(record, record_end, &session_sec,
+                       sizeof(session_sec));
+      LogBinary::_read(record, record_end, &session_nsec,
+                       sizeof(session_nsec));
+      LogBinary::_read(record, record_end, &session_mono,
+                       sizeof(session_mono));
+
+      if (!this->has_timezone)
+        timezone = (RealtimeClock::timezone_t) tz;
+      has_session = true;
+      continue;
+    }
+
+    if (type != record_t::message_e && type != record_t::text_e) {
+      throw Err("Unknown binary log record 0x%02x at offset %lu!",
+                (unsigned) type, (unsigned long) offset);
+    }
+    if (!has_session) {
+      throw Err("Not a binary log file, no session record found before"
+                " offset %lu!", (unsigned long) offset);
+    }
+
+    uint8_t level;
+    uint32_t tid;
+    uint64_t mono;
+    LogBinary::_read(record, record_end, &level, sizeof(level));
+    LogBinary::_read(record, record_end, &tid, sizeof(tid));
+    LogBinary::_read(record, record_end, &mono, sizeof(mono));
+
+    std::string msg;
+    if (type == record_t::text_e) {
+      msg.assign(record, record_end - record);
+    } else {
+      uint32_t id;
+      LogBinary::_read(record, record_end, &id, sizeof(id));
+
+      if (id < this->formats.size() && !this->formats[id].empty()) {
+        msg = this->_render(this->formats[id], record,
+                            record_end - record);
+      } else {
+        string_t buf;
+        ::snprintf(buf, STRING_LEN, "<unknown format #%u>",
+                   (unsigned) id);
+        msg = buf;
+      }
+    }
+
+    /* Monotonic time since session start, then wall-clock time
+     */
+    int64_t delta = (int64_t) (mono - session_mono);
+    int64_t nsec = (int64_t) session_nsec + delta % 1000000000LL;
+    int64_t sec = session_sec + delta / 1000000000LL;
+    if (nsec < 0) {
+      nsec += 1000000000LL;
+      sec--;
+    } else if (nsec >= 1000000000LL) {
+      nsec -= 1000000000LL;
+      sec++;
+    }
+    RealtimeClock rtc(timezone, (::time_t) sec, (long) nsec);
+
+    std::string line = rtc.to_string(this->strftime_fmt);
+    line.append(" ").append(
+      Logger::to_string((Logger::loglevel_t) level)).append(": ");
+    if (this->print_thread) {
+      string_t buf;
+      ::snprintf(buf, STRING_LEN, "[T%u] ", (unsigned) tid);
+      line.append(buf);
+    }
+    line.append(msg).push_back('\n');
+
+    out.write(line.c_str(), line.length());
+    count++;
+  }
+
+  return count;
+}
@@ -0,0 +1,303 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LIBATHOME_COMMON_LOGBINARY_H__
+#define LIBATHOME_COMMON_LOGBINARY_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::LogBinary.
+ */
+
+#include "libathome-common/Common.hpp"
+#include "libathome-common/RealtimeClock.hpp"
+#include "libathome-common/File.hpp"
+
+#include <atomic>
+#include <vector>
+
+namespace libathome_common
+{
+
+/**
+ * Encoder and decoder of the binary log file format.
+ *
+ * Used by ::libathome_common::Logger if it was constructed with
+ * ::libathome_common::Logger::binary_e.  Instead of formatting a
+ * message with `vsnprintf()`, only the raw arguments will be copied
+ * into the record, together with the ID of the format string, a
+ * monotonic timestamp, a thread ID and the log-level.  Every format
+ * string is written only once per log file.
+ *
+ * A log file is a sequence of records, each one starts with a
+ * ::libathome_common::LogBinary::record_t byte, followed by the
+ * length of the payload as `uint32_t`.  All numbers are stored in
+ * the byte order of the logging machine.  The first record of a log
+ * file is always a ::libathome_common::LogBinary::session_e record,
+ * which maps the monotonic timestamps to wall-clock time.
+ *
+ * Use the command-line tool `libathome-logdecode` or an instance of
+ * this class to render a log file as text again.
+ */
+class LogBinary
+{
+public:
+
+  /**
+   * Type of a record, the first byte of it.
+   */
+  typedef enum {
+    session_e = 'S',  ///< Log file opened, anchors the timestamps
+    format_e = 'F',   ///< Registers a format string with its ID
+    message_e = 'M',  ///< Format string ID plus the raw arguments
+    text_e = 'T'      ///< Preformatted message, if it can't be encoded
+  } record_t;
+
+  /**
+   * Convert a ::libathome_common::LogBinary::record_t to string.
+   *
+   * @param record The record type to convert
+   * @return The string which names the record type. `static`
+   *         allocated, need NOT to be `free()`d.
+   */
+  static const char* to_string(LogBinary::record_t record);
+
+  /**
+   * Version of the format, stored in every
+   * ::libathome_common::LogBinary::session_e record.
+   */
+  static const uint8_t VERSION = 1;
+
+  /**
+   * Maximum number of different format strings per process.  If
+   * exhausted, then messages will be stored as preformatted
+   * ::libathome_common::LogBinary::text_e records.
+   */
+  static const size_t FORMATS_MAX = 4096;
+
+  /* -------------------------------------------------------------  */
+
+  /**
+   * Returns the ID of a format string, registers it if needed.
+   *
+   * Thread-safe and lock-free.  The ID depends on the content of
+   * `fmt`, not on its address.
+   *
+   * @param fmt `printf()`-like format string
+   * @param is_new Output, `true` if `fmt` was registered by this
+   *               call.  Then a ::libathome_common::LogBinary::format_e
+   *               record must be written before the first message.
+   * @return The ID, or `0` if no more formats can be registered
+   */
+  static uint32_t register_format(const char* fmt, bool& is_new);
+
+  /**
+   * Append a ::libathome_common::LogBinary::session_e record with the
+   * current time to `out`.
+   *
+   * @param out Output buffer, the record will be appended
+   * @param timezone Timezone which the decoder should use by default
+   * @exception ::libathome_common::Error will be thrown if the time
+   *            could not be fetched
+   */
+  static void encode_session(std::string& out,
+    RealtimeClock::timezone_t timezone) noexcept(false);
+  /**
+   * Append a ::libathome_common::LogBinary::format_e record to `out`.
+   *
+   * @param out Output buffer, the record will be appended
+   * @param id Result of
+   *           ::libathome_common::LogBinary::register_format()
+   * @param fmt The format string
+   */
+  static void encode_format(std::string& out, uint32_t id,
+    const char* fmt);
+  /**
+   * Append a ::libathome_common::LogBinary::format_e record for every
+   * registered format string to `out`.
+   *
+   * Needed at the beginning of a new log file, so every file can be
+   * decoded on its own.
+   *
+   * @param out Output buffer, the records will be appended
+   */
+  static void encode_formats(std::string& out);
+  /**
+   * Append a ::libathome_common::LogBinary::message_e record to
+   * `out`.
+   *
+   * The arguments in `ap` will be fetched as given by the conversions
+   * in `fmt`.  Conversions which can't be rendered later, such like
+   * `%n`, `%m` or wide strings, are not supported.
+   *
+   * @param out Output buffer, the record will be appended
+   * @param level Log-level of the message
+   * @param id Result of
+   *           ::libathome_common::LogBinary::register_format()
+   * @param fmt `printf()`-like format string
+   * @param ap Arguments of `fmt` string as `va_list`
+   * @return `false` if `fmt` is not supported, then `out` is
+   *         unchanged and the message should be encoded with
+   *         ::libathome_common::LogBinary::encode_text()
+   * @exception ::libathome_common::Error will be thrown if the time
+   *            could not be fetched
+   */
+  static bool encode_message(std::string& out, int level, uint32_t id,
+    const char* fmt, ::va_list ap) noexcept(false);
+  /**
+   * Append a ::libathome_common::LogBinary::text_e record to `out`.
+   *
+   * @param out Output buffer, the record will be appended
+   * @param level Log-level of the message
+   * @param text The formatted message, without newline
+   * @param length Length of `text` in bytes
+   * @exception ::libathome_common::Error will be thrown if the time
+   *            could not be fetched
+   */
+  static void encode_text(std::string& out, int level,
+    const char* text, size_t length) noexcept(false);
+
+  /* -------------------------------------------------------------  */
+
+  /**
+   * Constructs a decoder.
+   *
+   * The timestamps will be rendered like
+   * ::libathome_common::Logger::get_time_format() in the timezone
+   * which is stored in the log file.
+   */
+  explicit LogBinary();
+  /**
+   * Default destructor.
+   */
+  virtual ~LogBinary();
+
+  /**
+   * Set the format of the rendered timestamps.
+   *
+   * @param strftime_fmt See ::libathome_common::RealtimeClock::to_string()
+   */
+  virtual void set_time_format(const std::string& strftime_fmt);
+  /**
+   * Render timestamps in `timezone` instead of the timezone which is
+   * stored in the log file.
+   *
+   * @param timezone The timezone to use
+   */
+  virtual void set_timezone(RealtimeClock::timezone_t timezone);
+  /**
+   * Also render the thread ID of every message, such like
+   * `"[...] info: [T3] msg"`.
+   *
+   * @param print_thread `true` to render the thread ID
+   */
+  virtual void set_print_thread(bool print_thread);
+
+  /**
+   * Render a whole binary log file as text.
+   *
+   * Every message will be rendered as one line, in the same format
+   * as ::libathome_common::Logger writes text log files.  Format
+   * strings may be registered after their first use, so `data`
+   * should contain the whole log file.
+   *
+   * @param data Content of a binary log file
+   * @param out Output for the rendered lines
+   * @return Number of rendered messages
+   * @exception ::libathome_common::Error will be thrown if `data` is
+   *            not a binary log file, is truncated or if writing to
+   *            `out` has failed.  All messages before the error were
+   *            written to `out`.
+   */
+  virtual size_t decode(const std::string& data, const File& out)
+    noexcept(false);
+
+private:
+  typedef struct {
+    /** Length of the conversion, including `'%'`  */
+    size_t length;
+    /** Length up to the length modifier, including `'%'`  */
+    size_t prefix_length;
+    bool width_star;
+    bool precision_star;
+    /** `-1` if there is none or it is `'*'`  */
+    int precision;
+    char modifier[3];
+    char conversion;
+  } spec_t;
+
+  typedef enum {
+    int_e = 'i',      ///< `int64_t`
+    uint_e = 'u',     ///< `uint64_t`
+    double_e = 'd',   ///< `double`
+    string_e = 's',   ///< `uint32_t` length, then the characters
+    pointer_e = 'p'   ///< `uint64_t`
+  } arg_t;
+
+  /** How to fetch an argument from a `va_list`  */
+  typedef enum {
+    int_f = 1, long_f, longlong_f, intmax_f, ssize_f, ptrdiff_f,
+    schar_f, short_f, uint_f, ulong_f, ulonglong_f, uintmax_f, size_f,
+    uchar_f, ushort_f, double_f, longdouble_f, pointer_f, string_f,
+    /** `%.*s`, the precision is the `int` fetched before  */
+    string_star_f,
+    /** `%.Ns`, followed by `N` as `uint32_t`  */
+    string_precision_f
+  } fetch_t;
+
+  typedef struct {
+    std::atomic<uint64_t> hash;
+    /** Set after all other fields were written, by the registering
+     * thread  */
+    std::atomic<bool> ready;
+    std::string fmt;
+    /** `false` if `fmt` can not be encoded  */
+    bool supported;
+    /** One ::libathome_common::LogBinary::fetch_t per argument  */
+    std::string fetches;
+  } format_slot_t;
+
+  static format_slot_t _formats[FORMATS_MAX];
+  static std::atomic<uint32_t> _thread_next;
+
+  static bool _parse_spec(const char* pos, LogBinary::spec_t& spec);
+  static bool _compile(const char* fmt, std::string& fetches);
+  static uint64_t _monotonic_ns() noexcept(false);
+  static uint32_t _thread_id();
+
+  static void _read(const char*& pos, const char* end, void* value,
+    size_t size) noexcept(false);
+
+  static size_t _record_begin(std::string& out,
+    LogBinary::record_t type);
+  static void _record_end(std::string& out, size_t begin);
+
+  std::string strftime_fmt;
+  bool has_timezone;
+  RealtimeClock::timezone_t timezone;
+  bool print_thread;
+
+  /** Registered format strings of the decoded file, index is ID  */
+  std::vector<std::string> formats;
+
+  std::string _render(const std::string& fmt, const char* args,
+    size_t length) const noexcept(false);
+
+}; /* class LogBinary  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_LOGBINARY_H__  */
@@ -0,0 +1,89 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "libathome-common/LogLimiter.hpp"
+
+#include <ctime>
+
+
+const char* libathome_common::LogLimiter::
+to_string(LogLimiter::mode_t mode)
+{
+  switch (mode) {
+  case rate_e: return "rate";
+  case sample_e: return "sample";
+  }
+
+  return "<not implemented!>";
+}
+
+/* ***************************************************************  */
+
+int64_t libathome_common::LogLimiter::
+_now_second()
+{
+  /* Resolution of one second is enough, the coarse clock is much
+   * cheaper.  Can't throw, it's called before logging.  On failure
+   * all messages fall into window 0.
+   */
+  ::timespec now;
+#ifdef CLOCK_MONOTONIC_COARSE
+  if (0 != ::clock_gettime(CLOCK_MONOTONIC_COARSE, &now)) return 0;
+#else
+  if (0 != ::clock_gettime(CLOCK_MONOTONIC, &now)) return 0;
+#endif
+
+  return now.tv_sec;
+}
+
+bool libathome_common::LogLimiter::
+allow(uint64_t& suppressed)
+{
+  bool pass;
+
+  if (this->mode == mode_t::sample_e) {
+    pass = this->count.fetch_add(1, std::memory_order_relaxed)
+      % this->limit == 0;
+  } else {
+    int64_t now = LogLimiter::_now_second();
+    int64_t window = this->window.load(std::memory_order_relaxed);
+
+    /* Only one thread opens the new window.  Messages of other
+     * threads, counted just before the reset, will get lost from the
+     * count.  That's fine for a limiter.
+     */
+    if (now != window && this->window.compare_exchange_strong(
+          window, now, std::memory_order_relaxed)) {
+      this->count.store(0, std::memory_order_relaxed);
+    }
+
+    /* Check first, so a storm doesn't overflow COUNT  */
+    pass = this->count.load(std::memory_order_relaxed) < this->limit
+      && this->count.fetch_add(1, std::memory_order_relaxed)
+         < this->limit;
+  }
+
+  if (!pass) {
+    this->suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  suppressed = this->suppressed.load(std::memory_order_relaxed) == 0
+    ? 0: this->suppressed.exchange(0, std::memory_order_relaxed);
+  return true;
+}
@@ -0,0 +1,105 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LIBATHOME_COMMON_LOGLIMITER_H__
+#define LIBATHOME_COMMON_LOGLIMITER_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::LogLimiter.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <atomic>
+
+namespace libathome_common
+{
+
+/**
+ * Lock-free limiter for the messages of one call site.
+ *
+ * Used by the ::LogErrorRate() and ::LogErrorSample() macros (and
+ * friends), which create one `static` instance per call site.  It
+ * decides **before** a message is formatted whether it should be
+ * written, so an error storm costs just some atomic counter
+ * operations per suppressed message.  The number of suppressed
+ * messages will be reported with the next message which passes.
+ */
+class LogLimiter
+{
+public:
+
+  /**
+   * How ::libathome_common::LogLimiter::allow() limits the messages.
+   */
+  typedef enum {
+    rate_e = 0,    ///< Pass at most `limit` messages per second
+    sample_e = 1   ///< Pass every `limit`-th message
+  } mode_t;
+
+  /**
+   * Convert a ::libathome_common::LogLimiter::mode_t to string.
+   *
+   * @param mode The mode to convert
+   * @return The string which names the mode. `static` allocated,
+   *         need NOT to be `free()`d.
+   */
+  static const char* to_string(LogLimiter::mode_t mode);
+
+  /**
+   * `constexpr`, so `static` instances in functions will be
+   * initialized at compile-time, without a guard variable.  For the
+   * same reason there is no user-defined destructor.
+   *
+   * @param mode How to limit the messages
+   * @param limit Messages per second or sample interval, `0` will be
+   *              treated as `1`
+   */
+  constexpr explicit LogLimiter(LogLimiter::mode_t mode, unsigned limit)
+    :mode(mode), limit(limit > 0? limit: 1), window(0), count(0),
+     suppressed(0)
+  {
+  }
+
+  /**
+   * Decide whether a message should be written.
+   *
+   * Thread-safe and lock-free.
+   *
+   * @param suppressed Output, if `true` was returned then the number
+   *                   of suppressed messages since the last one
+   *                   which passed
+   * @return `true` if the message should be written
+   */
+  bool allow(uint64_t& suppressed);
+
+private:
+  LogLimiter::mode_t mode;
+  unsigned limit;
+
+  /** Second of the current window, for `rate_e`  */
+  std::atomic<int64_t> window;
+  std::atomic<uint32_t> count;
+  std::atomic<uint64_t> suppressed;
+
+  static int64_t _now_second();
+
+}; /* class LogLimiter  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_LOGLIMITER_H__  */
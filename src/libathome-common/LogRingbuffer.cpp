@@ -0,0 +1,248 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "libathome-common/LogRingbuffer.hpp"
+
+#include <chrono>
+
+
+const char* libathome_common::LogRingbuffer::
+to_string(LogRingbuffer::overflow_t overflow)
+{
+  switch (overflow) {
+  case block_e: return "block";
+  case drop_newest_e: return "drop-newest";
+  case drop_oldest_e: return "drop-oldest";
+  }
+
+  return "<not implemented!>";
+}
+
+libathome_common::LogRingbuffer::
+LogRingbuffer(size_t capacity, LogRingbuffer::overflow_t overflow)
+  :overflow(overflow), enqueue_pos(0), dequeue_pos(0), pushed(0),
+   completed(0), dropped(0)
+{
+  size_t size = 2;
+  while (size < capacity) size <<= 1;
+
+  this->mask = size - 1;
+  this->cells = new cell_t[size];
+
+  for (size_t i=0; i<size; i++) {
+    this->cells[i].sequence.store(i, std::memory_order_relaxed);
+    this->cells[i].spill = NULL;
+  }
+}
+
+libathome_common::LogRingbuffer::
+~LogRingbuffer()
+{
+  std::string discard;
+  int level;
+  while (this->_try_pop(&discard, &level)) discard.clear();
+
+  delete[] this->cells;
+}
+
+/* ***************************************************************  */
+
+bool libathome_common::LogRingbuffer::
+_try_push(int level, const char* text, size_t length)
+{
+  cell_t* cell;
+  size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+
+  for (;;) {
+    cell = &this->cells[pos & this->mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+    if (diff == 0) {
+      if (this->enqueue_pos.compare_exchange_weak(
+            pos, pos + 1, std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false; /* full  */
+    } else {
+      pos = this->enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->level = level;
+  cell->length = length;
+  if (length < LogRingbuffer::RECORD_LEN) {
+    cell->spill = NULL;
+    ::memcpy(cell->text, text, length);
+  } else {
+    cell->spill = new char[length];
+    ::memcpy(cell->spill, text, length);
+  }
+
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+bool libathome_common::LogRingbuffer::
+_try_pop(std::string* batch, int* level)
+{
+  cell_t* cell;
+  size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+
+  for (;;) {
+    cell = &this->cells[pos & this->mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+
+    if (diff == 0) {
+      if (this->dequeue_pos.compare_exchange_weak(
+            pos, pos + 1, std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false; /* empty  */
+    } else {
+      pos = this->dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  *level = cell->level;
+  if (cell->spill == NULL) {
+    if (batch != NULL) batch->append(cell->text, cell->length);
+  } else {
+    if (batch != NULL) batch->append(cell->spill, cell->length);
+    delete[] cell->spill;
+    cell->spill = NULL;
+  }
+
+  cell->sequence.store(pos + this->mask + 1, std::memory_order_release);
+  return true;
+}
+
+/* ***************************************************************  */
+
+bool libathome_common::LogRingbuffer::
+push(int level, const char* text, size_t length)
+{
+  if (this->_try_push(level, text, length)) {
+    this->pushed.fetch_add(1, std::memory_order_seq_cst);
+    return true;
+  }
+
+  switch (this->overflow) {
+  case drop_newest_e:
+    this->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+
+  case drop_oldest_e:
+    for (;;) {
+      int dummy;
+      if (this->_try_pop(NULL, &dummy)) {
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        this->completed.fetch_add(1, std::memory_order_release);
+      }
+
+      if (this->_try_push(level, text, length)) break;
+    }
+    this->pushed.fetch_add(1, std::memory_order_seq_cst);
+    return true;
+
+  case block_e:
+    break;
+  }
+
+  /* block_e: Wait for the writer, it calls complete() after each
+   * batch.  The timeout protects against a missed notify between
+   * _try_push() and wait_for().
+   */
+  std::unique_lock<std::mutex> lock(this->completed_mutex);
+  while (!this->_try_push(level, text, length)) {
+    this->completed_cond.wait_for(lock, std::chrono::milliseconds(10));
+  }
+  this->pushed.fetch_add(1, std::memory_order_seq_cst);
+
+  return true;
+}
+
+bool libathome_common::LogRingbuffer::
+try_push(int level, const char* text, size_t length)
+{
+  if (!this->_try_push(level, text, length)) return false;
+
+  this->pushed.fetch_add(1, std::memory_order_seq_cst);
+  return true;
+}
+
+bool libathome_common::LogRingbuffer::
+pop(std::string& batch, int& level)
+{
+  return this->_try_pop(&batch, &level);
+}
+
+void libathome_common::LogRingbuffer::
+complete(size_t count)
+{
+  this->completed.fetch_add(count, std::memory_order_release);
+
+  std::lock_guard<std::mutex> lock(this->completed_mutex);
+  this->completed_cond.notify_all();
+}
+
+uint64_t libathome_common::LogRingbuffer::
+get_pushed() const
+{
+  return this->pushed.load(std::memory_order_acquire);
+}
+
+bool libathome_common::LogRingbuffer::
+has_pending() const
+{
+  /* SEQ_CST, pairs with the store of Logger::draining.  Otherwise
+   * the drain loop could read a stale PUSHED and strand a record.
+   */
+  return this->completed.load(std::memory_order_seq_cst)
+    < this->pushed.load(std::memory_order_seq_cst);
+}
+
+bool libathome_common::LogRingbuffer::
+is_completed(uint64_t pushed) const
+{
+  return this->completed.load(std::memory_order_seq_cst) >= pushed;
+}
+
+void libathome_common::LogRingbuffer::
+wait_completed(uint64_t pushed)
+{
+  std::unique_lock<std::mutex> lock(this->completed_mutex);
+
+  while (this->completed.load(std::memory_order_acquire) < pushed) {
+    this->completed_cond.wait_for(lock, std::chrono::milliseconds(10));
+  }
+}
+
+uint64_t libathome_common::LogRingbuffer::
+take_dropped()
+{
+  return this->dropped.exchange(0, std::memory_order_relaxed);
+}
+
+libathome_common::LogRingbuffer::overflow_t
+libathome_common::LogRingbuffer::
+get_overflow() const
+{
+  return this->overflow;
+}
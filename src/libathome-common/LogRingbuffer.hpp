@@ -0,0 +1,241 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LIBATHOME_COMMON_LOGRINGBUFFER_H__
+#define LIBATHOME_COMMON_LOGRINGBUFFER_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::LogRingbuffer.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace libathome_common
+{
+
+/**
+ * Bounded multi-producer ring buffer for preformatted log records.
+ *
+ * Used by ::libathome_common::Logger in asynchronous mode.  Any
+ * number of threads can ::libathome_common::LogRingbuffer::push()
+ * records without taking a lock, a single writer thread drains them
+ * in batches via ::libathome_common::LogRingbuffer::pop().  The
+ * implementation is a sequence-numbered array queue, so pushing a
+ * record costs one compare-and-swap plus a `memcpy()` of the text.
+ *
+ * If the ring buffer is full, the
+ * ::libathome_common::LogRingbuffer::overflow_t policy decides what
+ * happens.  Dropped records are counted and can be fetched via
+ * ::libathome_common::LogRingbuffer::take_dropped().
+ */
+class LogRingbuffer
+{
+public:
+
+  /**
+   * What to do if a record is pushed into a full ring buffer.
+   */
+  typedef enum {
+    block_e = 0,        ///< Wait until the writer made room
+    drop_newest_e = 1,  ///< Discard the record which should be pushed
+    drop_oldest_e = 2   ///< Discard the oldest record in the buffer
+  } overflow_t;
+
+  /**
+   * Convert a ::libathome_common::LogRingbuffer::overflow_t to
+   * string.
+   *
+   * @param overflow The overflow policy to convert
+   * @return The string which names the policy. `static` allocated,
+   *         need NOT to be `free()`d.
+   */
+  static const char* to_string(LogRingbuffer::overflow_t overflow);
+
+  /**
+   * Length of the text which fits into one slot without allocating.
+   *
+   * Longer records, such like ::libathome_common::Error messages with
+   * backtrace, will be spilled to the heap.
+   */
+  static const size_t RECORD_LEN = 512;
+
+  /**
+   * Allocates all slots, nothing else will be allocated later for
+   * records shorter than
+   * ::libathome_common::LogRingbuffer::RECORD_LEN.
+   *
+   * @param capacity Number of slots, will be rounded up to the next
+   *                 power of two
+   * @param overflow Policy if the ring buffer is full
+   */
+  explicit LogRingbuffer(
+    size_t capacity, LogRingbuffer::overflow_t overflow);
+  /**
+   * Frees all slots and records which were never popped.
+   */
+  virtual ~LogRingbuffer();
+
+  /**
+   * Copy a preformatted record into the ring buffer.
+   *
+   * Thread-safe and lock-free, unless the ring buffer is full and
+   * the overflow policy is
+   * ::libathome_common::LogRingbuffer::block_e.
+   *
+   * @param level Log-level of the record
+   * @param text The preformatted text, including newline
+   * @param length Length of `text` in bytes
+   * @return `false` if the record was dropped
+   */
+  bool push(int level, const char* text, size_t length);
+
+  /**
+   * Copy a preformatted record into the ring buffer, if there is a
+   * free slot.
+   *
+   * Unlike ::libathome_common::LogRingbuffer::push() the overflow
+   * policy is ignored, nothing will be dropped and it never blocks.
+   * Used in synchronous mode, where the caller must drain the ring
+   * buffer itself until there is room.
+   *
+   * @param level Log-level of the record
+   * @param text The preformatted text, including newline
+   * @param length Length of `text` in bytes
+   * @return `false` if the ring buffer is full
+   */
+  bool try_push(int level, const char* text, size_t length);
+
+  /**
+   * Take the oldest record out of the ring buffer and append its
+   * text to `batch`.
+   *
+   * Must only be called by one thread at a time, usally the writer
+   * thread of ::libathome_common::Logger.
+   *
+   * @param batch The text of the record will be appended here
+   * @param level Output, log-level of the record if `true` was
+   *              returned
+   * @return `false` if the ring buffer is empty
+   */
+  bool pop(std::string& batch, int& level);
+
+  /**
+   * Mark popped records as completely written and wake up all
+   * threads which are waiting in
+   * ::libathome_common::LogRingbuffer::wait_completed() or are
+   * blocked because the ring buffer was full.
+   *
+   * @param count Number of records which were written
+   */
+  void complete(size_t count);
+
+  /**
+   * Number of records which were successfully pushed since
+   * construction.
+   *
+   * @return Ticket to pass to
+   *         ::libathome_common::LogRingbuffer::wait_completed()
+   */
+  uint64_t get_pushed() const;
+
+  /**
+   * Returns `true` if pushed records are not completely written
+   * yet.
+   *
+   * @return `false` if all pushed records were
+   *         ::libathome_common::LogRingbuffer::complete()d or dropped
+   */
+  bool has_pending() const;
+
+  /**
+   * Returns `true` if all records up to ticket `pushed` were written
+   * (or dropped).
+   *
+   * @param pushed Result of
+   *               ::libathome_common::LogRingbuffer::get_pushed()
+   * @return `false` if ::libathome_common::LogRingbuffer::wait_completed()
+   *         would block
+   */
+  bool is_completed(uint64_t pushed) const;
+
+  /**
+   * Blocks until all records up to ticket `pushed` were written
+   * (or dropped).
+   *
+   * @param pushed Result of
+   *               ::libathome_common::LogRingbuffer::get_pushed()
+   */
+  void wait_completed(uint64_t pushed);
+
+  /**
+   * Returns the number of dropped records since the last call and
+   * resets the counter.
+   *
+   * @return Number of dropped records
+   */
+  uint64_t take_dropped();
+
+  /**
+   * Returns the overflow policy.
+   *
+   * @return The policy which was passed to the constructor
+   */
+  LogRingbuffer::overflow_t get_overflow() const;
+
+private:
+  typedef struct {
+    std::atomic<size_t> sequence;
+    int level;
+    size_t length;
+    /** Heap text if `length >= RECORD_LEN`, otherwise `NULL`  */
+    char* spill;
+    char text[RECORD_LEN];
+  } cell_t;
+
+  LogRingbuffer::overflow_t overflow;
+
+  cell_t* cells;
+  size_t mask;
+
+  /* On separate cache lines, producers and the writer should not
+   * disturb each other.
+   */
+  char _padding0[64];
+  std::atomic<size_t> enqueue_pos;
+  char _padding1[64];
+  std::atomic<size_t> dequeue_pos;
+  char _padding2[64];
+
+  std::atomic<uint64_t> pushed;
+  std::atomic<uint64_t> completed;
+  std::atomic<uint64_t> dropped;
+
+  std::mutex completed_mutex;
+  std::condition_variable completed_cond;
+
+  bool _try_push(int level, const char* text, size_t length);
+  bool _try_pop(std::string* batch, int* level);
+
+}; /* class LogRingbuffer  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_LOGRINGBUFFER_H__  */
@@ -17,22 +17,39 @@
 
 
 #include "libathome-common/Logger.hpp"
+#include "libathome-common/Filesystem.hpp"
+
+#include <limits>
+#include <memory>
+#include <algorithm>
+#include <zlib.h>
 
 
 void libathome_common::Logger::
 _init()
 {
-  this->strftime_fmt = "[%H:%M:%S]";
-
-  this->info("*** Log session initialized; log-level=%s; timezone=%s",
-             Logger::to_string(this->loglevel),
-             RealtimeClock::to_string(this->timezone));
+  this->strftime_fmt = "[%H:%M:%S.%3N]";
+  this->timestamp_generation = Logger::_timestamp_generation_next++;
+  this->last_flush = std::chrono::steady_clock::now();
+
+  this->info("*** Log session initialized; log-level=%s; timezone=%s;"
+             " format=%s", Logger::to_string(this->loglevel.load()),
+             RealtimeClock::to_string(this->timezone.load()),
+             Logger::to_string(this->format));
 }
 
 libathome_common::Logger::
 Logger(Logger::loglevel_t loglevel, RealtimeClock::timezone_t timezone)
   :File(stdout, "<stdout>"), loglevel(loglevel), timezone(timezone),
-   file_fmt("%Y-%m-%d.log"), file_count(365)
+   format(Logger::text_e), file_fmt("%Y-%m-%d.log"), file_count(365),
+   file_period(RealtimeClock::period_t::day_e),
+   rollover_at(std::numeric_limits< ::time_t>::max()), compress(false),
+   housekeeper_stop(false), housekeeper_prune(false), flush_bytes(0),
+   flush_interval(0), unflushed(0),
+   ringbuffer(new LogRingbuffer(
+     Logger::_SYNC_CAPACITY, LogRingbuffer::block_e)),
+   draining(false), async(false), writer_stop(false),
+   writer_sleeping(false)
 {
   this->_init();
 }
@@ -40,10 +57,27 @@ Logger(Logger::loglevel_t loglevel, RealtimeClock::timezone_t timezone)
 libathome_common::Logger::
 Logger(Logger::loglevel_t loglevel, RealtimeClock::timezone_t timezone,
   const std::string& path, const std::string& file_fmt,
-  unsigned file_count)
-  :File(path, "tmp.log", false), loglevel(loglevel), timezone(timezone),
-   file_fmt(file_fmt), file_count(file_count)
+  unsigned file_count, Logger::format_t format)
+  :File(path, file_fmt, format == Logger::binary_e), loglevel(loglevel),
+   timezone(timezone), format(format), file_fmt(file_fmt), file_count(file_count),
+   file_period(RealtimeClock::strftime_period(file_fmt)),
+   rollover_at(0), compress(false), housekeeper_stop(false),
+   housekeeper_prune(false), flush_bytes(0), flush_interval(0),
+   unflushed(0),
+   ringbuffer(new LogRingbuffer(
+     Logger::_SYNC_CAPACITY, LogRingbuffer::block_e)),
+   draining(false), async(false), writer_stop(false),
+   writer_sleeping(false)
 {
+  this->set_flush_policy(
+    Logger::_BUFFER_SIZE, Logger::_FLUSH_BYTES, Logger::_FLUSH_MS);
+
+  try {
+    this->_rotate();
+  } catch (Error& e) {
+    ::fprintf(stderr, "ERROR: %s\n", e.what());
+  }
+
   this->_init();
 }
 
@@ -51,10 +85,36 @@ libathome_common::Logger::
 ~Logger()
 {
   this->info("*** Log session closed, bye *zzz* ...");
+
+  this->async_stop();
+
+  try {
+    File::flush();
+  } catch (Error& e) {
+    ::fprintf(stderr, "ERROR: %s\n", e.what());
+  }
+  File::close();
+
+  delete this->ringbuffer;
+
+  if (this->housekeeper.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(this->housekeeper_mutex);
+      this->housekeeper_stop = true;
+      this->housekeeper_cond.notify_one();
+    }
+    this->housekeeper.join();
+  }
 }
 
 libathome_common::Logger* libathome_common::Log = NULL;
 
+const char* libathome_common::Logger::_COMPRESS_SUFFIX = ".gz";
+const unsigned libathome_common::Logger::_ASYNC_SLEEP_MS;
+
+std::atomic<unsigned>
+libathome_common::Logger::_timestamp_generation_next(1);
+
 /* ***************************************************************  */
 
 const char* libathome_common::Logger::
@@ -73,25 +133,50 @@ to_string(Logger::loglevel_t loglevel)
   return "<not implemented!>";
 }
 
+const char* libathome_common::Logger::
+to_string(Logger::format_t format)
+{
+  switch (format) {
+  case text_e: return "text";
+  case binary_e: return "binary";
+  }
+
+  return "<not implemented!>";
+}
+
 void libathome_common::Logger::
 set_loglevel(Logger::loglevel_t loglevel)
 {
   this->loglevel = loglevel;
 
   this->info("*** Log session set; log-level=%s",
-    Logger::to_string(this->loglevel));
+    Logger::to_string(loglevel));
 }
 
 void libathome_common::Logger::
 set_timezone(RealtimeClock::timezone_t timezone)
 {
   this->debug("<-- Log session; timezone=%s",
-    RealtimeClock::to_string(this->timezone));
+    RealtimeClock::to_string(this->timezone.load()));
 
   this->timezone = timezone;
+  this->timestamp_generation = Logger::_timestamp_generation_next++;
 
   this->info("*** Log session set; timezone=%s",
-    RealtimeClock::to_string(this->timezone));
+    RealtimeClock::to_string(timezone));
+}
+
+void libathome_common::Logger::
+set_time_format(const std::string& strftime_fmt)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->strftime_mutex);
+    this->strftime_fmt = strftime_fmt;
+    this->timestamp_generation = Logger::_timestamp_generation_next++;
+  }
+
+  this->debug("*** Log session set; time-format=%s",
+    strftime_fmt.c_str());
 }
 
 libathome_common::Logger::loglevel_t libathome_common::Logger::
@@ -106,31 +191,582 @@ get_timezone() const
   return this->timezone;
 }
 
+libathome_common::Logger::format_t libathome_common::Logger::
+get_format() const
+{
+  return this->format;
+}
+
+std::string libathome_common::Logger::
+get_time_format() const
+{
+  std::lock_guard<std::mutex> lock(this->strftime_mutex);
+  return this->strftime_fmt;
+}
+
+void libathome_common::Logger::
+set_flush_policy(size_t buffer_size, size_t flush_bytes, unsigned flush_ms)
+{
+  File::set_buffer(buffer_size);
+
+  this->flush_bytes = flush_bytes;
+  this->flush_interval = std::chrono::milliseconds(flush_ms);
+}
+
+void libathome_common::Logger::
+set_compress(bool compress)
+{
+  this->compress = compress;
+}
+
 /* ***************************************************************  */
 
 void libathome_common::Logger::
-vprintf(Logger::loglevel_t level, const char* fmt, ::va_list ap)
+_rotate() noexcept(false)
+{
+  RealtimeClock rtc(this->timezone);
+
+  this->rollover_at = rtc.get_next(this->file_period);
+
+  std::string filename = rtc.to_string(this->file_fmt);
+  if (File::is_open() && filename == File::get_filename()) return;
+
+  std::string previous;
+  if (File::is_open()) {
+    previous = File::get_path() + Filesystem::PATH_SEPERATOR
+      + File::get_filename();
+
+    this->unflushed = 0;
+    File::flush();
+    File::close();
+  }
+  File::set_filename(filename);
+
+  /* Pruning and compression are slow, do it in background
+   */
+  std::lock_guard<std::mutex> lock(this->housekeeper_mutex);
+
+  this->housekeeper_prune = true;
+  this->housekeeper_current = filename;
+  if (this->compress && !previous.empty())
+    this->housekeeper_compress.push_back(previous);
+
+  if (!this->housekeeper.joinable()) {
+    this->housekeeper = std::thread(&Logger::_housekeeper_main, this);
+  }
+  this->housekeeper_cond.notify_one();
+}
+
+void libathome_common::Logger::
+_housekeeper_main()
+{
+  std::unique_lock<std::mutex> lock(this->housekeeper_mutex);
+
+  for (;;) {
+    while (!this->housekeeper_stop && !this->housekeeper_prune
+           && this->housekeeper_compress.empty()) {
+      this->housekeeper_cond.wait(lock);
+    }
+
+    std::vector<std::string> compress;
+    compress.swap(this->housekeeper_compress);
+    bool prune = this->housekeeper_prune;
+    this->housekeeper_prune = false;
+    std::string current = this->housekeeper_current;
+
+    if (compress.empty() && !prune && this->housekeeper_stop) break;
+
+    lock.unlock();
+
+    /* Still running while ~Logger() has already closed the file and
+     * deleted the ring buffer.  So we are using FPRINTF to STDERR for
+     * output.
+     */
+    for (const std::string& filename_full: compress) {
+      try {
+        this->_housekeeper_compress(filename_full);
+      } catch (Error& e) {
+        ::fprintf(stderr, "ERROR: %s\n", e.what());
+      }
+    }
+    if (prune) {
+      try {
+        this->_housekeeper_prune(current);
+      } catch (Error& e) {
+        ::fprintf(stderr, "ERROR: %s\n", e.what());
+      }
+    }
+
+    lock.lock();
+  }
+}
+
+void libathome_common::Logger::
+_housekeeper_compress(const std::string& filename_full)
+{
+  std::string gz_full = filename_full + Logger::_COMPRESS_SUFFIX;
+
+  ::FILE* in = ::fopen(filename_full.c_str(), "rb");
+  if (in == NULL) {
+    throw Err("Could not open file '%s' for compression: %s!",
+              filename_full.c_str(), ::strerror(errno));
+  }
+
+  ::gzFile out = ::gzopen(gz_full.c_str(), "wb");
+  if (out == NULL) {
+    ::fclose(in);
+    throw Err("Could not open file '%s' for compression!",
+              gz_full.c_str());
+  }
+
+  char buf[64*1024];
+  size_t len;
+  bool iserror = false;
+  while (0 < (len = ::fread(buf, 1, sizeof(buf), in))) {
+    if ((int) len != ::gzwrite(out, buf, (unsigned) len)) {
+      iserror = true;
+      break;
+    }
+  }
+  iserror = iserror || ::ferror(in);
+
+  ::fclose(in);
+  if (Z_OK != ::gzclose(out)) iserror = true;
+
+  if (iserror) {
+    ::remove(gz_full.c_str());
+    throw Err("Could not compress file '%s'!", filename_full.c_str());
+  }
+
+  Filesystem::remove(filename_full);
+}
+
+void libathome_common::Logger::
+_housekeeper_prune(const std::string& current)
+{
+  if (this->file_count == 0) return;
+
+  /* Literal parts of FILE_FMT before first and after last conversion
+   */
+  size_t first = this->file_fmt.find('%');
+  size_t last = this->file_fmt.rfind('%');
+  std::string prefix = this->file_fmt.substr(0, first);
+  std::string suffix = last == std::string::npos || last+2 > this->
+    file_fmt.length()? "": this->file_fmt.substr(last + 2);
+
+  /* On startup it may be not created yet  */
+  Filesystem::mkdir_p(File::get_path());
+
+  std::vector<std::string> names;
+  for (std::string name: Filesystem::list(File::get_path())) {
+    size_t gz_len = ::strlen(Logger::_COMPRESS_SUFFIX);
+    if (name.length() > gz_len && 0 == name.compare(
+          name.length() - gz_len, gz_len, Logger::_COMPRESS_SUFFIX)) {
+      name.resize(name.length() - gz_len);
+    }
+
+    if (name.length() < prefix.length() + suffix.length()
+        || 0 != name.compare(0, prefix.length(), prefix)
+        || 0 != name.compare(name.length() - suffix.length(),
+                             suffix.length(), suffix)
+        || name == current) {
+      continue;
+    }
+
+    names.push_back(name);
+  }
+
+  std::sort(names.begin(), names.end());
+  names.erase(std::unique(names.begin(), names.end()), names.end());
+
+  /* The current file counts too
+   */
+  if (names.size() + 1 <= this->file_count) return;
+  size_t remove_count = names.size() + 1 - this->file_count;
+
+  for (size_t i=0; i<remove_count; i++) {
+    std::string name_full
+      = File::get_path() + Filesystem::PATH_SEPERATOR + names[i];
+
+    /* One of both may not exist  */
+    ::remove(name_full.c_str());
+    ::remove((name_full + Logger::_COMPRESS_SUFFIX).c_str());
+  }
+}
+
+/* ***************************************************************  */
+
+void libathome_common::Logger::
+async_start(size_t capacity, LogRingbuffer::overflow_t overflow)
+{
+  if (this->async.load()) return;
+
+  /* Nobody logs concurrently, so the ring buffer can be replaced
+   * after it was drained.
+   */
+  this->flush();
+  delete this->ringbuffer;
+  this->ringbuffer = new LogRingbuffer(capacity, overflow);
+
+  this->writer_stop.store(false);
+  this->writer = std::thread(&Logger::_writer_main, this);
+  this->async.store(true);
+
+  this->info("*** Log session set; async=on; capacity=%lu; overflow=%s",
+    (unsigned long) capacity, LogRingbuffer::to_string(overflow));
+}
+
+void libathome_common::Logger::
+async_stop()
+{
+  if (!this->async.load()) return;
+
+  this->writer_stop.store(true);
+  this->_writer_wakeup();
+  this->writer.join();
+  this->async.store(false);
+
+  delete this->ringbuffer;
+  this->ringbuffer
+    = new LogRingbuffer(Logger::_SYNC_CAPACITY, LogRingbuffer::block_e);
+}
+
+bool libathome_common::Logger::
+is_async() const
+{
+  return this->async.load();
+}
+
+void libathome_common::Logger::
+flush()
+{
+  uint64_t ticket = this->ringbuffer->get_pushed();
+
+  if (this->async.load()) {
+    this->_writer_wakeup();
+    this->ringbuffer->wait_completed(ticket);
+  } else {
+    this->_wait_drained(ticket);
+  }
+}
+
+/* ---------------------------------------------------------------  */
+
+size_t libathome_common::Logger::
+_write_batch(std::string& batch)
+{
+  uint64_t dropped = this->ringbuffer->take_dropped();
+  if (dropped > 0) {
+    string_t buf;
+    int len = ::snprintf(buf, STRING_LEN,
+      ": *** Log session dropped %lu messages; overflow=%s\n",
+      (unsigned long) dropped,
+      LogRingbuffer::to_string(this->ringbuffer->get_overflow()));
+
+    try {
+      if (this->format == Logger::binary_e) {
+        /* Without leading ": " and trailing newline  */
+        LogBinary::encode_text(
+          batch, loglevel_t::warning_e, buf + 2, len - 3);
+
+        /* A format string is written only with its first message.  If
+         * that one was dropped, the later messages of it could not be
+         * decoded.  The decoder collects the formats of the whole file
+         * first, so writing all of them again is enough.
+         */
+        LogBinary::encode_formats(batch);
+      } else {
+        string_t timestr;
+        this->_timestamp(timestr, STRING_LEN);
+        batch.append(timestr).append(" ")
+          .append(Logger::to_string(loglevel_t::warning_e)).append(buf);
+      }
+    } catch (Error& e) {
+      ::fprintf(stderr, "ERROR: %s\n", e.what());
+    }
+  }
+
+  size_t count = 0;
+  int level, level_max = loglevel_t::all_e;
+  while (count < Logger::_ASYNC_BATCH_MAX
+         && this->ringbuffer->pop(batch, level)) {
+    if (level > level_max) level_max = level;
+    count++;
+  }
+
+  if (!batch.empty()) {
+    this->_write((loglevel_t) level_max, batch.c_str(), batch.length());
+    batch.clear();
+  }
+  if (count > 0) this->ringbuffer->complete(count);
+
+  return count;
+}
+
+void libathome_common::Logger::
+_drain()
+{
+  static thread_local std::string batch;
+
+  /* Flat combining: The first thread drains the messages of all
+   * threads, the others just return.  After releasing DRAINING it
+   * must be checked again, a message may be pushed just before.
+   *
+   * Producers increment PUSHED and then exchange DRAINING, we store
+   * DRAINING and then load PUSHED.  Only SEQ_CST forbids reordering
+   * both, so at least one of us sees the other.
+   */
+  while (!this->draining.exchange(true, std::memory_order_seq_cst)) {
+    while (this->_write_batch(batch) > 0) {}
+
+    this->draining.store(false, std::memory_order_seq_cst);
+    if (!this->ringbuffer->has_pending()) break;
+  }
+}
+
+void libathome_common::Logger::
+_wait_drained(uint64_t ticket)
+{
+  /* Synchronous mode has no writer thread which could wake us up,
+   * so take over draining if the other thread has finished.
+   */
+  while (!this->ringbuffer->is_completed(ticket)) {
+    this->_drain();
+    std::this_thread::yield();
+  }
+}
+
+void libathome_common::Logger::
+_writer_wakeup()
 {
-  if (this->loglevel > level) return;
+  std::lock_guard<std::mutex> lock(this->writer_mutex);
+  this->writer_cond.notify_one();
+}
+
+void libathome_common::Logger::
+_writer_main()
+{
+  std::string batch;
+  batch.reserve(Logger::_ASYNC_BATCH_MAX * LogRingbuffer::RECORD_LEN);
+
+  for (;;) {
+    if (this->_write_batch(batch) > 0) continue;
+
+    if (this->writer_stop.load()) break;
 
+    /* Nothing to do, sleep until a producer or flush() wakes us up
+     */
+    std::unique_lock<std::mutex> lock(this->writer_mutex);
+    this->writer_sleeping.store(true);
+    this->writer_cond.wait_for(
+      lock, std::chrono::milliseconds(Logger::_ASYNC_SLEEP_MS));
+    this->writer_sleeping.store(false);
+    lock.unlock();
+
+    std::chrono::steady_clock::time_point now
+      = std::chrono::steady_clock::now();
+    if (this->unflushed > 0
+        && now - this->last_flush >= this->flush_interval) {
+      try {
+        this->_flush_file(now);
+      } catch (Error& e) {
+        ::fprintf(stderr, "ERROR: %s\n", e.what());
+      }
+    }
+  }
+}
+
+/* ***************************************************************  */
+
+void libathome_common::Logger::
+_flush_file(std::chrono::steady_clock::time_point now)
+{
+  this->unflushed = 0;
+  this->last_flush = now;
+
+  File::flush();
+
+  /* The new file must start with its own session too, otherwise it
+   * could not be decoded.
+   */
+  if (File::reopen_if_moved() && this->format == Logger::binary_e)
+    this->_write_session();
+}
+
+void libathome_common::Logger::
+_write(Logger::loglevel_t level, const char* text, size_t length)
+{
   try {
-    RealtimeClock rtc(this->timezone);
+    /* Keep it open for the whole session.  Opening a file for every
+     * message costs a MKDIR and FOPEN/FCLOSE.
+     */
+    if (::time(NULL) >= this->rollover_at) this->_rotate();
+    if (!File::is_open()) {
+      File::open(File::access_t::append_e);
+      if (this->format == Logger::binary_e) this->_write_session();
+    }
+
+    File::write(text, length);
+    this->unflushed += length;
+
+    std::chrono::steady_clock::time_point now
+      = std::chrono::steady_clock::now();
+    if (level >= loglevel_t::error_e
+        || this->unflushed >= this->flush_bytes
+        || now - this->last_flush >= this->flush_interval) {
+      this->_flush_file(now);
+    }
+  } catch (Error& e) {
+    /* LOGGER not working here.  So we are using FPRINTF to STDERR for
+     * output.
+     */
+    ::fprintf(stderr, "ERROR: %s\n", e.what());
+
+    File::close();
+  }
+}
+
+void libathome_common::Logger::
+_write_session() noexcept(false)
+{
+  /* Every opened file starts with a session and all known format
+   * strings, so it can be decoded on its own.
+   */
+  std::string session;
+  LogBinary::encode_session(session, this->timezone);
+  LogBinary::encode_formats(session);
+
+  File::write(session.c_str(), session.length());
+  this->unflushed += session.length();
+}
+
+size_t libathome_common::Logger::
+_timestamp(char* buf, size_t size) noexcept(false)
+{
+  /* One cache per thread, so formatting never needs a lock.  The
+   * generation is unique per Logger instance and format, a mismatch
+   * means that the cache is stale.
+   */
+  static thread_local unsigned cache_generation = 0;
+  static thread_local std::unique_ptr<TimestampCache> cache;
+
+  unsigned generation
+    = this->timestamp_generation.load(std::memory_order_acquire);
+  if (cache_generation != generation) {
+    std::lock_guard<std::mutex> lock(this->strftime_mutex);
+
+    generation = this->timestamp_generation.load();
+    cache.reset(new TimestampCache(this->timezone, this->strftime_fmt));
+    cache_generation = generation;
+  }
+
+  return cache->format(buf, size);
+}
+
+void libathome_common::Logger::
+_output(Logger::loglevel_t level, const char* text, size_t length)
+{
+  if (this->async.load(std::memory_order_relaxed)) {
+    this->ringbuffer->push(level, text, length);
+
+    if (this->writer_sleeping.load(std::memory_order_relaxed))
+      this->_writer_wakeup();
+    return;
+  }
+
+  /* No writer thread makes room for us, so drain it ourself  */
+  while (!this->ringbuffer->try_push(level, text, length))
+    this->_drain();
+
+  this->_drain();
+
+  /* Another thread may still be draining our message  */
+  if (level >= loglevel_t::error_e)
+    this->_wait_drained(this->ringbuffer->get_pushed());
+}
+
+void libathome_common::Logger::
+_vprintf_binary(Logger::loglevel_t level, const char* fmt, ::va_list ap)
+{
+  /* Reused by every message of this thread, so it allocates only
+   * until it has grown large enough.
+   */
+  static thread_local std::string record;
+  record.clear();
+
+  bool is_new;
+  uint32_t id = LogBinary::register_format(fmt, is_new);
+  if (is_new) LogBinary::encode_format(record, id, fmt);
+
+  ::va_list ap_copy;
+  ::va_copy(ap_copy, ap);
+  bool encoded = id != 0
+    && LogBinary::encode_message(record, level, id, fmt, ap_copy);
+  ::va_end(ap_copy);
+
+  if (!encoded) {
+    /* Unsupported conversions or too many format strings  */
+    ::va_copy(ap_copy, ap);
+    int msg_len = ::vsnprintf(NULL, 0, fmt, ap_copy);
+    ::va_end(ap_copy);
+    if (msg_len < 0) throw Err("Could not format log message '%s'!", fmt);
+
+    std::string msg(msg_len + 1, '\0');
+    ::vsnprintf(&msg[0], msg_len + 1, fmt, ap);
+    LogBinary::encode_text(record, level, msg.c_str(), msg_len);
+  }
+
+  this->_output(level, record.c_str(), record.length());
+}
 
-    File::open(File::access_t::append_e);
+void libathome_common::Logger::
+vprintf(Logger::loglevel_t level, const char* fmt, ::va_list ap)
+{
+  if (!this->is_loggable(level)) return;
+
+  try {
+    if (this->format == Logger::binary_e) {
+      this->_vprintf_binary(level, fmt, ap);
+      return;
+    }
 
-    std::string timestr = rtc.to_string(this->strftime_fmt);
     const char* lvlname = Logger::to_string(level);
 
-    std::string out_fmt = timestr + " " + lvlname + ": " + fmt + "\n";
-    File::vprintf(out_fmt.c_str(), ap);
+    /* Format the whole line on stack, only very long messages (such
+     * like backtraces) need the heap.
+     */
+    char line[LogRingbuffer::RECORD_LEN];
+    size_t time_len = this->_timestamp(line, LogRingbuffer::RECORD_LEN);
+    int prefix_len = ::snprintf(line + time_len,
+      LogRingbuffer::RECORD_LEN - time_len, " %s: ", lvlname);
+    if (prefix_len < 0
+        || time_len + prefix_len >= LogRingbuffer::RECORD_LEN)
+      throw Err("Could not format prefix of log message!");
+    prefix_len += time_len;
+
+    size_t avail = LogRingbuffer::RECORD_LEN - prefix_len;
+    ::va_list ap_copy;
+    ::va_copy(ap_copy, ap);
+    int msg_len = ::vsnprintf(line + prefix_len, avail, fmt, ap_copy);
+    ::va_end(ap_copy);
+    if (msg_len < 0) throw Err("Could not format log message '%s'!", fmt);
+
+    if ((size_t) msg_len + 1 < avail) {
+      line[prefix_len + msg_len] = '\n';
+      this->_output(level, line, prefix_len + msg_len + 1);
+    } else {
+      std::string big(prefix_len + msg_len + 1, '\n');
+      ::memcpy(&big[0], line, prefix_len);
+      ::vsnprintf(&big[prefix_len], msg_len + 1, fmt, ap);
+      big[prefix_len + msg_len] = '\n';
+      this->_output(level, big.c_str(), big.length());
+    }
   } catch (Error& e) {
     /* LOGGER not working here.  So we are using FPRINTF to STDERR for
      * output.
      */
     ::fprintf(stderr, "ERROR: %s\n", e.what());
   }
-
-  File::close();
 }
 
 /* ***************************************************************  */
@@ -138,6 +774,8 @@ vprintf(Logger::loglevel_t level, const char* fmt, ::va_list ap)
 void libathome_common::Logger::
 debug(const char* fmt, ...)
 {
+  if (!this->is_loggable(loglevel_t::debug_e)) return;
+
   ::va_list ap;
 
   ::va_start(ap, fmt);
@@ -148,6 +786,8 @@ debug(const char* fmt, ...)
 void libathome_common::Logger::
 info(const char* fmt, ...)
 {
+  if (!this->is_loggable(loglevel_t::info_e)) return;
+
   ::va_list ap;
 
   ::va_start(ap, fmt);
@@ -158,6 +798,8 @@ info(const char* fmt, ...)
 void libathome_common::Logger::
 warn(const char* fmt, ...)
 {
+  if (!this->is_loggable(loglevel_t::warning_e)) return;
+
   ::va_list ap;
 
   ::va_start(ap, fmt);
@@ -168,6 +810,8 @@ warn(const char* fmt, ...)
 void libathome_common::Logger::
 error(const char* fmt, ...)
 {
+  if (!this->is_loggable(loglevel_t::error_e)) return;
+
   ::va_list ap;
 
   ::va_start(ap, fmt);
@@ -184,6 +828,7 @@ fatal(int exit_code, const char* fmt, ...)
   this->vprintf(loglevel_t::fatal_e, fmt, ap);
   ::va_end(ap);
 
+  this->flush();
   ::exit(exit_code);
 }
 
@@ -192,24 +837,32 @@ fatal(int exit_code, const char* fmt, ...)
 void libathome_common::Logger::
 debug(const std::string& output)
 {
+  if (!this->is_loggable(loglevel_t::debug_e)) return;
+
   this->debug("%s", output.c_str());
 }
 
 void libathome_common::Logger::
 info(const std::string& output)
 {
+  if (!this->is_loggable(loglevel_t::info_e)) return;
+
   this->info("%s", output.c_str());
 }
 
 void libathome_common::Logger::
 warn(const std::string& output)
 {
+  if (!this->is_loggable(loglevel_t::warning_e)) return;
+
   this->warn("%s", output.c_str());
 }
 
 void libathome_common::Logger::
 error(const std::string& output)
 {
+  if (!this->is_loggable(loglevel_t::error_e)) return;
+
   this->error("%s", output.c_str());
 }
 
@@ -224,24 +877,32 @@ fatal(int exit_code, const std::string& output)
 void libathome_common::Logger::
 debug(const Error& e)
 {
+  if (!this->is_loggable(loglevel_t::debug_e)) return;
+
   this->debug("%s", e.what());
 }
 
 void libathome_common::Logger::
 info(const Error& e)
 {
+  if (!this->is_loggable(loglevel_t::info_e)) return;
+
   this->info("%s", e.what());
 }
 
 void libathome_common::Logger::
 warn(const Error& e)
 {
+  if (!this->is_loggable(loglevel_t::warning_e)) return;
+
   this->warn("%s", e.what());
 }
 
 void libathome_common::Logger::
 error(const Error& e)
 {
+  if (!this->is_loggable(loglevel_t::error_e)) return;
+
   this->error("%s", e.what());
 }
 
@@ -27,6 +27,155 @@
 #include "libathome-common/RealtimeClock.hpp"
 #include "libathome-common/File.hpp"
 #include "libathome-common/Error.hpp"
+#include "libathome-common/LogRingbuffer.hpp"
+#include "libathome-common/LogBinary.hpp"
+#include "libathome-common/LogLimiter.hpp"
+#include "libathome-common/TimestampCache.hpp"
+
+#include <thread>
+#include <chrono>
+
+/* Compile-time log-level
+ */
+
+/**
+ * Minimum log-level which will be compiled into the binary.
+ *
+ * Set via `LOGLEVEL_MIN` in `makefile.config.mk`.  Its value is one
+ * of ::libathome_common::Logger::loglevel_t.  The ::LogDebug(),
+ * ::LogInfo(), ::LogWarn() and ::LogError() macros with a lower
+ * log-level will be removed completely by the compiler, and the
+ * ::libathome_common::Logger methods will return immediately.
+ */
+#ifndef LOGLEVEL_MIN
+#  define LOGLEVEL_MIN             0
+#endif /* ifndef LOGLEVEL_MIN  */
+
+/// @cond Doxygen_Suppress
+#define _LOG_IF(level, method, fmt ...) do { \
+          if ((level) >= LOGLEVEL_MIN && libathome_common::Log != NULL \
+              && libathome_common::Log->is_loggable( \
+                   (libathome_common::Logger::loglevel_t) (level))) \
+            libathome_common::Log->method(fmt); \
+        } while (0)
+/// @endcond
+
+/**
+ * Write debug output via ::libathome_common::Log, if its log-level
+ * allows it.
+ *
+ * Same as `Log->debug(...)`, but the log-level is checked **before**
+ * the arguments are evaluated.  If `LOGLEVEL_MIN` is higher than
+ * ::libathome_common::Logger::debug_e then the whole call will be
+ * removed from the binary.
+ *
+ * **Example**
+ * ```cpp
+ * LogDebug("task %lu: %s", task_id, expensive_dump().c_str());
+ * ```
+ */
+#define LogDebug(fmt ...)          _LOG_IF(10, debug, fmt)
+/**
+ * Write info output via ::libathome_common::Log, see ::LogDebug().
+ */
+#define LogInfo(fmt ...)           _LOG_IF(20, info, fmt)
+/**
+ * Write warning output via ::libathome_common::Log, see ::LogDebug().
+ */
+#define LogWarn(fmt ...)           _LOG_IF(30, warn, fmt)
+/**
+ * Write ERROR output via ::libathome_common::Log, see ::LogDebug().
+ */
+#define LogError(fmt ...)          _LOG_IF(40, error, fmt)
+/**
+ * Write FATAL ERROR output via ::libathome_common::Log and `exit()`.
+ *
+ * Will never be removed by `LOGLEVEL_MIN`, because the process must
+ * exit anyway.
+ */
+#define LogFatal(exit_code, fmt ...) \
+          libathome_common::Log->fatal(exit_code, fmt)
+
+/* Rate-limited and sampled logging
+ */
+
+/// @cond Doxygen_Suppress
+#define _LOG_LIMITED(level, method, mode, limit, fmt ...) do { \
+          static libathome_common::LogLimiter _log_limiter( \
+            libathome_common::LogLimiter::mode, (limit)); \
+          uint64_t _log_suppressed; \
+          if ((level) >= LOGLEVEL_MIN && libathome_common::Log != NULL \
+              && libathome_common::Log->is_loggable( \
+                   (libathome_common::Logger::loglevel_t) (level)) \
+              && _log_limiter.allow(_log_suppressed)) { \
+            if (_log_suppressed > 0) \
+              libathome_common::Log->method( \
+                "*** Log suppressed %lu similar messages; site=%s:%d", \
+                (unsigned long) _log_suppressed, __FILE__, __LINE__); \
+            libathome_common::Log->method(fmt); \
+          } \
+        } while (0)
+/// @endcond
+
+/**
+ * Write debug output via ::libathome_common::Log, but at most
+ * `per_second` messages per second from this call site.
+ *
+ * Same as ::LogDebug(), but every call site gets its own lock-free
+ * ::libathome_common::LogLimiter.  It is checked before the
+ * arguments are evaluated.  The number of suppressed messages will
+ * be written together with the next message which passes, such like
+ * `"*** Log suppressed 42 similar messages; site=Task.cpp:123"`.
+ *
+ * **Example**
+ * ```cpp
+ * catch (Error& e) {
+ *   LogErrorRate(10, e);
+ * }
+ * ```
+ */
+#define LogDebugRate(per_second, fmt ...) \
+          _LOG_LIMITED(10, debug, rate_e, per_second, fmt)
+/**
+ * Write info output, rate-limited, see ::LogDebugRate().
+ */
+#define LogInfoRate(per_second, fmt ...) \
+          _LOG_LIMITED(20, info, rate_e, per_second, fmt)
+/**
+ * Write warning output, rate-limited, see ::LogDebugRate().
+ */
+#define LogWarnRate(per_second, fmt ...) \
+          _LOG_LIMITED(30, warn, rate_e, per_second, fmt)
+/**
+ * Write ERROR output, rate-limited, see ::LogDebugRate().
+ */
+#define LogErrorRate(per_second, fmt ...) \
+          _LOG_LIMITED(40, error, rate_e, per_second, fmt)
+
+/**
+ * Write only every `every`-th debug output of this call site via
+ * ::libathome_common::Log.
+ *
+ * Same as ::LogDebugRate(), but samples the messages instead of
+ * limiting the rate.  The first message will always be written.
+ */
+#define LogDebugSample(every, fmt ...) \
+          _LOG_LIMITED(10, debug, sample_e, every, fmt)
+/**
+ * Write sampled info output, see ::LogDebugSample().
+ */
+#define LogInfoSample(every, fmt ...) \
+          _LOG_LIMITED(20, info, sample_e, every, fmt)
+/**
+ * Write sampled warning output, see ::LogDebugSample().
+ */
+#define LogWarnSample(every, fmt ...) \
+          _LOG_LIMITED(30, warn, sample_e, every, fmt)
+/**
+ * Write sampled ERROR output, see ::LogDebugSample().
+ */
+#define LogErrorSample(every, fmt ...) \
+          _LOG_LIMITED(40, error, sample_e, every, fmt)
 
 
 namespace libathome_common
@@ -38,6 +187,25 @@ namespace libathome_common
  * Depending on initialization it logs stuff into log files with a
  * daily log-rotation and deletes old obsolete files from log
  * directory.
+ *
+ * All methods for logging messages are thread-safe.  Every thread
+ * formats the whole line in its own staging buffer and pushes it with
+ * one atomic operation into a ::libathome_common::LogRingbuffer, so
+ * lines never interleave.
+ *
+ * By default messages will be written synchronously.  The calling
+ * thread drains the ring buffer to the log file, if no other thread
+ * is draining it already.  Otherwise the draining thread writes the
+ * message too, so no thread waits for a lock.  Messages with
+ * log-level ::libathome_common::Logger::error_e or higher are
+ * written before the logging method returns.  Call
+ * ::libathome_common::Logger::async_start() to switch into
+ * asynchronous mode.  Then a dedicated writer thread drains the ring
+ * buffer in batches to the log file.
+ *
+ * Log files can be written in ::libathome_common::Logger::binary_e
+ * format.  Then messages will not be formatted at all, see
+ * ::libathome_common::LogBinary.
  */
 class Logger: protected File
 {
@@ -66,6 +234,23 @@ public:
    */
   static const char* to_string(Logger::loglevel_t loglevel);
 
+  /**
+   * Format of the log files.
+   */
+  typedef enum {
+    text_e = 0,     ///< Formatted text lines
+    binary_e = 1    ///< Records of ::libathome_common::LogBinary
+  } format_t;
+
+  /**
+   * Convert a ::libathome_common::Logger::format_t to string.
+   *
+   * @param format The format to convert
+   * @return The string which names the format. `static` allocated,
+   *         need NOT to be `free()`d.
+   */
+  static const char* to_string(Logger::format_t format);
+
   /**
    * Default logger instance here: ::libathome_common::Log.
    *
@@ -90,11 +275,22 @@ public:
    *                 formating patterns for representing date/time
    *                 stuff.
    * @param file_count How many files should be kept in `logdir_name`?
+   *                   `0` keeps all files.
+   * @param format Format of the log files.
+   *               ::libathome_common::Logger::binary_e files must be
+   *               rendered by the tool `libathome-logdecode`.
+   *
+   * The log file will be rotated if the formatted `file_fmt` changes,
+   * i.e. daily for `"%Y-%m-%d.log"`.  Obsolete files in `path` will
+   * be pruned to `file_count` files by a background thread.  Only
+   * files with the same literal prefix and suffix as `file_fmt` are
+   * pruned, and the oldest are found by sorting the names.  So keep
+   * the most significant date part first in `file_fmt`.
    */
   explicit Logger(
     Logger::loglevel_t loglevel, RealtimeClock::timezone_t timezone,
     const std::string& path, const std::string& file_fmt,
-    unsigned file_count);
+    unsigned file_count, Logger::format_t format = Logger::text_e);
 
   /**
    * Default destructor.
@@ -133,6 +329,24 @@ public:
    * @return The current log-level
    */
   virtual Logger::loglevel_t get_loglevel() const;
+
+  /**
+   * Returns `true` if a message with log-level `level` would be
+   * written.
+   *
+   * Not virtual and inlined, so it is cheap enough to be checked
+   * before the arguments of a message are evaluated.  See ::LogDebug()
+   * and friends.
+   *
+   * @param level The log-level of the message
+   * @return `true` if `level` passes `LOGLEVEL_MIN` and
+   *         ::libathome_common::Logger::get_loglevel()
+   */
+  bool is_loggable(Logger::loglevel_t level) const
+  {
+    return level >= LOGLEVEL_MIN
+      && level >= this->loglevel.load(std::memory_order_relaxed);
+  }
   /**
    * Returns the ::libathome_common::RealtimeClock::timezone_t of the
    * Logger.
@@ -142,6 +356,113 @@ public:
    * @return The current timezone
    */
   virtual RealtimeClock::timezone_t get_timezone() const;
+  /**
+   * Returns the format of the log files.
+   *
+   * Loggers writing to `stdout` are always
+   * ::libathome_common::Logger::text_e.
+   *
+   * @return The format which was passed to the constructor
+   */
+  virtual Logger::format_t get_format() const;
+
+  /**
+   * Set the format of the timestamps of the log messages.
+   *
+   * See ::libathome_common::RealtimeClock::to_string() for the
+   * format, it supports milliseconds `%3N` and microseconds `%6N`.
+   * The default is `"[%H:%M:%S.%3N]"`.
+   *
+   * @param strftime_fmt The format string
+   */
+  virtual void set_time_format(const std::string& strftime_fmt);
+  /**
+   * Returns the format of the timestamps of the log messages.
+   *
+   * See ::libathome_common::Logger::set_time_format for more
+   * details.
+   *
+   * @return A copy of the current format string
+   */
+  virtual std::string get_time_format() const;
+
+  /**
+   * Set when the log file will be flushed to the operating system.
+   *
+   * The log file stays opened for the whole session and messages
+   * are collected in a write buffer.  The buffer will be flushed if
+   * `flush_bytes` were written, `flush_ms` milliseconds passed since
+   * the last flush, or a message with log-level
+   * ::libathome_common::Logger::error_e or higher was written.  On
+   * every flush it will be checked if the log file was deleted or
+   * moved away, then it will be re-opened.
+   *
+   * In synchronous mode the time threshold will only be checked if
+   * a message is written.  The writer thread of the asynchronous
+   * mode checks it also if idle.
+   *
+   * @param buffer_size Size of the write buffer in bytes, `0` for
+   *                    the C library default
+   * @param flush_bytes Flush after this amount of bytes, `0` to
+   *                    flush every message
+   * @param flush_ms Flush if this amount of milliseconds passed
+   *
+   * Must not be called concurrently with logging methods.
+   */
+  virtual void set_flush_policy(
+    size_t buffer_size, size_t flush_bytes, unsigned flush_ms);
+
+  /**
+   * Compress rotated log files with `gzip`.
+   *
+   * The compression will be done by the background thread which also
+   * prunes obsolete log files.  Compressed files get the additional
+   * suffix `".gz"`.  Does nothing for loggers writing to `stdout`.
+   * Must not be called concurrently with logging methods.
+   *
+   * @param compress `true` to enable compression
+   */
+  virtual void set_compress(bool compress);
+
+  /* -------------------------------------------------------------  */
+
+  /**
+   * Switch into asynchronous mode.
+   *
+   * Starts the writer thread.  From now on logging messages just
+   * formats them and pushes them into a
+   * ::libathome_common::LogRingbuffer.  Double calls will be
+   * ignored.  Must not be called concurrently with logging methods.
+   *
+   * @param capacity Number of messages which can be queued
+   * @param overflow What to do if the queue is full
+   */
+  virtual void async_start(
+    size_t capacity, LogRingbuffer::overflow_t overflow);
+  /**
+   * Switch back into synchronous mode.
+   *
+   * Writes all queued messages and joins the writer thread.  Will be
+   * called implicitly during ::libathome_common::Logger::~Logger().
+   * Must not be called concurrently with logging methods.
+   */
+  virtual void async_stop();
+  /**
+   * Returns `true` if the writer thread is running.
+   *
+   * @return `true` if in asynchronous mode
+   */
+  virtual bool is_async() const;
+
+  /**
+   * Barrier which blocks until all messages, logged before this
+   * call, are written.
+   *
+   * In synchronous mode it drains the ring buffer itself, as soon
+   * as the thread which is draining it has finished.  Will be called
+   * by ::libathome_common::Logger::fatal() before `exit()`.
+   */
+  virtual void flush();
 
   /* -------------------------------------------------------------  */
 
@@ -268,15 +589,129 @@ protected:
   void vprintf(Logger::loglevel_t level, const char* fmt, ::va_list ap);
 
 private:
-  Logger::loglevel_t loglevel;
-  RealtimeClock::timezone_t timezone;
+  std::atomic<Logger::loglevel_t> loglevel;
+  std::atomic<RealtimeClock::timezone_t> timezone;
+  Logger::format_t format;
 
   std::string file_fmt;
   unsigned file_count;
 
+  /** Period of `file_fmt`  */
+  RealtimeClock::period_t file_period;
+  /**
+   * Unix timestamp when to rotate next time.  Set to maximum if
+   * logging to `stdout`.
+   */
+  ::time_t rollover_at;
+  bool compress;
+
+  /** Prunes and compresses log files, started on first rotation  */
+  std::thread housekeeper;
+  std::mutex housekeeper_mutex;
+  std::condition_variable housekeeper_cond;
+  bool housekeeper_stop;
+  bool housekeeper_prune;
+  /** Filename which must not be pruned  */
+  std::string housekeeper_current;
+  /** Rotated log files waiting for compression  */
+  std::vector<std::string> housekeeper_compress;
+
   std::string strftime_fmt;
+  /** Locks `strftime_fmt`, only needed if it will be copied  */
+  mutable std::mutex strftime_mutex;
+
+  /**
+   * Changes if `timezone` or `strftime_fmt` changes, to detect stale
+   * thread-local ::libathome_common::TimestampCache instances.
+   */
+  std::atomic<unsigned> timestamp_generation;
+  static std::atomic<unsigned> _timestamp_generation_next;
+
+  /**
+   * Maximum number of messages which will be written at once.
+   */
+  static const size_t _ASYNC_BATCH_MAX = 256;
+  /**
+   * Timeout in milliseconds of the sleeping writer thread, if it
+   * missed a wake up.
+   */
+  static const unsigned _ASYNC_SLEEP_MS = 50;
+
+  /**
+   * Default write buffer size for log files, see
+   * ::libathome_common::Logger::set_flush_policy().
+   */
+  static const size_t _BUFFER_SIZE = 64*1024;
+  /**
+   * Capacity of the ring buffer in synchronous mode.  It will be
+   * drained by the logging threads, so it can be small.
+   */
+  static const size_t _SYNC_CAPACITY = 256;
+
+  /**
+   * Default flush threshold in bytes for log files.
+   */
+  static const size_t _FLUSH_BYTES = 32*1024;
+  /**
+   * Default flush threshold in milliseconds for log files.
+   */
+  static const unsigned _FLUSH_MS = 1000;
+
+  /**
+   * Appended to compressed log files.
+   */
+  static const char* _COMPRESS_SUFFIX;
+
+  size_t flush_bytes;
+  std::chrono::milliseconds flush_interval;
+  /** Bytes written since last flush  */
+  size_t unflushed;
+  std::chrono::steady_clock::time_point last_flush;
+
+  /**
+   * Holds the messages in both modes, the
+   * ::libathome_common::LogRingbuffer::get_overflow() policy is
+   * always ::libathome_common::LogRingbuffer::block_e in synchronous
+   * mode.
+   */
+  LogRingbuffer* ringbuffer;
+  /**
+   * Set by the thread which drains `ringbuffer` in synchronous mode.
+   * Only this thread may access the ::libathome_common::File base.
+   */
+  std::atomic<bool> draining;
+
+  std::atomic<bool> async;
+  std::thread writer;
+  std::atomic<bool> writer_stop;
+  std::atomic<bool> writer_sleeping;
+  std::mutex writer_mutex;
+  std::condition_variable writer_cond;
 
   void _init();
+
+  void _vprintf_binary(
+    Logger::loglevel_t level, const char* fmt, ::va_list ap);
+  void _write_session() noexcept(false);
+
+  size_t _timestamp(char* buf, size_t size) noexcept(false);
+  void _output(Logger::loglevel_t level, const char* text,
+    size_t length);
+  void _write(
+    Logger::loglevel_t level, const char* text, size_t length);
+  void _flush_file(std::chrono::steady_clock::time_point now);
+
+  void _rotate() noexcept(false);
+  void _housekeeper_main();
+  void _housekeeper_compress(const std::string& filename_full);
+  void _housekeeper_prune(const std::string& current);
+
+  void _drain();
+  void _wait_drained(uint64_t ticket);
+  size_t _write_batch(std::string& batch);
+
+  void _writer_main();
+  void _writer_wakeup();
 }; /* class Logger  */
 
 /**
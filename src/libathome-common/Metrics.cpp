@@ -0,0 +1,272 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-common/Metrics.hpp"
+#include "libathome-common/Error.hpp"
+#include "libathome-common/File.hpp"
+#include "libathome-common/Filesystem.hpp"
+#include "libathome-common/Logger.hpp"
+
+#include <cinttypes>
+
+
+const char* libathome_common::Metrics::
+to_string(Metrics::type_t type)
+{
+  switch (type) {
+  case counter_e: return "counter";
+  case gauge_e: return "gauge";
+  case histogram_e: return "histogram";
+  }
+
+  return "<not implemented!>";
+}
+
+/* ***************************************************************  */
+
+libathome_common::Metrics::
+Metrics(const std::string& path, const std::string& filename)
+  :path(path), filename(filename), dumper_stop(false),
+   dumper_interval_s(0)
+{
+}
+
+libathome_common::Metrics::
+~Metrics()
+{
+  this->stop();
+}
+
+/* ***************************************************************  */
+
+libathome_common::Metrics::metric_t& libathome_common::Metrics::
+_get(const std::string& name, const std::string& help,
+  Metrics::type_t type) noexcept(false)
+{
+  std::lock_guard<std::mutex> lock(this->metrics_mutex);
+
+  std::map<std::string, metric_t>::iterator it = this->metrics.find(name);
+  if (it != this->metrics.end()) {
+    if (it->second.type != type) {
+      throw Err("Metric '%s' is a %s, not a %s!", name.c_str(),
+                Metrics::to_string(it->second.type),
+                Metrics::to_string(type));
+    }
+
+    return it->second;
+  }
+
+  bool valid = !name.empty() && !::isdigit(name[0]);
+  for (char c: name) valid &= ::isalnum(c) || c == '_' || c == ':';
+  if (!valid) throw Err("Invalid metric name '%s'!", name.c_str());
+
+  metric_t& result = this->metrics[name];
+  result.type = type;
+  result.help = help;
+  switch (type) {
+  case counter_e: result.counter.reset(new Counter()); break;
+  case gauge_e: result.gauge.reset(new Gauge()); break;
+  case histogram_e: result.histogram.reset(new Histogram()); break;
+  }
+
+  return result;
+}
+
+libathome_common::Counter& libathome_common::Metrics::
+counter(const std::string& name, const std::string& help) noexcept(false)
+{
+  return *this->_get(name, help, type_t::counter_e).counter;
+}
+
+libathome_common::Gauge& libathome_common::Metrics::
+gauge(const std::string& name, const std::string& help) noexcept(false)
+{
+  return *this->_get(name, help, type_t::gauge_e).gauge;
+}
+
+libathome_common::Histogram& libathome_common::Metrics::
+histogram(const std::string& name, const std::string& help)
+  noexcept(false)
+{
+  return *this->_get(name, help, type_t::histogram_e).histogram;
+}
+
+/* ***************************************************************  */
+
+std::string libathome_common::Metrics::
+to_prometheus() const
+{
+  std::lock_guard<std::mutex> lock(this->metrics_mutex);
+
+  std::string result;
+  string_t buf;
+
+  for (const std::pair<const std::string, metric_t>& entry: this->metrics) {
+    const std::string& name = entry.first;
+    const metric_t& metric = entry.second;
+
+    if (!metric.help.empty())
+      result += "# HELP " + name + " " + metric.help + "\n";
+    result += "# TYPE " + name + " " + Metrics::to_string(metric.type)
+      + "\n";
+
+    switch (metric.type) {
+    case counter_e:
+      ::snprintf(buf, STRING_LEN, " %" PRIu64 "\n", metric.counter->get());
+      result += name + buf;
+      break;
+    case gauge_e:
+      ::snprintf(buf, STRING_LEN, " %" PRId64 "\n", metric.gauge->get());
+      result += name + buf;
+      break;
+    case histogram_e: {
+      /* Cumulative counts per power of two, up to the largest value.
+       * The buckets below Histogram::SUB_BUCKETS are one group.
+       */
+      const Histogram& histogram = *metric.histogram;
+      uint64_t max = histogram.get_max();
+      uint64_t cumulative = 0;
+      unsigned bucket = 0;
+      for (;;) {
+        unsigned group_end = bucket + Histogram::SUB_BUCKETS;
+        for (; bucket<group_end; bucket++)
+          cumulative += histogram.get_bucket(bucket);
+
+        uint64_t upper = Histogram::bucket_upper(bucket - 1);
+        if (bucket >= Histogram::BUCKETS || upper >= max) break;
+
+        ::snprintf(buf, STRING_LEN, "_bucket{le=\"%" PRIu64 "\"} %" PRIu64
+                   "\n", upper, cumulative);
+        result += name + buf;
+      }
+
+      ::snprintf(buf, STRING_LEN, "_bucket{le=\"+Inf\"} %" PRIu64 "\n",
+                 cumulative);
+      result += name + buf;
+      ::snprintf(buf, STRING_LEN, "_sum %" PRIu64 "\n", histogram.get_sum());
+      result += name + buf;
+      ::snprintf(buf, STRING_LEN, "_count %" PRIu64 "\n", cumulative);
+      result += name + buf;
+      break;
+    }
+    } /* switch (metric.type)  */
+  }
+
+  return result;
+}
+
+void libathome_common::Metrics::
+dump() noexcept(false)
+{
+  std::string snapshot = this->to_prometheus();
+
+  /* Write a temporary file first and rename it, a scraper must not
+   * read a half written file
+   */
+  std::string filename_tmp = this->filename + ".tmp";
+  {
+    File out(this->path, filename_tmp, true);
+    out.open(File::access_t::write_e);
+    out.write(snapshot.c_str(), snapshot.length());
+    out.flush();
+  }
+  Filesystem::rename(
+    this->path + Filesystem::PATH_SEPERATOR + filename_tmp,
+    this->path + Filesystem::PATH_SEPERATOR + this->filename);
+
+  if (libathome_common::Log == NULL) return;
+
+  std::lock_guard<std::mutex> lock(this->metrics_mutex);
+  for (const std::pair<const std::string, metric_t>& entry: this->metrics) {
+    const metric_t& metric = entry.second;
+
+    switch (metric.type) {
+    case counter_e:
+      Log->info("Metric %s = %" PRIu64, entry.first.c_str(),
+                metric.counter->get());
+      break;
+    case gauge_e:
+      Log->info("Metric %s = %" PRId64, entry.first.c_str(),
+                metric.gauge->get());
+      break;
+    case histogram_e:
+      Log->info("Metric %s: %s", entry.first.c_str(),
+                metric.histogram->to_string().c_str());
+      break;
+    }
+  }
+}
+
+/* ***************************************************************  */
+
+void libathome_common::Metrics::
+start(unsigned interval_s)
+{
+  if (interval_s == 0) interval_s = 1;
+
+  std::lock_guard<std::mutex> lock(this->dumper_mutex);
+  this->dumper_interval_s = interval_s;
+  this->dumper_cond.notify_one();
+
+  if (!this->dumper.joinable()) {
+    this->dumper_stop = false;
+    this->dumper = std::thread(&Metrics::_dumper_main, this);
+  }
+}
+
+void libathome_common::Metrics::
+stop()
+{
+  if (!this->dumper.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(this->dumper_mutex);
+    this->dumper_stop = true;
+    this->dumper_cond.notify_one();
+  }
+  this->dumper.join();
+
+  try {
+    this->dump();
+  } catch (Error& e) {
+    ::fprintf(stderr, "ERROR: %s\n", e.what());
+  }
+}
+
+void libathome_common::Metrics::
+_dumper_main()
+{
+  std::unique_lock<std::mutex> lock(this->dumper_mutex);
+
+  while (!this->dumper_stop) {
+    std::cv_status status = this->dumper_cond.wait_for(
+      lock, std::chrono::seconds(this->dumper_interval_s));
+    if (this->dumper_stop) break;
+    /* Woken up by start(), to change the interval  */
+    if (status == std::cv_status::no_timeout) continue;
+
+    lock.unlock();
+    try {
+      this->dump();
+    } catch (Error& e) {
+      ::fprintf(stderr, "ERROR: %s\n", e.what());
+    }
+    lock.lock();
+  }
+}
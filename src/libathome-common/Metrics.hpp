@@ -0,0 +1,200 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_METRICS_H__
+#define LIBATHOME_COMMON_METRICS_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::Metrics.
+ */
+
+#include "libathome-common/Common.hpp"
+#include "libathome-common/Counter.hpp"
+#include "libathome-common/Gauge.hpp"
+#include "libathome-common/Histogram.hpp"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace libathome_common
+{
+
+/**
+ * Registry of all metrics of the process.
+ *
+ * The instance is created by ::libathome_common::Common, get it via
+ * ::libathome_common::Common::get_metrics().  Metrics are created on
+ * first use by name and live as long as the registry.  Only creating
+ * and snapshotting takes a lock, recording into a
+ * ::libathome_common::Counter, ::libathome_common::Gauge or
+ * ::libathome_common::Histogram is lock-free and does not allocate.
+ * So keep the returned reference, instead of looking it up for every
+ * sample.
+ *
+ * A snapshot can be written in the Prometheus text format, to be
+ * scraped by a local agent, and logged via ::libathome_common::Log.
+ * Use ::libathome_common::Metrics::start() to do this periodically.
+ *
+ * **Example**
+ * ```cpp
+ * static Counter& tasks_done = Common::get()->get_metrics()
+ *   ->counter("libathome_tasks_done_total", "Finished tasks");
+ *
+ * tasks_done.add();
+ * ```
+ */
+class Metrics
+{
+public:
+  /**
+   * Type of a metric.
+   */
+  typedef enum {
+    counter_e = 0,   ///< ::libathome_common::Counter
+    gauge_e = 1,     ///< ::libathome_common::Gauge
+    histogram_e = 2  ///< ::libathome_common::Histogram
+  } type_t;
+
+  /**
+   * Convert a ::libathome_common::Metrics::type_t to string.
+   *
+   * @param type The type to convert
+   * @return The string which names the type, as used by Prometheus.
+   *         `static` allocated, need NOT to be `free()`d.
+   */
+  static const char* to_string(Metrics::type_t type);
+
+  /**
+   * Constructs an empty registry.
+   *
+   * @param path Directory of the Prometheus file, will be created on
+   *             ::libathome_common::Metrics::dump()
+   * @param filename Filename of the Prometheus file
+   */
+  explicit Metrics(const std::string& path, const std::string& filename);
+  /**
+   * Stops periodic dumps, see ::libathome_common::Metrics::stop().
+   */
+  virtual ~Metrics();
+
+  /**
+   * Returns the counter `name`, creates it if needed.
+   *
+   * @param name Name of the metric, `[a-zA-Z_:][a-zA-Z0-9_:]*`
+   * @param help Description, used on creation only
+   * @return The counter, valid as long as this registry lives
+   * @exception ::libathome_common::Error will be thrown if `name` is
+   *            invalid or a metric of another type
+   */
+  virtual Counter& counter(const std::string& name,
+    const std::string& help = "") noexcept(false);
+  /**
+   * Returns the gauge `name`, creates it if needed.
+   *
+   * @param name Name of the metric, `[a-zA-Z_:][a-zA-Z0-9_:]*`
+   * @param help Description, used on creation only
+   * @return The gauge, valid as long as this registry lives
+   * @exception ::libathome_common::Error will be thrown if `name` is
+   *            invalid or a metric of another type
+   */
+  virtual Gauge& gauge(const std::string& name,
+    const std::string& help = "") noexcept(false);
+  /**
+   * Returns the histogram `name`, creates it if needed.
+   *
+   * @param name Name of the metric, `[a-zA-Z_:][a-zA-Z0-9_:]*`.  Add
+   *             the unit, such like `"libathome_verify_ns"`.
+   * @param help Description, used on creation only
+   * @return The histogram, valid as long as this registry lives
+   * @exception ::libathome_common::Error will be thrown if `name` is
+   *            invalid or a metric of another type
+   */
+  virtual Histogram& histogram(const std::string& name,
+    const std::string& help = "") noexcept(false);
+
+  /**
+   * Snapshot of all metrics in the Prometheus text format.
+   *
+   * Histogram buckets are exported per power of two.
+   *
+   * @return The snapshot, sorted by name
+   */
+  virtual std::string to_prometheus() const;
+
+  /**
+   * Writes ::libathome_common::Metrics::to_prometheus() to the file
+   * and logs a summary of every metric.
+   *
+   * The file is replaced atomically, so a scraper never reads a
+   * partial snapshot.
+   *
+   * @exception ::libathome_common::Error will be thrown if the file
+   *            could not be written
+   */
+  virtual void dump() noexcept(false);
+
+  /**
+   * Calls ::libathome_common::Metrics::dump() every `interval_s`
+   * seconds in a background thread.
+   *
+   * Errors will be written to `stderr`.  Calling it again changes the
+   * interval.
+   *
+   * @param interval_s Seconds between two dumps, greater than `0`
+   */
+  virtual void start(unsigned interval_s);
+  /**
+   * Stops the periodic dumps, with a last one.
+   *
+   * Does nothing if not started.
+   */
+  virtual void stop();
+
+private:
+  typedef struct {
+    Metrics::type_t type;
+    std::string help;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+  } metric_t;
+
+  std::string path;
+  std::string filename;
+
+  /** Locked on creation and snapshot, not while recording  */
+  mutable std::mutex metrics_mutex;
+  std::map<std::string, metric_t> metrics;
+
+  std::thread dumper;
+  std::mutex dumper_mutex;
+  std::condition_variable dumper_cond;
+  bool dumper_stop;
+  unsigned dumper_interval_s;
+
+  metric_t& _get(const std::string& name, const std::string& help,
+    Metrics::type_t type) noexcept(false);
+  void _dumper_main();
+
+}; /* class Metrics  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_METRICS_H__  */
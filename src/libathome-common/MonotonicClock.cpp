@@ -0,0 +1,128 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-common/MonotonicClock.hpp"
+
+#include <thread>
+#include <chrono>
+
+#ifdef _MONOTONICCLOCK_TSC
+#  include <cpuid.h>
+#endif /* ifdef _MONOTONICCLOCK_TSC  */
+
+
+std::atomic<bool> libathome_common::MonotonicClock::_tsc_enabled(false);
+uint64_t libathome_common::MonotonicClock::_tsc_base_ticks = 0;
+uint64_t libathome_common::MonotonicClock::_tsc_base_ns = 0;
+uint64_t libathome_common::MonotonicClock::_tsc_mult = 0;
+
+/* ***************************************************************  */
+
+const char* libathome_common::MonotonicClock::
+to_string(MonotonicClock::source_t source)
+{
+  switch (source) {
+  case syscall_e: return "clock_gettime";
+  case tsc_e: return "tsc";
+  }
+
+  return "<not implemented!>";
+}
+
+bool libathome_common::MonotonicClock::
+enable_tsc(unsigned calibration_ms)
+{
+#ifdef _MONOTONICCLOCK_TSC
+  if (MonotonicClock::_tsc_enabled.load()) return true;
+
+  /* CPUID 0x80000007, EDX bit 8: Invariant TSC  */
+  unsigned eax, ebx, ecx, edx;
+  if (!::__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)
+      || !(edx & (1 << 8)))
+    return false;
+
+  uint64_t ns_begin = MonotonicClock::now();
+  uint64_t ticks_begin = ::__builtin_ia32_rdtsc();
+  std::this_thread::sleep_for(std::chrono::milliseconds(calibration_ms));
+  uint64_t ns_end = MonotonicClock::now();
+  uint64_t ticks_end = ::__builtin_ia32_rdtsc();
+
+  if (ns_end <= ns_begin || ticks_end <= ticks_begin) return false;
+
+  MonotonicClock::_tsc_mult
+    = (uint64_t) (((unsigned __int128) (ns_end - ns_begin)
+                   << MonotonicClock::_TSC_SHIFT)
+                  / (ticks_end - ticks_begin));
+  MonotonicClock::_tsc_base_ticks = ticks_end;
+  MonotonicClock::_tsc_base_ns = ns_end;
+  MonotonicClock::_tsc_enabled.store(true, std::memory_order_release);
+
+  return true;
+#else /* ifdef _MONOTONICCLOCK_TSC  */
+  (void) calibration_ms;
+  return false;
+#endif /* ifdef _MONOTONICCLOCK_TSC  */
+}
+
+void libathome_common::MonotonicClock::
+disable_tsc()
+{
+  MonotonicClock::_tsc_enabled.store(false);
+}
+
+libathome_common::MonotonicClock::source_t
+libathome_common::MonotonicClock::
+get_source()
+{
+  return MonotonicClock::_tsc_enabled.load()
+    ? source_t::tsc_e: source_t::syscall_e;
+}
+
+/* ***************************************************************  */
+
+libathome_common::MonotonicClock::
+MonotonicClock()
+  :nanoseconds(MonotonicClock::now())
+{
+}
+
+libathome_common::MonotonicClock::
+~MonotonicClock()
+{
+}
+
+void libathome_common::MonotonicClock::
+restart()
+{
+  this->nanoseconds = MonotonicClock::now();
+}
+
+uint64_t libathome_common::MonotonicClock::
+get_nanoseconds() const
+{
+  return this->nanoseconds;
+}
+
+uint64_t libathome_common::MonotonicClock::
+get_elapsed() const
+{
+  uint64_t now = MonotonicClock::now();
+
+  return now > this->nanoseconds? now - this->nanoseconds: 0;
+}
@@ -0,0 +1,184 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_MONOTONICCLOCK_H__
+#define LIBATHOME_COMMON_MONOTONICCLOCK_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::MonotonicClock.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <atomic>
+#include <ctime>  /* Same as <time.h>  */
+
+/* C++ compiler depending stuff
+ */
+
+/// @cond Doxygen_Suppress
+#if defined __GNUC__ && defined __x86_64__
+#  /* Time stamp counter of x86, 128 bit multiplication needed  */
+#  define _MONOTONICCLOCK_TSC      1
+#endif /* if defined __GNUC__ && defined __x86_64__  */
+/// @endcond
+
+namespace libathome_common
+{
+
+/**
+ * Provides a clock to measure durations, with nanosecond resolution.
+ *
+ * Unlike ::libathome_common::RealtimeClock the time never jumps, i.e.
+ * if the system time is changed.  It counts nanoseconds since an
+ * unspecified point in time, so only differences between two points
+ * in time are meaningful.
+ *
+ * Use ::libathome_common::MonotonicClock::now() in hot paths, it
+ * costs about 20ns using `clock_gettime(CLOCK_MONOTONIC)`.  After
+ * ::libathome_common::MonotonicClock::enable_tsc() it reads the time
+ * stamp counter of the CPU instead, which costs just some
+ * nanoseconds.
+ *
+ * An instance captures the time during
+ * ::libathome_common::MonotonicClock::MonotonicClock(), like a
+ * stopwatch.  See also ::libathome_common::ScopedTimer.
+ */
+class MonotonicClock
+{
+public:
+
+  /**
+   * Where ::libathome_common::MonotonicClock::now() gets the time
+   * from.
+   */
+  typedef enum {
+    syscall_e = 0,  ///< `clock_gettime(CLOCK_MONOTONIC)`
+    tsc_e = 1       ///< Calibrated time stamp counter of the CPU
+  } source_t;
+
+  /**
+   * Convert a ::libathome_common::MonotonicClock::source_t to string.
+   *
+   * @param source The source to convert
+   * @return The string which names the source. `static` allocated,
+   *         need NOT to be `free()`d.
+   */
+  static const char* to_string(MonotonicClock::source_t source);
+
+  /**
+   * Returns the current time.
+   *
+   * Thread-safe and lock-free.
+   *
+   * @return Nanoseconds since an unspecified point in time.  `0` if
+   *         the system has no monotonic clock.
+   */
+  static uint64_t now()
+  {
+#ifdef _MONOTONICCLOCK_TSC
+    if (MonotonicClock::_tsc_enabled.load(std::memory_order_acquire)) {
+      /* Another core may be a few ticks behind the calibration  */
+      int64_t ticks = (int64_t) (::__builtin_ia32_rdtsc()
+                                 - MonotonicClock::_tsc_base_ticks);
+      if (ticks < 0) ticks = 0;
+
+      return MonotonicClock::_tsc_base_ns + (uint64_t)
+        (((unsigned __int128) ticks * MonotonicClock::_tsc_mult)
+         >> MonotonicClock::_TSC_SHIFT);
+    }
+#endif /* ifdef _MONOTONICCLOCK_TSC  */
+
+    ::timespec result;
+    if (0 != ::clock_gettime(CLOCK_MONOTONIC, &result)) return 0;
+
+    return (uint64_t) result.tv_sec * 1000000000 + result.tv_nsec;
+  }
+
+  /**
+   * Use the time stamp counter of the CPU for
+   * ::libathome_common::MonotonicClock::now().
+   *
+   * Calibrates the counter against `CLOCK_MONOTONIC`, which blocks
+   * the caller for `calibration_ms`.  Only possible on x86-64 CPUs
+   * with an invariant time stamp counter, i.e. which ticks at a
+   * constant rate in all power states and on all cores.  Call it
+   * once at startup, before other threads are measuring.  Times
+   * fetched before and after can differ by some microseconds.
+   *
+   * @param calibration_ms Duration of the calibration, the longer the
+   *                       more precise
+   * @return `true` if enabled, `false` if not supported by the CPU
+   */
+  static bool enable_tsc(unsigned calibration_ms = 20);
+  /**
+   * Use `clock_gettime(CLOCK_MONOTONIC)` again.
+   */
+  static void disable_tsc();
+  /**
+   * Returns where ::libathome_common::MonotonicClock::now() gets the
+   * time from.
+   *
+   * @return The current source
+   */
+  static MonotonicClock::source_t get_source();
+
+  /**
+   * Fetch current time, using ::libathome_common::MonotonicClock::now().
+   */
+  explicit MonotonicClock();
+  /**
+   * Default destructor.
+   */
+  virtual ~MonotonicClock();
+
+  /**
+   * Fetch current time again.
+   */
+  virtual void restart();
+
+  /**
+   * Get the fetched time.
+   *
+   * @return Nanoseconds since an unspecified point in time
+   */
+  virtual uint64_t get_nanoseconds() const;
+  /**
+   * Get the time which passed since the fetched time.
+   *
+   * @return Nanoseconds
+   */
+  virtual uint64_t get_elapsed() const;
+
+private:
+  static const unsigned _TSC_SHIFT = 32;
+
+  /** Set after the other _tsc_* were written  */
+  static std::atomic<bool> _tsc_enabled;
+  static uint64_t _tsc_base_ticks;
+  static uint64_t _tsc_base_ns;
+  /** Nanoseconds per tick, fixed point with _TSC_SHIFT fraction bits  */
+  static uint64_t _tsc_mult;
+
+  uint64_t nanoseconds;
+
+}; /* class MonotonicClock  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_MONOTONICCLOCK_H__  */
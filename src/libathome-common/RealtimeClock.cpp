@@ -33,6 +33,44 @@ to_string(RealtimeClock::timezone_t timezone)
   return "<not implemented!>";
 }
 
+libathome_common::RealtimeClock::period_t
+libathome_common::RealtimeClock::
+strftime_period(const std::string& strftime_fmt)
+{
+  period_t result = period_t::year_e;
+
+  for (size_t i=0; i+1 < strftime_fmt.length(); i++) {
+    if (strftime_fmt[i] != '%') continue;
+
+    /* Skip POSIX modifiers, such like %Ey or %Od  */
+    char conv = strftime_fmt[++i];
+    if ((conv == 'E' || conv == 'O') && i+1 < strftime_fmt.length())
+      conv = strftime_fmt[++i];
+
+    period_t cur;
+    switch (conv) {
+    case 'S': case 'T': case 'c': case 'r': case 's': case 'X':
+      cur = period_t::second_e; break;
+    case 'M': case 'R':
+      cur = period_t::minute_e; break;
+    case 'H': case 'I': case 'k': case 'l': case 'p': case 'P':
+      cur = period_t::hour_e; break;
+    case 'd': case 'e': case 'j': case 'a': case 'A': case 'u':
+    case 'w': case 'D': case 'F': case 'x': case 'U': case 'W':
+    case 'V':
+      cur = period_t::day_e; break;
+    case 'm': case 'b': case 'B': case 'h':
+      cur = period_t::month_e; break;
+    default:
+      cur = period_t::year_e; break;
+    }
+
+    if (cur < result) result = cur;
+  }
+
+  return result;
+}
+
 libathome_common::RealtimeClock::
 RealtimeClock() noexcept(false)
   :RealtimeClock(RealtimeClock::timezone_t::local_e)
@@ -41,15 +79,54 @@ RealtimeClock() noexcept(false)
 
 libathome_common::RealtimeClock::
 RealtimeClock(RealtimeClock::timezone_t timezone) noexcept(false)
+  :RealtimeClock(RealtimeClock::fetch(timezone, std::nothrow).get())
 {
-  if (0 > ::time(&this->timestamp)) {
-    throw Err("Could not fetch time from system RTC: %s!",
-              ::strerror(errno));
-  }
+}
 
+libathome_common::RealtimeClock::
+RealtimeClock(RealtimeClock::timezone_t timezone, ::time_t timestamp,
+  long nanoseconds) noexcept(false)
+  :timestamp(timestamp), nanoseconds(nanoseconds)
+{
   this->set_timezone(timezone);
 }
 
+libathome_common::RealtimeClock::
+RealtimeClock(RealtimeClock::timezone_t timezone, ::time_t timestamp,
+  long nanoseconds, const std::nothrow_t&)
+  :timestamp(timestamp), nanoseconds(nanoseconds), timezone(timezone)
+{
+  ::memset(&this->timestruct, 0, sizeof(::tm));
+}
+
+libathome_common::Result<libathome_common::RealtimeClock>
+libathome_common::RealtimeClock::
+fetch(RealtimeClock::timezone_t timezone, const std::nothrow_t&)
+{
+  ::timespec now;
+  if (0 != ::clock_gettime(CLOCK_REALTIME, &now)) {
+    int code = errno;
+    return ErrStatus(code, "Could not fetch time from system RTC: %s!",
+                     ::strerror(code));
+  }
+
+  return RealtimeClock::from_timestamp(
+    timezone, now.tv_sec, now.tv_nsec, std::nothrow);
+}
+
+libathome_common::Result<libathome_common::RealtimeClock>
+libathome_common::RealtimeClock::
+from_timestamp(RealtimeClock::timezone_t timezone, ::time_t timestamp,
+  long nanoseconds, const std::nothrow_t&)
+{
+  RealtimeClock result(timezone, timestamp, nanoseconds, std::nothrow);
+
+  Status status = result.set_timezone(timezone, std::nothrow);
+  if (!status) return status;
+
+  return result;
+}
+
 libathome_common::RealtimeClock::
 ~RealtimeClock()
 {
@@ -57,19 +134,47 @@ libathome_common::RealtimeClock::
 
 std::string libathome_common::RealtimeClock::
 to_string(const std::string& strftime_fmt) const noexcept(false)
+{
+  return std::move(this->to_string(strftime_fmt, std::nothrow).get());
+}
+
+libathome_common::Result<std::string> libathome_common::RealtimeClock::
+to_string(const std::string& strftime_fmt, const std::nothrow_t&) const
 {
   string_t buf;
 
+  /* STRFTIME() does not know about subseconds, replace them first
+   */
+  std::string fmt = strftime_fmt;
+  int digits;
+  size_t length, found, pos = 0;
+  while (std::string::npos != (found = RealtimeClock::find_subseconds(
+           fmt.substr(pos), digits, length))) {
+    pos += found;
+
+    char subsec[9];
+    RealtimeClock::write_subseconds(subsec, this->nanoseconds, digits);
+    fmt.replace(pos, length, subsec, digits);
+    pos += digits;
+  }
+
   if (0 >= ::strftime(
-      buf, STRING_LEN, strftime_fmt.c_str(), &this->timestruct))
-    throw Err("Could not convert time struct to string from format '%s'!",
-              strftime_fmt.c_str());
+      buf, STRING_LEN, fmt.c_str(), &this->timestruct))
+    return ErrStatus(EINVAL,
+      "Could not convert time struct to string from format '%s'!",
+      strftime_fmt.c_str());
 
   return std::string(buf);
 }
 
 void libathome_common::RealtimeClock::
 set_timezone(RealtimeClock::timezone_t timezone) noexcept(false)
+{
+  this->set_timezone(timezone, std::nothrow).throw_if_error();
+}
+
+libathome_common::Status libathome_common::RealtimeClock::
+set_timezone(RealtimeClock::timezone_t timezone, const std::nothrow_t&)
 {
   this->timezone = timezone;
 
@@ -104,9 +209,12 @@ set_timezone(RealtimeClock::timezone_t timezone) noexcept(false)
 #endif /* #ifndef OSWIN  */
 
   if (iserror) {
-    throw Err("Could not convert unix timestamp to struct: %s!",
-              ::strerror(errno));
+    int code = errno;
+    return ErrStatus(code, "Could not convert unix timestamp to struct: %s!",
+                     ::strerror(code));
   }
+
+  return Status();
 }
 
 libathome_common::RealtimeClock::timezone_t
@@ -115,3 +223,112 @@ get_timezone() const
 {
   return this->timezone;
 }
+
+::time_t libathome_common::RealtimeClock::
+get_timestamp() const
+{
+  return this->timestamp;
+}
+
+long libathome_common::RealtimeClock::
+get_nanoseconds() const
+{
+  return this->nanoseconds;
+}
+
+size_t libathome_common::RealtimeClock::
+find_subseconds(const std::string& strftime_fmt, int& digits,
+  size_t& length)
+{
+  for (size_t i=0; i+1 < strftime_fmt.length(); i++) {
+    if (strftime_fmt[i] != '%') continue;
+
+    char conv = strftime_fmt[i+1];
+    if (conv == 'N') {
+      digits = 9;
+      length = 2;
+      return i;
+    }
+    if (conv >= '1' && conv <= '9' && i+2 < strftime_fmt.length()
+        && strftime_fmt[i+2] == 'N') {
+      digits = conv - '0';
+      length = 3;
+      return i;
+    }
+
+    /* Skip the conversion, i.e. '%%N' is not a subsecond  */
+    i++;
+  }
+
+  return std::string::npos;
+}
+
+void libathome_common::RealtimeClock::
+write_subseconds(char* buf, long nanoseconds, int digits)
+{
+  for (int i=9; i>digits; i--) nanoseconds /= 10;
+
+  for (int i=digits-1; i>=0; i--) {
+    buf[i] = '0' + (char) (nanoseconds % 10);
+    nanoseconds /= 10;
+  }
+}
+
+::time_t libathome_common::RealtimeClock::
+get_next(RealtimeClock::period_t period) const noexcept(false)
+{
+  return this->get_next(period, std::nothrow).get();
+}
+
+libathome_common::Result<::time_t> libathome_common::RealtimeClock::
+get_next(RealtimeClock::period_t period, const std::nothrow_t&) const
+{
+  if (period == period_t::second_e) return this->timestamp + 1;
+
+  ::tm next = this->timestruct;
+  switch (period) {
+  case period_t::second_e:
+    break;
+  case period_t::minute_e:
+    next.tm_sec = 0; next.tm_min++;
+    break;
+  case period_t::hour_e:
+    next.tm_sec = 0; next.tm_min = 0; next.tm_hour++;
+    break;
+  case period_t::day_e:
+    next.tm_sec = 0; next.tm_min = 0; next.tm_hour = 0; next.tm_mday++;
+    break;
+  case period_t::month_e:
+    next.tm_sec = 0; next.tm_min = 0; next.tm_hour = 0; next.tm_mday = 1;
+    next.tm_mon++;
+    break;
+  case period_t::year_e:
+    next.tm_sec = 0; next.tm_min = 0; next.tm_hour = 0; next.tm_mday = 1;
+    next.tm_mon = 0; next.tm_year++;
+    break;
+  }
+
+  ::time_t result = -1;
+  switch (this->timezone) {
+  case timezone_t::utc_e:
+#ifndef OSWIN
+    result = ::timegm(&next);
+#else /* ifndef OSWIN  */
+    result = ::_mkgmtime(&next);
+#endif /* ifndef OSWIN  */
+    break;
+  case timezone_t::local_e:
+    /* Let MKTIME() figure out the daylight saving time  */
+    next.tm_isdst = -1;
+    result = ::mktime(&next);
+    break;
+  }
+
+  if (result <= this->timestamp) {
+    return ErrStatus(ERANGE,
+      "Could not calculate next %s boundary of timestamp %ld!",
+      RealtimeClock::to_string(this->timezone), (long) this->timestamp);
+  }
+
+  return result;
+}
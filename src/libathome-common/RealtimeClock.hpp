@@ -24,6 +24,7 @@
  */
 
 #include "libathome-common/Common.hpp"
+#include "libathome-common/Result.hpp"
 
 #include <ctime>  /* Same as <time.h>  */
 
@@ -34,7 +35,9 @@ namespace libathome_common
  * Provides functionality of an RTC.
  *
  * The time provided is captured during instancing the class during
- * ::libathome_common::RealtimeClock::RealtimeClock().
+ * ::libathome_common::RealtimeClock::RealtimeClock().  Use
+ * ::libathome_common::TimestampCache if you need to format the
+ * current time very often, such like for every log message.
  */
 class RealtimeClock
 {
@@ -58,6 +61,35 @@ public:
    */
   static const char* to_string(RealtimeClock::timezone_t timezone);
 
+  /**
+   * Time periods of a calendar, from fine to coarse.
+   */
+  typedef enum {
+    second_e = 0,  ///< Every second
+    minute_e = 1,  ///< Every minute
+    hour_e = 2,    ///< Every hour
+    day_e = 3,     ///< Every day at midnight
+    month_e = 4,   ///< Every first day of a month at midnight
+    year_e = 5     ///< Every first of January at midnight
+  } period_t;
+
+  /**
+   * Returns the finest ::libathome_common::RealtimeClock::period_t
+   * which is represented by a `strftime()` format string.
+   *
+   * I.e. `"%Y-%m-%d.log"` changes daily and returns
+   * ::libathome_common::RealtimeClock::day_e, `"%Y-%m.log"` returns
+   * ::libathome_common::RealtimeClock::month_e.  Week numbers and
+   * weekdays are handled as ::libathome_common::RealtimeClock::day_e.
+   * A format string without any time conversion returns
+   * ::libathome_common::RealtimeClock::year_e.
+   *
+   * @param strftime_fmt The format string to analyze
+   * @return The finest period which changes the formatted string
+   */
+  static RealtimeClock::period_t
+  strftime_period(const std::string& strftime_fmt);
+
   /**
    * Fetch current time with timezone
    * ::libathome_common::RealtimeClock::local_e.
@@ -80,6 +112,43 @@ public:
   explicit RealtimeClock(RealtimeClock::timezone_t timezone)
     noexcept(false);
 
+  /**
+   * Use an already fetched time with timezone `timezone`.
+   *
+   * @param timezone The timezone which should be used.
+   * @param timestamp Unix timestamp in seconds
+   * @param nanoseconds Fraction of the second, `[0, 999999999]`
+   * @exception ::libathome_common::Error will be thrown if
+   *            `timestamp` could not be converted to localized
+   *            `timestruct`
+   */
+  explicit RealtimeClock(RealtimeClock::timezone_t timezone,
+    ::time_t timestamp, long nanoseconds) noexcept(false);
+
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::RealtimeClock::RealtimeClock(RealtimeClock::timezone_t).
+   *
+   * @param timezone The timezone which should be used.
+   * @return The current time, failed if `timestamp` could not be
+   *         fetched from system RTC
+   */
+  static Result<RealtimeClock> fetch(RealtimeClock::timezone_t timezone,
+    const std::nothrow_t&);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::RealtimeClock::RealtimeClock(RealtimeClock::timezone_t, ::time_t, long).
+   *
+   * @param timezone The timezone which should be used.
+   * @param timestamp Unix timestamp in seconds
+   * @param nanoseconds Fraction of the second, `[0, 999999999]`
+   * @return The time, failed if `timestamp` could not be converted
+   *         to localized `timestruct`
+   */
+  static Result<RealtimeClock> from_timestamp(
+    RealtimeClock::timezone_t timezone, ::time_t timestamp,
+    long nanoseconds, const std::nothrow_t&);
+
   /**
    * Default destructor.
    */
@@ -93,6 +162,11 @@ public:
    * Make sure to hold your format strings POSIX compatible and try to
    * avoid other extensions.
    *
+   * Additionally the fraction of the second can be added, such like
+   * GNU `date` does.  `%3N` will be replaced by milliseconds, `%6N`
+   * by microseconds and `%N` or `%9N` by nanoseconds, always zero
+   * padded.
+   *
    * @param strftime_fmt The format string.  Make sure to hold it
    *        POSIX compatible and try to avoid other extensions.
    * @return The resulting formatted string.
@@ -101,6 +175,16 @@ public:
    */
   virtual std::string
   to_string(const std::string& strftime_fmt) const noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::RealtimeClock::to_string(const std::string&).
+   *
+   * @param strftime_fmt The format string
+   * @return The formatted string, failed if some formatting of
+   *         `strftime_fmt` is going wrong
+   */
+  virtual Result<std::string>
+  to_string(const std::string& strftime_fmt, const std::nothrow_t&) const;
 
   /**
    * Set `timezone`.
@@ -112,6 +196,16 @@ public:
    */
   virtual void set_timezone(RealtimeClock::timezone_t timezone)
     noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::RealtimeClock::set_timezone(RealtimeClock::timezone_t).
+   *
+   * @param timezone The timezone to set.
+   * @return Failed if `timestamp` could not be converted to localized
+   *         `timestruct`
+   */
+  virtual Status set_timezone(RealtimeClock::timezone_t timezone,
+    const std::nothrow_t&);
 
   /**
    * Get `timezone`.
@@ -120,12 +214,86 @@ public:
    */
   virtual RealtimeClock::timezone_t get_timezone() const;
 
+  /**
+   * Get the fetched time as unix timestamp.
+   *
+   * @return Seconds since epoch, independent of `timezone`
+   */
+  virtual ::time_t get_timestamp() const;
+  /**
+   * Get the fraction of the second of the fetched time.
+   *
+   * The precision depends on the system RTC.
+   *
+   * @return Nanoseconds, `[0, 999999999]`
+   */
+  virtual long get_nanoseconds() const;
+
+  /**
+   * Find the first fraction of the second in `strftime_fmt`.
+   *
+   * See ::libathome_common::RealtimeClock::to_string() for the
+   * supported conversions.
+   *
+   * @param strftime_fmt The format string to search in
+   * @param digits Output, number of digits of the conversion
+   * @param length Output, length of the conversion, such like `3`
+   *               for `%3N`
+   * @return Position of the `'%'` character or `std::string::npos`
+   *         if not found
+   */
+  static size_t find_subseconds(
+    const std::string& strftime_fmt, int& digits, size_t& length);
+  /**
+   * Writes `digits` leading digits of `nanoseconds`, zero padded.
+   *
+   * Does not append `'\0'`.
+   *
+   * @param buf Output, must have space for `digits` characters
+   * @param nanoseconds Fraction of the second, `[0, 999999999]`
+   * @param digits Number of digits to write, `[1, 9]`
+   */
+  static void
+  write_subseconds(char* buf, long nanoseconds, int digits);
+
+  /**
+   * Calculates the start of the next `period` in `timezone`.
+   *
+   * I.e. for ::libathome_common::RealtimeClock::day_e it returns the
+   * unix timestamp of the next midnight.  Daylight saving time will
+   * be respected for ::libathome_common::RealtimeClock::local_e.
+   *
+   * @param period The period to calculate the boundary for
+   * @return Unix timestamp of the next boundary, always greater than
+   *         ::libathome_common::RealtimeClock::get_timestamp()
+   * @exception ::libathome_common::Error will be thrown if the
+   *            timestamp could not be calculated
+   */
+  virtual ::time_t get_next(RealtimeClock::period_t period)
+    const noexcept(false);
+  /**
+   * Non-throwing variant of
+   * ::libathome_common::RealtimeClock::get_next(RealtimeClock::period_t).
+   *
+   * @param period The period to calculate the boundary for
+   * @return Unix timestamp of the next boundary, failed if it could
+   *         not be calculated
+   */
+  virtual Result<::time_t> get_next(RealtimeClock::period_t period,
+    const std::nothrow_t&) const;
+
 private:
   ::time_t timestamp;
+  long nanoseconds;
 
   RealtimeClock::timezone_t timezone;
   ::tm timestruct;
 
+  /** Without conversion to `timestruct`, for the non-throwing
+   * factories  */
+  explicit RealtimeClock(RealtimeClock::timezone_t timezone,
+    ::time_t timestamp, long nanoseconds, const std::nothrow_t&);
+
 }; /* class RealtimeClock  */
 
 } /* namespace libathome_common  */
@@ -0,0 +1,131 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-common/Result.hpp"
+
+#include <cerrno>
+
+static_assert(sizeof(libathome_common::Status) == sizeof(void*),
+  "Status must be pointer-sized");
+
+const libathome_common::Status::rep_t libathome_common::Status::
+_REP_OUT_OF_MEMORY = {ENOMEM, NULL, "Out of memory!"};
+
+/* ---------------------------------------------------------------  */
+
+const libathome_common::Status::rep_t* libathome_common::Status::
+_copy(const rep_t* rep)
+{
+  if (rep == NULL || rep == &Status::_REP_OUT_OF_MEMORY) return rep;
+
+  rep_t* result = new (std::nothrow) rep_t(*rep);
+  return result != NULL? result: &Status::_REP_OUT_OF_MEMORY;
+}
+
+void libathome_common::Status::
+_free(const rep_t* rep)
+{
+  if (rep == &Status::_REP_OUT_OF_MEMORY) return;
+
+  delete rep;
+}
+
+/* ---------------------------------------------------------------  */
+
+libathome_common::Status::
+Status(const char* _pretty_func, int code, const char* reason_fmt, ...)
+{
+  /* No exceptions here, it's the non-throwing error channel  */
+  rep_t* rep = new (std::nothrow) rep_t;
+  if (rep == NULL) {
+    this->rep = &Status::_REP_OUT_OF_MEMORY;
+    return;
+  }
+
+  rep->code = code;
+  rep->func = _pretty_func;
+
+  ::va_list ap;
+  ::va_start(ap, reason_fmt);
+  if (0 >= ::vsnprintf(rep->message, STRING_LEN, reason_fmt, ap)) {
+    ::strncpy(rep->message, reason_fmt, STRING_LEN-1);
+    rep->message[STRING_LEN-1] = '\0';
+  }
+  ::va_end(ap);
+
+  this->rep = rep;
+}
+
+libathome_common::Status::
+Status(const Status& other)
+  :rep(Status::_copy(other.rep))
+{
+}
+
+libathome_common::Status::
+~Status()
+{
+  Status::_free(this->rep);
+}
+
+libathome_common::Status& libathome_common::Status::
+operator=(const Status& other)
+{
+  if (this != &other) {
+    Status::_free(this->rep);
+    this->rep = Status::_copy(other.rep);
+  }
+
+  return *this;
+}
+
+libathome_common::Status& libathome_common::Status::
+operator=(Status&& other)
+{
+  if (this != &other) {
+    Status::_free(this->rep);
+    this->rep = other.rep;
+    other.rep = NULL;
+  }
+
+  return *this;
+}
+
+/* ***************************************************************  */
+
+int libathome_common::Status::
+get_code() const
+{
+  return this->rep != NULL? this->rep->code: 0;
+}
+
+const char* libathome_common::Status::
+get_message() const
+{
+  return this->rep != NULL? this->rep->message: "";
+}
+
+libathome_common::Error libathome_common::Status::
+to_error() const
+{
+  if (this->rep == NULL)
+    return Err("Status::to_error() called on success!");
+
+  return Error(_ERROR_BT, this->rep->func, "%s", this->rep->message);
+}
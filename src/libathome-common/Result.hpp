@@ -0,0 +1,384 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_RESULT_H__
+#define LIBATHOME_COMMON_RESULT_H__
+/**
+ * @file
+ * @brief Declares the classes ::libathome_common::Status and
+ *        ::libathome_common::Result.
+ */
+
+#include "libathome-common/Common.hpp"
+#include "libathome-common/Error.hpp"
+
+#include <new>
+#include <utility>
+#include <type_traits>
+
+/**
+ * **Constructor** macro of a failed ::libathome_common::Status.
+ *
+ * Like ::Err() it provides the **method name** of the failing method,
+ * so ::libathome_common::Status::to_error() results in the same
+ * ::libathome_common::Error::what() message as `throw Err(...)`.
+ *
+ * **Example**
+ * ```cpp
+ * Status check(int value)
+ * {
+ *   if (value < 0)
+ *     return ErrStatus(EINVAL, "Value %d is negative!", value);
+ *
+ *   return Status();
+ * }
+ * ```
+ */
+#define ErrStatus(code, reason ...) libathome_common::Status( \
+        _ERROR_FUNC, code, reason)
+
+namespace libathome_common
+{
+
+/**
+ * Outcome of an operation which does not `throw`.
+ *
+ * The non-throwing overloads of ::libathome_common::File,
+ * ::libathome_common::Filesystem and
+ * ::libathome_common::RealtimeClock (taking a `std::nothrow`
+ * argument) return it, for hot paths where unwinding an
+ * ::libathome_common::Error is too expensive.
+ *
+ * It has the size of a pointer, which is `NULL` on success.  So
+ * returning it costs nothing if the operation succeeded.  Only a
+ * failure allocates the error details.  Use ::ErrStatus() to
+ * construct a failure and ::libathome_common::Status::to_error() or
+ * ::libathome_common::Status::throw_if_error() to convert it into an
+ * ::libathome_common::Error.
+ *
+ * **Example**
+ * ```cpp
+ * Status status = file.open(File::access_t::read_e, std::nothrow);
+ * if (!status) {
+ *   Log->warn("Skipped: %s", status.get_message());
+ *   return;
+ * }
+ * ```
+ */
+class Status
+{
+public:
+  /**
+   * Constructs a successful status.
+   */
+  Status(): rep(NULL) {}
+  /**
+   * Constructs a failed status, use ::ErrStatus() macro.
+   *
+   * @param _pretty_func Automatically filled by ::ErrStatus() macro
+   * @param code `errno`-like code of the failure, such like `ENOENT`
+   * @param reason_fmt `printf()`-like error message
+   */
+  explicit Status(const char* _pretty_func, int code,
+    const char* reason_fmt, ...) __attribute__((format (printf, 4, 5)));
+
+  /**
+   * Copies the error details, if failed.
+   *
+   * @param other Status to copy
+   */
+  Status(const Status& other);
+  /**
+   * Takes over the error details of `other`, no allocation.
+   *
+   * @param other Status to move, is successful afterwards
+   */
+  Status(Status&& other): rep(other.rep) { other.rep = NULL; }
+
+  /**
+   * Default destructor.
+   */
+  ~Status();
+
+  /**
+   * Copies the error details, if failed.
+   *
+   * @param other Status to copy
+   * @return This instance
+   */
+  Status& operator=(const Status& other);
+  /**
+   * Takes over the error details of `other`, no allocation.
+   *
+   * @param other Status to move, is successful afterwards
+   * @return This instance
+   */
+  Status& operator=(Status&& other);
+
+  /**
+   * Returns `true` if the operation succeeded.
+   *
+   * @return `true` on success
+   */
+  bool is_ok() const { return this->rep == NULL; }
+  /**
+   * Same as ::libathome_common::Status::is_ok().
+   *
+   * @return `true` on success
+   */
+  explicit operator bool() const { return this->rep == NULL; }
+
+  /**
+   * Returns the `errno`-like code of the failure.
+   *
+   * @return The code passed to ::ErrStatus(), `0` on success
+   */
+  int get_code() const;
+  /**
+   * Returns the error message, without method name.
+   *
+   * @return The message passed to ::ErrStatus(), `""` on success
+   */
+  const char* get_message() const;
+
+  /**
+   * Converts a failure to an ::libathome_common::Error.
+   *
+   * The backtrace of the ::libathome_common::Error is the one of the
+   * caller of this method.
+   *
+   * @return The ::libathome_common::Error, with the method name of
+   *         the failing method
+   */
+  Error to_error() const;
+  /**
+   * Throws ::libathome_common::Status::to_error() if failed.
+   *
+   * @exception ::libathome_common::Error will be thrown if failed
+   */
+  void throw_if_error() const noexcept(false)
+  {
+    if (this->rep != NULL) throw this->to_error();
+  }
+
+private:
+  typedef struct {
+    int code;
+    /** `__PRETTY_FUNCTION__`, `static` allocated  */
+    const char* func;
+    string_t message;
+  } rep_t;
+
+  /** Used if there is no memory left for a new rep_t  */
+  static const rep_t _REP_OUT_OF_MEMORY;
+
+  /** `NULL` on success  */
+  const rep_t* rep;
+
+  static const rep_t* _copy(const rep_t* rep);
+  static void _free(const rep_t* rep);
+
+}; /* class Status  */
+
+/* ***************************************************************  */
+
+/**
+ * A value of type `T` or a failed ::libathome_common::Status.
+ *
+ * Returned by the non-throwing overloads which have a result.
+ * Unlike `std::optional` (not available in C++11) `T` needs no
+ * default constructor.
+ *
+ * **Example**
+ * ```cpp
+ * Result<std::vector<std::string>> names
+ *   = Filesystem::list(path, std::nothrow);
+ * if (!names) return names.get_status();
+ *
+ * for (const std::string& name: names.get()) ...
+ * ```
+ *
+ * @tparam T Type of the value
+ */
+template<typename T>
+class Result
+{
+public:
+  /**
+   * Constructs a successful result.
+   *
+   * @param value The value
+   */
+  Result(const T& value): status() { new (&this->storage) T(value); }
+  /**
+   * Constructs a successful result.
+   *
+   * @param value The value
+   */
+  Result(T&& value): status()
+  {
+    new (&this->storage) T(std::move(value));
+  }
+  /**
+   * Constructs a failed result.
+   *
+   * @param status The failure, must NOT be successful
+   */
+  Result(const Status& status): status(status) { this->_check(); }
+  /**
+   * Constructs a failed result.
+   *
+   * @param status The failure, must NOT be successful
+   */
+  Result(Status&& status): status(std::move(status)) { this->_check(); }
+
+  /**
+   * Copy constructor.
+   *
+   * @param other Result to copy
+   */
+  Result(const Result& other): status(other.status)
+  {
+    if (this->status) new (&this->storage) T(other._value());
+  }
+  /**
+   * Move constructor.
+   *
+   * @param other Result to move
+   */
+  Result(Result&& other): status(other.status)
+  {
+    /* STATUS is copied, OTHER still needs to know whether its value
+     * must be destructed
+     */
+    if (this->status) new (&this->storage) T(std::move(other._value()));
+  }
+
+  /**
+   * Destructs the value, if successful.
+   */
+  ~Result() { if (this->status) this->_value().~T(); }
+
+  /**
+   * Copy assignment.
+   *
+   * @param other Result to copy
+   * @return This instance
+   */
+  Result& operator=(const Result& other)
+  {
+    if (this != &other) {
+      this->~Result();
+      new (this) Result(other);
+    }
+    return *this;
+  }
+  /**
+   * Move assignment.
+   *
+   * @param other Result to move
+   * @return This instance
+   */
+  Result& operator=(Result&& other)
+  {
+    if (this != &other) {
+      this->~Result();
+      new (this) Result(std::move(other));
+    }
+    return *this;
+  }
+
+  /**
+   * Returns `true` if a value is available.
+   *
+   * @return `true` on success
+   */
+  bool is_ok() const { return this->status.is_ok(); }
+  /**
+   * Same as ::libathome_common::Result::is_ok().
+   *
+   * @return `true` on success
+   */
+  explicit operator bool() const { return this->status.is_ok(); }
+
+  /**
+   * Returns the status.
+   *
+   * @return Successful ::libathome_common::Status if a value is
+   *         available
+   */
+  const Status& get_status() const { return this->status; }
+
+  /**
+   * Returns the value.
+   *
+   * @return The value
+   * @exception ::libathome_common::Error will be thrown if failed,
+   *            see ::libathome_common::Status::to_error()
+   */
+  T& get() noexcept(false)
+  {
+    this->status.throw_if_error();
+    return this->_value();
+  }
+  /**
+   * Returns the value.
+   *
+   * @return The value
+   * @exception ::libathome_common::Error will be thrown if failed,
+   *            see ::libathome_common::Status::to_error()
+   */
+  const T& get() const noexcept(false)
+  {
+    this->status.throw_if_error();
+    return this->_value();
+  }
+  /**
+   * Returns the value or `fallback` if failed.
+   *
+   * @param fallback Returned if failed
+   * @return The value or `fallback`
+   */
+  T get_or(const T& fallback) const
+  {
+    return this->status? this->_value(): fallback;
+  }
+
+private:
+  Status status;
+  /** Constructed only if ::libathome_common::Result::status is
+   * successful  */
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+  T& _value() { return *reinterpret_cast<T*>(&this->storage); }
+  const T& _value() const
+  {
+    return *reinterpret_cast<const T*>(&this->storage);
+  }
+
+  void _check()
+  {
+    if (this->status)
+      this->status = ErrStatus(EINVAL, "Result without value!");
+  }
+
+}; /* class Result  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_RESULT_H__  */
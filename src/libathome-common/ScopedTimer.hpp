@@ -0,0 +1,118 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_SCOPEDTIMER_H__
+#define LIBATHOME_COMMON_SCOPEDTIMER_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::ScopedTimer.
+ */
+
+#include "libathome-common/Common.hpp"
+#include "libathome-common/MonotonicClock.hpp"
+#include "libathome-common/Histogram.hpp"
+
+namespace libathome_common
+{
+
+/**
+ * Measures the lifetime of a scope into a
+ * ::libathome_common::Histogram.
+ *
+ * Fetches the time on construction and records the elapsed
+ * nanoseconds on destruction, using
+ * ::libathome_common::MonotonicClock::now().  Costs two clock reads
+ * and ::libathome_common::Histogram::record(), no allocation.
+ *
+ * **Example**
+ * ```cpp
+ * static Histogram verify_ns;
+ *
+ * {
+ *   ScopedTimer timer(verify_ns);
+ *   task.verify();
+ * }
+ *
+ * Log->info("verify: %s", verify_ns.to_string(1000).c_str());
+ * ```
+ */
+class ScopedTimer
+{
+public:
+  /**
+   * Starts the timer.
+   *
+   * @param histogram Records the elapsed nanoseconds, must live
+   *                  longer than this timer
+   */
+  explicit ScopedTimer(Histogram& histogram)
+    :histogram(&histogram), start(MonotonicClock::now())
+  {
+  }
+  /**
+   * Records the elapsed time, if not yet stopped.
+   */
+  ~ScopedTimer() { this->stop(); }
+
+  /**
+   * Records the elapsed time now, instead of on destruction.
+   *
+   * Further calls will be ignored.
+   *
+   * @return Elapsed nanoseconds, `0` if already stopped or canceled
+   */
+  uint64_t stop()
+  {
+    if (this->histogram == NULL) return 0;
+
+    uint64_t result = this->get_elapsed();
+    this->histogram->record(result);
+    this->histogram = NULL;
+
+    return result;
+  }
+  /**
+   * Do not record anything, i.e. if the measured operation failed.
+   */
+  void cancel() { this->histogram = NULL; }
+
+  /**
+   * Returns the time since the timer was started.
+   *
+   * @return Elapsed nanoseconds
+   */
+  uint64_t get_elapsed() const
+  {
+    uint64_t now = MonotonicClock::now();
+
+    return now > this->start? now - this->start: 0;
+  }
+
+private:
+  /** `NULL` if stopped or canceled  */
+  Histogram* histogram;
+  uint64_t start;
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+}; /* class ScopedTimer  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_SCOPEDTIMER_H__  */
@@ -0,0 +1,433 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-common/ThreadPool.hpp"
+#include "libathome-common/Error.hpp"
+#include "libathome-common/Logger.hpp"
+#include "libathome-common/CrashHandler.hpp"
+
+#include <cerrno>
+#include <cctype>
+#include <cstdlib>
+#include <system_error>
+#ifdef __linux__
+#  include <pthread.h>
+#  include <sched.h>
+#endif /* ifdef __linux__  */
+
+
+/**
+ * A worker thread with its Chase-Lev deque.
+ *
+ * See "Correct and Efficient Work-Stealing for Weak Memory Models"
+ * by Lê, Pop, Cohen and Zappa Nardelli, PPoPP 2013.  Only the owner
+ * pushes and takes at BOTTOM, others steal at TOP.
+ */
+struct libathome_common::ThreadPool::worker_s
+{
+  typedef struct {
+    int64_t capacity;
+    std::atomic<task_t*>* slots;
+  } array_t;
+
+  ThreadPool* pool;
+  unsigned index;
+  /** State of the xorshift generator, to choose victims  */
+  uint64_t random;
+  std::thread thread;
+
+  /** Grown arrays, stealers may still read them  */
+  std::vector<array_t*> retired;
+
+  /** TOP and BOTTOM on their own cache lines, against false sharing  */
+  char padding0[64];
+  std::atomic<int64_t> top;
+  char padding1[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> bottom;
+  std::atomic<array_t*> array;
+  char padding2[64 - sizeof(std::atomic<int64_t>)
+                - sizeof(std::atomic<array_t*>)];
+
+  static array_t* _array_new(int64_t capacity)
+  {
+    array_t* result = new array_t;
+    result->capacity = capacity;
+    result->slots = new std::atomic<task_t*>[capacity];
+
+    return result;
+  }
+  static void _array_delete(array_t* array)
+  {
+    delete[] array->slots;
+    delete array;
+  }
+
+  worker_s(ThreadPool* pool, unsigned index)
+    :pool(pool), index(index), random(0x9e3779b97f4a7c15 * (index + 1)),
+     top(0), bottom(0), array(_array_new(256))
+  {
+  }
+  ~worker_s()
+  {
+    for (array_t* array: this->retired) _array_delete(array);
+    _array_delete(this->array.load(std::memory_order_relaxed));
+  }
+
+  /** Owner only  */
+  void push(task_t* task)
+  {
+    int64_t b = this->bottom.load(std::memory_order_relaxed);
+    int64_t t = this->top.load(std::memory_order_acquire);
+    array_t* a = this->array.load(std::memory_order_relaxed);
+
+    if (b - t > a->capacity - 1) {
+      array_t* grown = _array_new(a->capacity * 2);
+      for (int64_t i=t; i<b; i++) {
+        grown->slots[i & (grown->capacity - 1)].store(
+          a->slots[i & (a->capacity - 1)].load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+      }
+      this->retired.push_back(a);
+      this->array.store(grown, std::memory_order_release);
+      a = grown;
+    }
+
+    /* Release store instead of the fence of the paper, same cost and
+     * understood by ThreadSanitizer
+     */
+    a->slots[b & (a->capacity - 1)].store(task, std::memory_order_relaxed);
+    this->bottom.store(b + 1, std::memory_order_release);
+  }
+
+  /** Owner only, `NULL` if empty  */
+  task_t* take()
+  {
+    int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+    array_t* a = this->array.load(std::memory_order_relaxed);
+    this->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = this->top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      this->bottom.store(b + 1, std::memory_order_relaxed);
+      return NULL;
+    }
+
+    task_t* result = a->slots[b & (a->capacity - 1)]
+      .load(std::memory_order_relaxed);
+    if (t == b) {
+      /* The last one, race against the stealers  */
+      if (!this->top.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst,
+            std::memory_order_relaxed)) {
+        result = NULL;
+      }
+      this->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    return result;
+  }
+
+  /** Any thread, `NULL` if empty or lost a race  */
+  task_t* steal()
+  {
+    int64_t t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = this->bottom.load(std::memory_order_acquire);
+    if (t >= b) return NULL;
+
+    array_t* a = this->array.load(std::memory_order_acquire);
+    task_t* result = a->slots[t & (a->capacity - 1)]
+      .load(std::memory_order_relaxed);
+    if (!this->top.compare_exchange_strong(
+          t, t + 1, std::memory_order_seq_cst,
+          std::memory_order_relaxed)) {
+      return NULL;
+    }
+
+    return result;
+  }
+
+}; /* struct worker_s  */
+
+/* ***************************************************************  */
+
+thread_local libathome_common::ThreadPool::worker_t*
+libathome_common::ThreadPool::_current = NULL;
+
+std::vector<unsigned> libathome_common::ThreadPool::
+parse_cpus(const std::string& list) noexcept(false)
+{
+  std::vector<unsigned> result;
+
+  const char* pos = list.c_str();
+  for (;;) {
+    char* end;
+    errno = 0;
+    unsigned long first = ::strtoul(pos, &end, 10);
+    unsigned long last = first;
+    bool valid = end != pos && ::isdigit(*pos) && errno == 0;
+
+    if (valid && *end == '-') {
+      pos = end + 1;
+      last = ::strtoul(pos, &end, 10);
+      valid = end != pos && ::isdigit(*pos) && errno == 0 && first <= last;
+    }
+    if (!valid || last >= 65536 || (*end != ',' && *end != '\0'))
+      throw Err("Invalid CPU list '%s'!", list.c_str());
+
+    for (unsigned long cpu=first; cpu<=last; cpu++)
+      result.push_back((unsigned) cpu);
+
+    if (*end == '\0') break;
+    pos = end + 1;
+  }
+
+  return result;
+}
+
+/* ***************************************************************  */
+
+libathome_common::ThreadPool::
+ThreadPool(unsigned threads, const std::vector<unsigned>& cpus)
+  :queued(0), pending(0), steals(0), sleeping(0), stopping(false)
+{
+  if (threads == 0) threads = (unsigned) cpus.size();
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+
+  /* All deques must exist before the first steal  */
+  for (unsigned i=0; i<threads; i++)
+    this->workers.push_back(new worker_t(this, i));
+
+  try {
+    for (worker_t* worker: this->workers) {
+      worker->thread = std::thread(&ThreadPool::_worker_main, this, worker);
+      if (cpus.empty()) continue;
+
+#ifdef __linux__
+      unsigned cpu = cpus[worker->index % cpus.size()];
+      ::cpu_set_t set;
+      CPU_ZERO(&set);
+      if (cpu >= CPU_SETSIZE)
+        throw Err("Could not pin worker to CPU %u, too large!", cpu);
+      CPU_SET(cpu, &set);
+
+      int err = ::pthread_setaffinity_np(
+        worker->thread.native_handle(), sizeof(set), &set);
+      if (err != 0) {
+        throw Err("Could not pin worker to CPU %u: %s!", cpu,
+                  ::strerror(err));
+      }
+#endif /* ifdef __linux__  */
+    }
+  } catch (std::system_error& e) {
+    this->_shutdown();
+    throw Err("Could not start worker thread: %s!", e.what());
+  } catch (Error&) {
+    this->_shutdown();
+    throw;
+  }
+}
+
+libathome_common::ThreadPool::
+~ThreadPool()
+{
+  this->wait_idle();
+  this->_shutdown();
+}
+
+void libathome_common::ThreadPool::
+_shutdown()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->sleep_mutex);
+    this->stopping.store(true);
+    this->sleep_cond.notify_all();
+  }
+
+  /* Others may steal from a deque until they are joined  */
+  for (worker_t* worker: this->workers)
+    if (worker->thread.joinable()) worker->thread.join();
+  for (worker_t* worker: this->workers) delete worker;
+  this->workers.clear();
+}
+
+/* ***************************************************************  */
+
+void libathome_common::ThreadPool::
+submit(task_t task) noexcept(false)
+{
+  if (!task) throw Err("Argument TASK is empty!");
+  if (this->stopping.load(std::memory_order_relaxed))
+    throw Err("Thread pool is stopping!");
+
+  task_t* queue_task = new task_t(std::move(task));
+  this->pending.fetch_add(1);
+
+  worker_t* worker = ThreadPool::_current;
+  if (worker != NULL && worker->pool == this) {
+    worker->push(queue_task);
+  } else {
+    std::lock_guard<std::mutex> lock(this->inject_mutex);
+    this->inject.push_back(queue_task);
+  }
+
+  /* Published before counted, a worker which sees the count finds
+   * the task
+   */
+  this->queued.fetch_add(1);
+  this->_wake();
+}
+
+void libathome_common::ThreadPool::
+wait_idle()
+{
+  std::unique_lock<std::mutex> lock(this->sleep_mutex);
+
+  while (this->pending.load() != 0) this->idle_cond.wait(lock);
+}
+
+unsigned libathome_common::ThreadPool::
+get_threads() const
+{
+  return (unsigned) this->workers.size();
+}
+
+int libathome_common::ThreadPool::
+get_worker_index() const
+{
+  worker_t* worker = ThreadPool::_current;
+
+  return worker != NULL && worker->pool == this? (int) worker->index: -1;
+}
+
+uint64_t libathome_common::ThreadPool::
+get_steals() const
+{
+  return this->steals.load(std::memory_order_relaxed);
+}
+
+/* ***************************************************************  */
+
+void libathome_common::ThreadPool::
+_wake()
+{
+  /* Pairs with SLEEPING incremented before QUEUED is checked in
+   * _worker_main(), both sequentially consistent.  Notifying under
+   * the lock, so a worker can't miss it between check and wait.
+   */
+  if (this->sleeping.load() == 0) return;
+
+  std::lock_guard<std::mutex> lock(this->sleep_mutex);
+  this->sleep_cond.notify_one();
+}
+
+libathome_common::ThreadPool::task_t* libathome_common::ThreadPool::
+_find(worker_t* worker)
+{
+  task_t* result = worker->take();
+
+  if (result == NULL && this->queued.load(std::memory_order_relaxed) != 0) {
+    std::lock_guard<std::mutex> lock(this->inject_mutex);
+    if (!this->inject.empty()) {
+      result = this->inject.front();
+      this->inject.pop_front();
+    }
+  }
+
+  /* Random victims, so stealers don't line up at the same deque  */
+  size_t count = this->workers.size();
+  for (size_t i=0; result == NULL && count > 1 && i<2*count; i++) {
+    worker->random ^= worker->random << 13;
+    worker->random ^= worker->random >> 7;
+    worker->random ^= worker->random << 17;
+
+    worker_t* victim = this->workers[worker->random % count];
+    if (victim == worker) continue;
+
+    result = victim->steal();
+    if (result != NULL) this->steals.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (result != NULL) this->queued.fetch_sub(1, std::memory_order_relaxed);
+  return result;
+}
+
+void libathome_common::ThreadPool::
+_run(task_t* task)
+{
+  try {
+    (*task)();
+  } catch (Error& e) {
+    if (libathome_common::Log != NULL) Log->error(e);
+    else ::fprintf(stderr, "ERROR: %s\n", e.what());
+  } catch (std::exception& e) {
+    /* Must not leave the worker, that would terminate the process  */
+    if (libathome_common::Log != NULL)
+      Log->error("Task has failed: %s", e.what());
+    else
+      ::fprintf(stderr, "ERROR: Task has failed: %s\n", e.what());
+  } catch (...) {
+    if (libathome_common::Log != NULL)
+      Log->error("Task has failed: unknown exception");
+    else
+      ::fprintf(stderr, "ERROR: Task has failed: unknown exception\n");
+  }
+  delete task;
+
+  if (this->pending.fetch_sub(1) == 1) {
+    std::lock_guard<std::mutex> lock(this->sleep_mutex);
+    this->idle_cond.notify_all();
+  }
+}
+
+void libathome_common::ThreadPool::
+_worker_main(worker_t* worker)
+{
+  ThreadPool::_current = worker;
+  CrashHandler::prepare_thread();
+
+  unsigned idle = 0;
+  for (;;) {
+    task_t* task = this->_find(worker);
+    if (task != NULL) {
+      this->_run(task);
+      idle = 0;
+      continue;
+    }
+
+    /* Spin a little, new tasks often follow quickly  */
+    if (++idle < 64) {
+      std::this_thread::yield();
+      continue;
+    }
+    idle = 0;
+
+    std::unique_lock<std::mutex> lock(this->sleep_mutex);
+    this->sleeping.fetch_add(1);
+    while (this->queued.load() == 0 && !this->stopping.load())
+      this->sleep_cond.wait(lock);
+    this->sleeping.fetch_sub(1);
+
+    if (this->stopping.load() && this->queued.load() == 0) break;
+  }
+
+  ThreadPool::_current = NULL;
+}
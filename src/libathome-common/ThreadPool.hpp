@@ -0,0 +1,178 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_THREADPOOL_H__
+#define LIBATHOME_COMMON_THREADPOOL_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::ThreadPool.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace libathome_common
+{
+
+/**
+ * Work-stealing pool of worker threads, to saturate all cores.
+ *
+ * Every worker owns a Chase-Lev deque.  Tasks submitted by a worker
+ * are pushed to the bottom of its own deque and popped from there
+ * (LIFO, cache-friendly), idle workers steal from the top of other
+ * deques (FIFO).  Tasks submitted by other threads go to a shared
+ * injection queue.  Workers without work sleep, so an idle pool
+ * costs no CPU.
+ *
+ * The instance of the process is created by
+ * ::libathome_common::Common, get it via
+ * ::libathome_common::Common::get_pool().  Its size can be set by the
+ * command-line options `--threads=N` and `--cpus=LIST`.
+ *
+ * **Example**
+ * ```cpp
+ * ThreadPool* pool = Common::get()->get_pool();
+ *
+ * for (uint64_t n=first; n<last; n++)
+ *   pool->submit([n]() { factorize(n); });
+ * pool->wait_idle();
+ * ```
+ */
+class ThreadPool
+{
+public:
+  /**
+   * A unit of work.
+   */
+  typedef std::function<void()> task_t;
+
+  /**
+   * Parses a CPU list, such like `"0,2,4-7"`.
+   *
+   * @param list Comma separated CPU numbers or ranges
+   * @return The CPU numbers, in order of `list`
+   * @exception ::libathome_common::Error will be thrown if `list` is
+   *            malformed
+   */
+  static std::vector<unsigned> parse_cpus(const std::string& list)
+    noexcept(false);
+
+  /**
+   * Starts the workers.
+   *
+   * @param threads Number of workers, `0` for one per CPU in `cpus`
+   *                or per hardware thread
+   * @param cpus Pin worker `i` to CPU `cpus[i % cpus.size()]`, or
+   *             don't pin if empty.  Pinning is ignored on systems
+   *             which don't support it.
+   * @exception ::libathome_common::Error will be thrown if a thread
+   *            could not be started or pinned
+   */
+  explicit ThreadPool(unsigned threads = 0,
+    const std::vector<unsigned>& cpus = std::vector<unsigned>())
+    noexcept(false);
+  /**
+   * Runs all queued tasks and stops the workers.
+   */
+  virtual ~ThreadPool();
+
+  /**
+   * Queues a task.
+   *
+   * Thread-safe, tasks may submit further tasks.  A task should catch
+   * its exceptions, all which escape will be logged and ignored.
+   *
+   * @param task The task
+   * @exception ::libathome_common::Error will be thrown if `task` is
+   *            empty or the pool is stopping
+   */
+  virtual void submit(task_t task) noexcept(false);
+  /**
+   * Blocks until all submitted tasks, including the ones they
+   * submitted, are done.
+   *
+   * Must not be called by a task of this pool.
+   */
+  virtual void wait_idle();
+
+  /**
+   * Returns the number of workers.
+   *
+   * @return Number of workers
+   */
+  virtual unsigned get_threads() const;
+  /**
+   * Returns the index of the calling worker thread.
+   *
+   * @return `[0, get_threads())`, or `-1` if not called by a worker of
+   *         this pool
+   */
+  virtual int get_worker_index() const;
+  /**
+   * Returns the number of tasks which were stolen from other workers.
+   *
+   * @return Number of stolen tasks since construction
+   */
+  virtual uint64_t get_steals() const;
+
+private:
+  /** Defined in ThreadPool.cpp  */
+  struct worker_s;
+  typedef struct worker_s worker_t;
+
+  std::vector<worker_t*> workers;
+
+  /** For tasks of threads which are not workers  */
+  std::mutex inject_mutex;
+  std::deque<task_t*> inject;
+
+  /** Tasks in deques or INJECT, to decide whether to sleep  */
+  std::atomic<uint64_t> queued;
+  /** Submitted tasks which are not done yet  */
+  std::atomic<uint64_t> pending;
+  std::atomic<uint64_t> steals;
+
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_cond;
+  std::condition_variable idle_cond;
+  std::atomic<unsigned> sleeping;
+  std::atomic<bool> stopping;
+
+  static thread_local worker_t* _current;
+
+  void _worker_main(worker_t* worker);
+  task_t* _find(worker_t* worker);
+  void _run(task_t* task);
+  void _wake();
+  void _shutdown();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+}; /* class ThreadPool  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_THREADPOOL_H__  */
@@ -0,0 +1,386 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-common/TimerWheel.hpp"
+#include "libathome-common/MonotonicClock.hpp"
+#include "libathome-common/Error.hpp"
+#include "libathome-common/Logger.hpp"
+
+
+const uint32_t libathome_common::TimerWheel::_NIL;
+const uint64_t libathome_common::TimerWheel::_NEVER;
+
+/* ***************************************************************  */
+
+libathome_common::TimerWheel::
+TimerWheel(unsigned tick_ms)
+  :tick_ns((uint64_t) (tick_ms == 0? 1: tick_ms) * 1000000),
+   origin_ns(MonotonicClock::now()), current(0), free_first(_NIL),
+   size(0), poller_stop(false), poller_wake(_NEVER)
+{
+  for (unsigned i=0; i<LEVELS * SLOTS; i++) this->heads[i] = _NIL;
+  for (unsigned i=0; i<LEVELS; i++) this->occupied[i] = 0;
+}
+
+libathome_common::TimerWheel::
+~TimerWheel()
+{
+  this->stop();
+}
+
+void libathome_common::TimerWheel::
+set_executor(const executor_t& executor)
+{
+  std::lock_guard<std::mutex> lock(this->timers_mutex);
+
+  this->executor = executor;
+}
+
+/* ***************************************************************  */
+
+uint64_t libathome_common::TimerWheel::
+_now_tick() const
+{
+  return (MonotonicClock::now() - this->origin_ns) / this->tick_ns;
+}
+
+void libathome_common::TimerWheel::
+_link(uint32_t index)
+{
+  entry_t& entry = this->entries[index];
+
+  /* The finest level where EXPIRY and CURRENT share all coarser
+   * slots.  Then the slot of EXPIRY is after the one of CURRENT on
+   * that level.
+   */
+  uint64_t diff = entry.expiry ^ this->current;
+  unsigned level = diff < SLOTS
+    ? 0: (63 - ::__builtin_clzll(diff)) / SLOT_BITS;
+  unsigned slot;
+  if (level < LEVELS) {
+    slot = (unsigned) (entry.expiry >> (level * SLOT_BITS)) & (SLOTS - 1);
+  } else {
+    /* Park it in the coarsest slot which cascades last, it will be
+     * linked again then
+     */
+    level = LEVELS - 1;
+    slot = (unsigned) ((this->current >> (level * SLOT_BITS)) - 1)
+      & (SLOTS - 1);
+  }
+
+  uint32_t& head = this->heads[level * SLOTS + slot];
+  entry.slot = level * SLOTS + slot;
+  entry.prev = _NIL;
+  entry.next = head;
+  if (head != _NIL) this->entries[head].prev = index;
+  head = index;
+  this->occupied[level] |= (uint64_t) 1 << slot;
+}
+
+void libathome_common::TimerWheel::
+_unlink(uint32_t index)
+{
+  entry_t& entry = this->entries[index];
+
+  if (entry.prev != _NIL) this->entries[entry.prev].next = entry.next;
+  else this->heads[entry.slot] = entry.next;
+  if (entry.next != _NIL) this->entries[entry.next].prev = entry.prev;
+
+  if (this->heads[entry.slot] == _NIL) {
+    this->occupied[entry.slot / SLOTS] &=
+      ~((uint64_t) 1 << (entry.slot % SLOTS));
+  }
+}
+
+uint64_t libathome_common::TimerWheel::
+_next_event() const
+{
+  uint64_t result = _NEVER;
+
+  for (unsigned level=0; level<LEVELS; level++) {
+    uint64_t occupied = this->occupied[level];
+    if (occupied == 0) continue;
+
+    unsigned shift = level * SLOT_BITS;
+    unsigned current_slot = (unsigned) (this->current >> shift)
+      & (SLOTS - 1);
+    uint64_t rotation = (this->current >> (shift + SLOT_BITS))
+      << (shift + SLOT_BITS);
+
+    /* The next slot after CURRENT, otherwise in the next rotation  */
+    uint64_t after = current_slot == SLOTS - 1
+      ? 0: occupied & (~(uint64_t) 0 << (current_slot + 1));
+    uint64_t tick;
+    if (after != 0) {
+      tick = rotation | ((uint64_t) ::__builtin_ctzll(after) << shift);
+    } else {
+      tick = (rotation + ((uint64_t) 1 << (shift + SLOT_BITS)))
+        | ((uint64_t) ::__builtin_ctzll(occupied) << shift);
+    }
+
+    if (tick < result) result = tick;
+  }
+
+  return result;
+}
+
+void libathome_common::TimerWheel::
+_advance(uint64_t target, std::vector<callback_t>& expired)
+{
+  for (;;) {
+    uint64_t next = this->_next_event();
+    if (next > target) break;
+    this->current = next;
+
+    /* Cascade coarse to fine, timers may fall through several levels
+     * down to the slot of CURRENT
+     */
+    for (unsigned level=LEVELS-1; level>0; level--) {
+      unsigned shift = level * SLOT_BITS;
+      if ((this->current & (((uint64_t) 1 << shift) - 1)) != 0) continue;
+
+      unsigned slot = (unsigned) (this->current >> shift) & (SLOTS - 1);
+      uint32_t index = this->heads[level * SLOTS + slot];
+      this->heads[level * SLOTS + slot] = _NIL;
+      this->occupied[level] &= ~((uint64_t) 1 << slot);
+
+      while (index != _NIL) {
+        uint32_t next_index = this->entries[index].next;
+        this->_link(index);
+        index = next_index;
+      }
+    }
+
+    unsigned slot = (unsigned) this->current & (SLOTS - 1);
+    uint32_t index = this->heads[slot];
+    this->heads[slot] = _NIL;
+    this->occupied[0] &= ~((uint64_t) 1 << slot);
+
+    while (index != _NIL) {
+      entry_t& entry = this->entries[index];
+      uint32_t next_index = entry.next;
+
+      expired.push_back(std::move(entry.callback));
+      entry.callback = nullptr;
+      entry.slot = _NIL;
+      entry.generation++;
+      entry.next = this->free_first;
+      this->free_first = index;
+      this->size--;
+
+      index = next_index;
+    }
+  }
+
+  if (target > this->current) this->current = target;
+}
+
+/* ***************************************************************  */
+
+libathome_common::TimerWheel::handle_t libathome_common::TimerWheel::
+add(uint64_t delay_ms, callback_t callback) noexcept(false)
+{
+  if (!callback) throw Err("Argument CALLBACK is empty!");
+
+  uint64_t expiry = (MonotonicClock::now() - this->origin_ns
+                     + delay_ms * 1000000 + this->tick_ns - 1)
+    / this->tick_ns;
+
+  std::lock_guard<std::mutex> lock(this->timers_mutex);
+
+  /* CURRENT is processed already  */
+  if (expiry <= this->current) expiry = this->current + 1;
+
+  uint32_t index = this->free_first;
+  if (index != _NIL) {
+    this->free_first = this->entries[index].next;
+  } else {
+    if (this->entries.size() >= _NIL)
+      throw Err("Too many timers (%lu)!", (unsigned long) this->size);
+
+    try {
+      this->entries.emplace_back();
+    } catch (std::bad_alloc& e) {
+      throw Err("Out of memory for %lu timers!",
+                (unsigned long) this->size + 1);
+    }
+    index = (uint32_t) this->entries.size() - 1;
+    this->entries[index].generation = 1;
+  }
+
+  entry_t& entry = this->entries[index];
+  entry.expiry = expiry;
+  entry.callback = std::move(callback);
+  this->_link(index);
+  this->size++;
+
+  if (expiry < this->poller_wake) this->poller_cond.notify_one();
+
+  return ((uint64_t) entry.generation << 32) | index;
+}
+
+bool libathome_common::TimerWheel::
+cancel(handle_t handle)
+{
+  uint32_t index = (uint32_t) handle;
+  uint32_t generation = (uint32_t) (handle >> 32);
+
+  callback_t callback;
+  {
+    std::lock_guard<std::mutex> lock(this->timers_mutex);
+
+    if (index >= this->entries.size()) return false;
+    entry_t& entry = this->entries[index];
+    if (entry.slot == _NIL || entry.generation != generation) return false;
+
+    this->_unlink(index);
+    /* Destruct the captures outside of the lock  */
+    callback = std::move(entry.callback);
+    entry.callback = nullptr;
+    entry.slot = _NIL;
+    entry.generation++;
+    entry.next = this->free_first;
+    this->free_first = index;
+    this->size--;
+  }
+
+  return true;
+}
+
+size_t libathome_common::TimerWheel::
+get_size() const
+{
+  std::lock_guard<std::mutex> lock(this->timers_mutex);
+
+  return this->size;
+}
+
+/* ***************************************************************  */
+
+size_t libathome_common::TimerWheel::
+poll()
+{
+  std::vector<callback_t> expired;
+  executor_t executor;
+  {
+    std::lock_guard<std::mutex> lock(this->timers_mutex);
+
+    this->_advance(this->_now_tick(), expired);
+    if (!expired.empty()) executor = this->executor;
+  }
+
+  for (callback_t& callback: expired) {
+    try {
+      if (executor) executor(std::move(callback));
+      else callback();
+    } catch (Error& e) {
+      /* The other timers must expire anyway, they are unlinked  */
+      if (libathome_common::Log != NULL) Log->error(e);
+      else ::fprintf(stderr, "ERROR: %s\n", e.what());
+    } catch (std::exception& e) {
+      if (libathome_common::Log != NULL)
+        Log->error("Timer callback has failed: %s", e.what());
+      else
+        ::fprintf(stderr, "ERROR: Timer callback has failed: %s\n",
+                  e.what());
+    } catch (...) {
+      if (libathome_common::Log != NULL)
+        Log->error("Timer callback has failed: unknown exception");
+      else
+        ::fprintf(stderr,
+                  "ERROR: Timer callback has failed: unknown exception\n");
+    }
+  }
+
+  return expired.size();
+}
+
+uint64_t libathome_common::TimerWheel::
+get_next_ms() const
+{
+  uint64_t next;
+  {
+    std::lock_guard<std::mutex> lock(this->timers_mutex);
+
+    next = this->_next_event();
+  }
+  if (next == _NEVER) return UINT64_MAX;
+
+  uint64_t due_ns = this->origin_ns + next * this->tick_ns;
+  uint64_t now_ns = MonotonicClock::now();
+  if (due_ns <= now_ns) return 0;
+
+  return (due_ns - now_ns + 999999) / 1000000;
+}
+
+/* ***************************************************************  */
+
+void libathome_common::TimerWheel::
+start()
+{
+  std::lock_guard<std::mutex> lock(this->timers_mutex);
+
+  if (this->poller.joinable()) return;
+
+  this->poller_stop = false;
+  this->poller = std::thread(&TimerWheel::_poller_main, this);
+}
+
+void libathome_common::TimerWheel::
+stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->timers_mutex);
+
+    if (!this->poller.joinable()) return;
+    this->poller_stop = true;
+    this->poller_cond.notify_one();
+  }
+  this->poller.join();
+}
+
+void libathome_common::TimerWheel::
+_poller_main()
+{
+  std::unique_lock<std::mutex> lock(this->timers_mutex);
+
+  while (!this->poller_stop) {
+    /* A cascade is an event too, but never later than its timers  */
+    this->poller_wake = this->_next_event();
+    if (this->poller_wake == _NEVER) {
+      this->poller_cond.wait(lock);
+      continue;
+    }
+
+    uint64_t due_ns = this->origin_ns + this->poller_wake * this->tick_ns;
+    uint64_t now_ns = MonotonicClock::now();
+    if (now_ns < due_ns) {
+      this->poller_cond.wait_for(
+        lock, std::chrono::nanoseconds(due_ns - now_ns));
+      continue;
+    }
+    this->poller_wake = _NEVER;
+
+    lock.unlock();
+    this->poll();
+    lock.lock();
+  }
+
+  this->poller_wake = _NEVER;
+}
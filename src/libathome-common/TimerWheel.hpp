@@ -0,0 +1,239 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_TIMERWHEEL_H__
+#define LIBATHOME_COMMON_TIMERWHEEL_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::TimerWheel.
+ */
+
+#include "libathome-common/Common.hpp"
+
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace libathome_common
+{
+
+/**
+ * Hierarchical timing wheel for many timeouts, such like task leases,
+ * heartbeats and retry backoffs.
+ *
+ * Time is counted in ticks of ::libathome_common::MonotonicClock.
+ * The wheel has ::libathome_common::TimerWheel::LEVELS levels of
+ * ::libathome_common::TimerWheel::SLOTS slots, every level is
+ * ::libathome_common::TimerWheel::SLOTS times coarser than the one
+ * below.  A timer is put into the finest level which can hold its
+ * expiry and cascades down when the time gets closer.  So adding and
+ * canceling is `O(1)`, advancing is amortized `O(1)` per timer and
+ * empty slots are skipped via bitmaps, even after a long pause.
+ *
+ * Timers live in one pooled array, a timer costs about 64 bytes.
+ * All methods are thread-safe, the callbacks are called without
+ * holding the lock, so they may add or cancel timers.
+ *
+ * Call ::libathome_common::TimerWheel::poll() from an own event loop
+ * or ::libathome_common::TimerWheel::start() a background thread.
+ * The callbacks are called in the polling thread, unless an executor
+ * was set via ::libathome_common::TimerWheel::set_executor(), such
+ * like a thread pool.
+ *
+ * **Example**
+ * ```cpp
+ * TimerWheel timers;
+ * timers.start();
+ *
+ * TimerWheel::handle_t lease = timers.add(30000, [task_id]() {
+ *   LogWarn("lease of task %lu expired", task_id);
+ * });
+ * ...
+ * timers.cancel(lease);
+ * ```
+ */
+class TimerWheel
+{
+public:
+  /**
+   * Identifies a timer, never `0` for a valid one.
+   */
+  typedef uint64_t handle_t;
+  /**
+   * Function to call on expiry.
+   */
+  typedef std::function<void()> callback_t;
+  /**
+   * Calls the callback of an expired timer, for example by pushing it
+   * into a thread pool.
+   */
+  typedef std::function<void(callback_t&&)> executor_t;
+
+  /**
+   * Number of slots per level, as bits.
+   */
+  static const unsigned SLOT_BITS = 6;
+  /**
+   * Number of slots per level.
+   */
+  static const unsigned SLOTS = 1 << SLOT_BITS;
+  /**
+   * Number of levels.  With a tick of 1 ms the finest level spans
+   * 64 ms and the coarsest one about 795 days.  Timers beyond it are
+   * parked in the coarsest level.
+   */
+  static const unsigned LEVELS = 6;
+
+  /**
+   * Constructs an empty wheel, its time starts now.
+   *
+   * @param tick_ms Resolution in milliseconds, greater than `0`.
+   *                Timers never expire before their delay, but up to
+   *                one tick later.
+   */
+  explicit TimerWheel(unsigned tick_ms = 1);
+  /**
+   * Stops the background thread, pending timers will be dropped
+   * without calling them.
+   */
+  virtual ~TimerWheel();
+
+  /**
+   * Call the callbacks via `executor` instead of the polling thread.
+   *
+   * @param executor The executor, or `nullptr` to call the callbacks
+   *                 in the polling thread
+   */
+  virtual void set_executor(const executor_t& executor);
+
+  /**
+   * Adds a timer.
+   *
+   * @param delay_ms Milliseconds from now, rounded up to ticks
+   * @param callback Called once on expiry
+   * @return Handle to cancel the timer
+   * @exception ::libathome_common::Error will be thrown if `callback`
+   *            is empty or out of memory
+   */
+  virtual handle_t add(uint64_t delay_ms, callback_t callback)
+    noexcept(false);
+  /**
+   * Cancels a timer.
+   *
+   * @param handle Result of ::libathome_common::TimerWheel::add()
+   * @return `false` if the timer did already expire or was canceled
+   */
+  virtual bool cancel(handle_t handle);
+  /**
+   * Returns the number of pending timers.
+   *
+   * @return Timers which were neither expired nor canceled
+   */
+  virtual size_t get_size() const;
+
+  /**
+   * Advances the wheel to now and calls the expired callbacks.
+   *
+   * Exceptions of callbacks will be logged and ignored, so one
+   * failing callback doesn't drop the others.
+   *
+   * @return Number of expired timers
+   */
+  virtual size_t poll();
+  /**
+   * Milliseconds until the next
+   * ::libathome_common::TimerWheel::poll() may expire a timer.
+   *
+   * @return `0` if a timer is expired, `UINT64_MAX` if no timers are
+   *         pending
+   */
+  virtual uint64_t get_next_ms() const;
+
+  /**
+   * Polls in a background thread, which sleeps until the next timer
+   * is due.
+   *
+   * Does nothing if already started.
+   */
+  virtual void start();
+  /**
+   * Stops the background thread.
+   *
+   * Pending timers stay, does nothing if not started.
+   */
+  virtual void stop();
+
+private:
+  /** End of a list, also for the free list  */
+  static const uint32_t _NIL = UINT32_MAX;
+  /** Expiry of the timers beyond the coarsest level  */
+  static const uint64_t _NEVER = UINT64_MAX;
+
+  typedef struct {
+    /** Tick to expire, free timers have none  */
+    uint64_t expiry;
+    uint32_t prev;
+    uint32_t next;
+    /** Incremented on every reuse, part of the handle  */
+    uint32_t generation;
+    /** `level * SLOTS + slot`, or `_NIL` if free  */
+    uint32_t slot;
+    callback_t callback;
+  } entry_t;
+
+  uint64_t tick_ns;
+  /** MonotonicClock of tick `0`  */
+  uint64_t origin_ns;
+
+  mutable std::mutex timers_mutex;
+  /** All ticks up to it are processed  */
+  uint64_t current;
+  std::vector<entry_t> entries;
+  /** First unused entry, linked via `next`  */
+  uint32_t free_first;
+  size_t size;
+  /** First timer per slot  */
+  uint32_t heads[LEVELS * SLOTS];
+  /** Bit per non-empty slot, per level  */
+  uint64_t occupied[LEVELS];
+
+  executor_t executor;
+
+  std::thread poller;
+  std::condition_variable poller_cond;
+  bool poller_stop;
+  /** Tick the poller sleeps until, earlier timers must wake it  */
+  uint64_t poller_wake;
+
+  uint64_t _now_tick() const;
+  void _link(uint32_t index);
+  void _unlink(uint32_t index);
+  uint64_t _next_event() const;
+  void _advance(uint64_t target, std::vector<callback_t>& expired);
+  void _poller_main();
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+}; /* class TimerWheel  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_TIMERWHEEL_H__  */
@@ -0,0 +1,97 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "libathome-common/TimestampCache.hpp"
+#include "libathome-common/Error.hpp"
+
+#include <cerrno>
+
+
+libathome_common::TimestampCache::
+TimestampCache(RealtimeClock::timezone_t timezone,
+  const std::string& strftime_fmt)
+  :timezone(timezone), strftime_fmt(strftime_fmt), cached_second(-1),
+   cached_len(0)
+{
+  subsec_t subsec;
+  size_t length, found, pos = 0;
+  while (std::string::npos != (found = RealtimeClock::find_subseconds(
+           this->strftime_fmt.substr(pos), subsec.digits, length))) {
+    pos += found;
+
+    subsec.strftime_prefix = this->strftime_fmt.substr(0, pos);
+    subsec.cached_pos = 0;
+    this->subsecs.push_back(subsec);
+
+    pos += length;
+  }
+}
+
+libathome_common::TimestampCache::
+~TimestampCache()
+{
+}
+
+/* ***************************************************************  */
+
+void libathome_common::TimestampCache::
+_refresh(::time_t second) noexcept(false)
+{
+  RealtimeClock rtc(this->timezone, second, 0);
+
+  std::string result = rtc.to_string(this->strftime_fmt);
+  if (result.length() >= STRING_LEN) {
+    throw Err("Formatted timestamp of '%s' is too long!",
+              this->strftime_fmt.c_str());
+  }
+
+  /* All subseconds are zero now, we need their positions  */
+  for (subsec_t& subsec: this->subsecs) {
+    subsec.cached_pos = subsec.strftime_prefix.empty()
+      ? 0: rtc.to_string(subsec.strftime_prefix).length();
+  }
+
+  ::memcpy(this->cached, result.c_str(), result.length() + 1);
+  this->cached_len = result.length();
+  this->cached_second = second;
+}
+
+size_t libathome_common::TimestampCache::
+format(char* buf, size_t size) noexcept(false)
+{
+  ::timespec now;
+  if (0 != ::clock_gettime(CLOCK_REALTIME, &now)) {
+    throw Err("Could not fetch time from system RTC: %s!",
+              ::strerror(errno));
+  }
+
+  if (now.tv_sec != this->cached_second) this->_refresh(now.tv_sec);
+
+  if (this->cached_len >= size) {
+    throw Err("Buffer of size %lu too small for timestamp '%s'!",
+              (unsigned long) size, this->cached);
+  }
+
+  ::memcpy(buf, this->cached, this->cached_len + 1);
+  for (const subsec_t& subsec: this->subsecs) {
+    RealtimeClock::write_subseconds(
+      buf + subsec.cached_pos, now.tv_nsec, subsec.digits);
+  }
+
+  return this->cached_len;
+}
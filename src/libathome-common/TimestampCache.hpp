@@ -0,0 +1,106 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LIBATHOME_COMMON_TIMESTAMPCACHE_H__
+#define LIBATHOME_COMMON_TIMESTAMPCACHE_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::TimestampCache.
+ */
+
+#include "libathome-common/Common.hpp"
+#include "libathome-common/RealtimeClock.hpp"
+
+#include <vector>
+
+namespace libathome_common
+{
+
+/**
+ * Formats the current time, but only once per second.
+ *
+ * Formatting with ::libathome_common::RealtimeClock costs a
+ * `localtime_r()`, which may take a global lock and read the
+ * timezone database, plus a `strftime()`.  This class caches the
+ * formatted string of the current second.  Within the same second
+ * just the fraction of the second (`%3N`, `%6N`, `%N`, see
+ * ::libathome_common::RealtimeClock::to_string()) will be spliced
+ * into a copy of the cached string.
+ *
+ * Every fraction of the second in the format string will be
+ * updated.  An instance is NOT thread-safe, use one instance per
+ * thread.
+ */
+class TimestampCache
+{
+public:
+
+  /**
+   * Nothing will be formatted until
+   * ::libathome_common::TimestampCache::format() is called.
+   *
+   * @param timezone The timezone which should be used
+   * @param strftime_fmt The format string, see
+   *                     ::libathome_common::RealtimeClock::to_string()
+   */
+  explicit TimestampCache(RealtimeClock::timezone_t timezone,
+    const std::string& strftime_fmt);
+  /**
+   * Default destructor.
+   */
+  virtual ~TimestampCache();
+
+  /**
+   * Format the current time into `buf`.
+   *
+   * @param buf Output, will be terminated with `'\0'`
+   * @param size Size of `buf` in bytes
+   * @return Length of the formatted string, without `'\0'`
+   * @exception ::libathome_common::Error will be thrown if the time
+   *            could not be fetched or formatted, or `buf` is too
+   *            small
+   */
+  size_t format(char* buf, size_t size) noexcept(false);
+
+private:
+  RealtimeClock::timezone_t timezone;
+  std::string strftime_fmt;
+
+  /** A fraction of the second in `strftime_fmt`  */
+  typedef struct {
+    /** Part of `strftime_fmt` before it  */
+    std::string strftime_prefix;
+    int digits;
+    /** Position in `cached`  */
+    size_t cached_pos;
+  } subsec_t;
+
+  /** Empty if `strftime_fmt` has no fraction of the second  */
+  std::vector<subsec_t> subsecs;
+
+  /** `-1` if nothing is cached yet  */
+  ::time_t cached_second;
+  string_t cached;
+  size_t cached_len;
+
+  void _refresh(::time_t second) noexcept(false);
+
+}; /* class TimestampCache  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_TIMESTAMPCACHE_H__  */
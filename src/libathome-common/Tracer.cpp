@@ -0,0 +1,212 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "libathome-common/Tracer.hpp"
+#include "libathome-common/Error.hpp"
+#include "libathome-common/File.hpp"
+
+#include <new>
+#include <cinttypes>
+#include <vector>
+#include <unistd.h>
+
+
+thread_local libathome_common::Tracer::ring_t*
+libathome_common::Tracer::_thread_ring = NULL;
+
+libathome_common::Tracer::ring_t*
+libathome_common::Tracer::_rings = NULL;
+
+std::mutex
+libathome_common::Tracer::_rings_mutex;
+
+uint32_t
+libathome_common::Tracer::_thread_next = 0;
+
+/* ***************************************************************  */
+
+const char* libathome_common::Tracer::
+to_string(Tracer::phase_t phase)
+{
+  switch (phase) {
+  case begin_e: return "begin";
+  case end_e: return "end";
+  case instant_e: return "instant";
+  }
+
+  return "<not implemented!>";
+}
+
+/* ***************************************************************  */
+
+libathome_common::Tracer::detach_s::
+~detach_s()
+{
+  std::lock_guard<std::mutex> lock(Tracer::_rings_mutex);
+
+  this->ring->attached = false;
+  Tracer::_thread_ring = NULL;
+}
+
+libathome_common::Tracer::ring_t* libathome_common::Tracer::
+_attach()
+{
+  /* DETACH will be destructed on thread exit.  Events traced by
+   * destructors of other thread-locals after that get lost.
+   */
+  static thread_local bool attached_once = false;
+  if (attached_once) return NULL;
+
+  std::lock_guard<std::mutex> lock(Tracer::_rings_mutex);
+
+  ring_t* ring = Tracer::_rings;
+  while (ring != NULL && ring->attached) ring = ring->next;
+
+  if (ring == NULL) {
+    ring = new (std::nothrow) ring_t;
+    if (ring == NULL) return NULL;
+
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+    ring->next = Tracer::_rings;
+    Tracer::_rings = ring;
+  }
+
+  ring->thread_id = ++Tracer::_thread_next;
+  ring->attached = true;
+
+  static thread_local detach_t detach;
+  detach.ring = ring;
+  attached_once = true;
+
+  Tracer::_thread_ring = ring;
+  return ring;
+}
+
+/* ***************************************************************  */
+
+static void
+_json_append(std::string& out, const char* str)
+{
+  for (; *str != '\0'; str++) {
+    if (*str == '"' || *str == '\\') {
+      out += '\\';
+      out += *str;
+    } else if ((unsigned char) *str < 0x20) {
+      char buf[8];
+      ::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char) *str);
+      out += buf;
+    } else {
+      out += *str;
+    }
+  }
+}
+
+size_t libathome_common::Tracer::
+dump(const std::string& path, const std::string& filename)
+  noexcept(false)
+{
+  File out(path, filename, true);
+  out.open(File::access_t::write_e);
+
+#ifndef OSWIN
+  long pid = ::getpid();
+#else /* ifndef OSWIN  */
+  long pid = ::_getpid();
+#endif /* ifndef OSWIN  */
+
+  std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  /* Thread IDs which got a name already  */
+  std::vector<bool> named;
+  size_t result = 0;
+  std::vector<event_t> events;
+  char buf[STRING_LEN];
+
+  std::lock_guard<std::mutex> lock(Tracer::_rings_mutex);
+
+  for (ring_t* ring = Tracer::_rings; ring != NULL; ring = ring->next) {
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t begin = ring->tail.load(std::memory_order_relaxed);
+    if (head - begin > Tracer::RING_EVENTS)
+      begin = head - Tracer::RING_EVENTS;
+
+    events.clear();
+    for (uint64_t i=begin; i<head; i++)
+      events.push_back(ring->events[i & (Tracer::RING_EVENTS - 1)]);
+
+    /* Skip the events which were overwritten while copying  */
+    uint64_t head_after = ring->head.load(std::memory_order_acquire);
+    size_t skip = 0;
+    if (head_after - begin > Tracer::RING_EVENTS) {
+      skip = head_after - begin - Tracer::RING_EVENTS;
+      if (skip > events.size()) skip = events.size();
+    }
+    if (skip == events.size()) continue;
+
+    for (size_t i=skip; i<events.size(); i++) {
+      const event_t& event = events[i];
+
+      if (event.thread_id >= named.size())
+        named.resize(event.thread_id + 1, false);
+      if (!named[event.thread_id]) {
+        named[event.thread_id] = true;
+        ::snprintf(buf, sizeof(buf),
+                   "%s\n{\"name\":\"thread_name\",\"ph\":\"M\","
+                   "\"pid\":%ld,\"tid\":%u,\"args\":{\"name\":\"T%u\"}}",
+                   first? "": ",", pid, event.thread_id, event.thread_id);
+        json += buf;
+        first = false;
+      }
+
+      json += ",\n{\"name\":\"";
+      _json_append(json, event.name);
+      ::snprintf(buf, sizeof(buf),
+                 "\",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03u,\"pid\":%ld,"
+                 "\"tid\":%u%s}",
+                 (char) event.phase, event.timestamp / 1000,
+                 (unsigned) (event.timestamp % 1000), pid,
+                 event.thread_id,
+                 event.phase == instant_e? ",\"s\":\"t\"": "");
+      json += buf;
+    }
+    result += events.size() - skip;
+
+    /* Keep the memory bounded with many threads  */
+    out.write(json.c_str(), json.length());
+    json.clear();
+  }
+
+  json += "\n]}\n";
+  out.write(json.c_str(), json.length());
+  out.flush();
+
+  return result;
+}
+
+void libathome_common::Tracer::
+clear()
+{
+  std::lock_guard<std::mutex> lock(Tracer::_rings_mutex);
+
+  for (ring_t* ring = Tracer::_rings; ring != NULL; ring = ring->next) {
+    ring->tail.store(ring->head.load(std::memory_order_acquire),
+                     std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,260 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LIBATHOME_COMMON_TRACER_H__
+#define LIBATHOME_COMMON_TRACER_H__
+/**
+ * @file
+ * @brief Declares the class ::libathome_common::Tracer.
+ */
+
+#include "libathome-common/Common.hpp"
+#include "libathome-common/MonotonicClock.hpp"
+
+#include <atomic>
+#include <mutex>
+
+/* Compile-time tracing
+ */
+
+/// @cond Doxygen_Suppress
+#define _TRACE_CONCAT2(a, b)       a ## b
+#define _TRACE_CONCAT(a, b)        _TRACE_CONCAT2(a, b)
+/// @endcond
+
+#ifdef TRACE
+/**
+ * Traces the rest of the current scope as span `name`.
+ *
+ * Set `TRACE` in `makefile.config.mk` to compile tracing in,
+ * otherwise all `Trace...()` macros will be removed completely by the
+ * compiler, including their arguments.
+ *
+ * **Example**
+ * ```cpp
+ * {
+ *   TraceSpan("verify");
+ *   task.verify();
+ * }
+ * ```
+ *
+ * @param name Name of the span, must be a string literal (or live as
+ *             long as the process)
+ */
+#  define TraceSpan(name) \
+            libathome_common::TraceScope \
+              _TRACE_CONCAT(_trace_scope_, __LINE__)(name)
+/**
+ * Begins span `name` in the current thread, see ::TraceSpan().
+ */
+#  define TraceBegin(name) \
+            libathome_common::Tracer::record(name, \
+              libathome_common::Tracer::begin_e)
+/**
+ * Ends the last span of the current thread, see ::TraceBegin().
+ */
+#  define TraceEnd(name) \
+            libathome_common::Tracer::record(name, \
+              libathome_common::Tracer::end_e)
+/**
+ * Marks a point in time in the current thread, see ::TraceSpan().
+ */
+#  define TraceInstant(name) \
+            libathome_common::Tracer::record(name, \
+              libathome_common::Tracer::instant_e)
+#else /* ifdef TRACE  */
+#  define TraceSpan(name)          do { } while (0)
+#  define TraceBegin(name)         do { } while (0)
+#  define TraceEnd(name)           do { } while (0)
+#  define TraceInstant(name)       do { } while (0)
+#endif /* ifdef TRACE  */
+
+namespace libathome_common
+{
+
+/**
+ * Records spans and instant events of all threads for the Chrome
+ * trace viewer.
+ *
+ * Use the ::TraceSpan(), ::TraceBegin(), ::TraceEnd() and
+ * ::TraceInstant() macros instead of calling
+ * ::libathome_common::Tracer::record() directly, they compile out if
+ * `TRACE` is not set in `makefile.config.mk`.
+ *
+ * Every thread records into its own ring buffer of
+ * ::libathome_common::Tracer::RING_EVENTS events, only the newest
+ * ones are kept.  Recording takes one
+ * ::libathome_common::MonotonicClock::now() and some stores, without
+ * locks or allocation.  So call
+ * ::libathome_common::MonotonicClock::enable_tsc() for the cheapest
+ * timestamps, ::libathome_common::Common does it if `TRACE` is set.
+ *
+ * ::libathome_common::Tracer::dump() writes the rings as JSON, which
+ * can be opened in `chrome://tracing` or https://ui.perfetto.dev.
+ * ::libathome_common::Common dumps to `"log/trace.json"` on
+ * destruction.
+ */
+class Tracer
+{
+public:
+  /**
+   * Type of a recorded event, the `"ph"` field of the trace format.
+   */
+  typedef enum {
+    begin_e = 'B',   ///< Begin of a span
+    end_e = 'E',     ///< End of the last begun span
+    instant_e = 'i'  ///< Point in time
+  } phase_t;
+
+  /**
+   * Convert a ::libathome_common::Tracer::phase_t to string.
+   *
+   * @param phase The phase to convert
+   * @return The string which names the phase. `static` allocated,
+   *         need NOT to be `free()`d.
+   */
+  static const char* to_string(Tracer::phase_t phase);
+
+  /**
+   * Events per thread, must be a power of two.
+   */
+  static const size_t RING_EVENTS = 16384;
+
+  /**
+   * Records an event in the ring of the current thread.
+   *
+   * Thread-safe and lock-free.  Allocates only on the first call per
+   * thread.
+   *
+   * @param name Name of the event, must be a string literal (or live
+   *             as long as the process)
+   * @param phase Type of the event
+   */
+  static void record(const char* name, Tracer::phase_t phase)
+  {
+    ring_t* ring = Tracer::_thread_ring;
+    if (ring == NULL && NULL == (ring = Tracer::_attach())) return;
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    event_t& event = ring->events[head & (Tracer::RING_EVENTS - 1)];
+    event.timestamp = MonotonicClock::now();
+    event.name = name;
+    event.phase = phase;
+    event.thread_id = ring->thread_id;
+    ring->head.store(head + 1, std::memory_order_release);
+  }
+
+  /**
+   * Writes the recorded events of all threads as Chrome trace JSON.
+   *
+   * Threads may keep on tracing meanwhile.  Events which were
+   * overwritten during the dump will be skipped.
+   *
+   * @param path Directory of the file, will be created if needed
+   * @param filename Filename of the file
+   * @return Number of written events
+   * @exception ::libathome_common::Error will be thrown if the file
+   *            could not be written
+   */
+  static size_t dump(const std::string& path, const std::string& filename)
+    noexcept(false);
+
+  /**
+   * Drops the recorded events of all threads.
+   *
+   * Events which are recorded meanwhile may survive.
+   */
+  static void clear();
+
+private:
+  typedef struct {
+    uint64_t timestamp;
+    const char* name;
+    Tracer::phase_t phase;
+    /** Per event, a ring keeps the events of exited threads on reuse  */
+    uint32_t thread_id;
+  } event_t;
+
+  typedef struct ring_s {
+    /** Number of recorded events, the next one goes to
+     * `head % RING_EVENTS`  */
+    std::atomic<uint64_t> head;
+    /** Events before it were dropped by
+     * ::libathome_common::Tracer::clear()  */
+    std::atomic<uint64_t> tail;
+    /** Numbered in order of the first event, reused rings get a
+     * new one  */
+    uint32_t thread_id;
+    /** `false` if the thread has exited, can be reused  */
+    bool attached;
+    struct ring_s* next;
+    event_t events[RING_EVENTS];
+  } ring_t;
+
+  /** Constant initialized, so no guard variable in the hot path  */
+  static thread_local ring_t* _thread_ring;
+  /** All rings ever allocated, locked by `_rings_mutex`  */
+  static ring_t* _rings;
+  static std::mutex _rings_mutex;
+  static uint32_t _thread_next;
+
+  /** Detaches the ring of a thread on its exit  */
+  typedef struct detach_s {
+    ring_t* ring;
+    ~detach_s();
+  } detach_t;
+
+  static ring_t* _attach();
+
+  Tracer() = delete;
+
+}; /* class Tracer  */
+
+/**
+ * Traces the lifetime of a scope as span, use ::TraceSpan().
+ */
+class TraceScope
+{
+public:
+  /**
+   * Begins the span.
+   *
+   * @param name Name of the span, must be a string literal (or live
+   *             as long as the process)
+   */
+  explicit TraceScope(const char* name)
+    :name(name)
+  {
+    Tracer::record(name, Tracer::begin_e);
+  }
+  /**
+   * Ends the span.
+   */
+  ~TraceScope() { Tracer::record(this->name, Tracer::end_e); }
+
+private:
+  const char* name;
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+}; /* class TraceScope  */
+
+} /* namespace libathome_common  */
+#endif /* LIBATHOME_COMMON_TRACER_H__  */
@@ -0,0 +1,125 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file
+ * @brief Command-line tool `libathome-logdecode`, renders binary log
+ *        files as text.
+ *
+ * ```shell
+ * $> libathome-logdecode [-u|-l] [-t] [-f TIME_FORMAT] [FILE ...]
+ * ```
+ *
+ * Renders log files of ::libathome_common::Logger::binary_e loggers
+ * to `stdout`, in the same format as text log files.  Files which
+ * were compressed during log-rotation can be passed directly.  If no
+ * `FILE` (or `-`) is given, then it reads from `stdin`.
+ *
+ * - `-u`, `-l`: Render timestamps in UTC or local time, instead of
+ *   the timezone of the logger
+ * - `-t`: Also render the thread ID of every message
+ * - `-f TIME_FORMAT`: Format of the timestamps, see
+ *   ::libathome_common::RealtimeClock::to_string()
+ */
+
+#include <libathome-common.hpp>
+
+#include <zlib.h>
+#include <unistd.h>
+
+using namespace ::libathome_common;
+
+
+static void
+usage(const char* argv0)
+{
+  ::fprintf(stderr,
+    "Usage: %s [-u|-l] [-t] [-f TIME_FORMAT] [FILE ...]\n"
+    "Renders binary log files of lib@home as text to stdout.\n",
+    argv0);
+}
+
+static std::string
+read_all(const char* filename) noexcept(false)
+{
+  /* GZOPEN reads uncompressed files too  */
+  ::gzFile in = 0 == ::strcmp(filename, "-")
+    ? ::gzdopen(::dup(::fileno(stdin)), "rb")
+    : ::gzopen(filename, "rb");
+  if (in == NULL)
+    throw Err("Could not open file '%s': %s!", filename, ::strerror(errno));
+
+  std::string data;
+  char buf[64*1024];
+  int len;
+  while (0 < (len = ::gzread(in, buf, sizeof(buf)))) data.append(buf, len);
+
+  bool iserror = len < 0;
+  ::gzclose(in);
+  if (iserror) throw Err("Could not read file '%s'!", filename);
+
+  return data;
+}
+
+int
+main(int argc, char** argv)
+{
+  LogBinary decoder;
+  std::vector<const char*> filenames;
+
+  for (int i=1; i<argc; i++) {
+    if (0 == ::strcmp(argv[i], "-u")) {
+      decoder.set_timezone(RealtimeClock::utc_e);
+    } else if (0 == ::strcmp(argv[i], "-l")) {
+      decoder.set_timezone(RealtimeClock::local_e);
+    } else if (0 == ::strcmp(argv[i], "-t")) {
+      decoder.set_print_thread(true);
+    } else if (0 == ::strcmp(argv[i], "-f") && i+1 < argc) {
+      decoder.set_time_format(argv[++i]);
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      filenames.push_back(argv[i]);
+    }
+  }
+  if (filenames.empty()) filenames.push_back("-");
+
+  int result = 0;
+  try {
+    File out(stdout, "<stdout>");
+    out.open(File::access_t::append_e);
+
+    for (const char* filename: filenames) {
+      try {
+        decoder.decode(read_all(filename), out);
+      } catch (Error& e) {
+        out.flush();
+        ::fprintf(stderr, "ERROR: %s: %s\n", filename, e.what());
+        result = 1;
+      }
+    }
+
+    out.flush();
+  } catch (Error& e) {
+    ::fprintf(stderr, "ERROR: %s\n", e.what());
+    return 1;
+  }
+
+  return result;
+}
@@ -0,0 +1,217 @@
+/* lib@home, framework to develop distributed calculations.
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file
+ * @brief Command-line tool `libathome-logstress`, multithreaded stress
+ *        test of ::libathome_common::Logger.
+ *
+ * ```shell
+ * $> libathome-logstress [MESSAGES_PER_THREAD]
+ * ```
+ *
+ * Logs from ::THREADS threads at once into text and binary log files,
+ * in synchronous and asynchronous mode, while another thread changes
+ * the log-level and the time format.  Then it checks that every
+ * message was written exactly once as a complete, non-interleaved
+ * line.  Exits with `0` on success.
+ *
+ * Build it with `SANITIZE := thread` in `makefile.config.mk` to find
+ * data races, see target `$> make stress`.
+ */
+
+#include <libathome-common.hpp>
+
+#include <thread>
+#include <cinttypes>
+
+using namespace ::libathome_common;
+
+
+/** Number of logging threads  */
+static const unsigned THREADS = 8;
+/** Every N-th message is longer than a ring buffer record  */
+static const unsigned LONG_EVERY = 64;
+/** Directory of the log files, will be removed afterwards  */
+static const char* STRESS_PATH = "log-stress";
+static const char* STRESS_FILE = "stress.log";
+
+static std::string
+read_all(const std::string& path, const std::string& filename)
+  noexcept(false)
+{
+  File in(path, filename, true);
+  in.open(File::access_t::read_e);
+  File::span_t content = in.map();
+
+  return std::string(content.data, content.length);
+}
+
+static void
+remove_all(const std::string& path) noexcept(false)
+{
+  Result<std::vector<std::string>> names
+    = Filesystem::list(path, std::nothrow);
+  if (!names) return;
+
+  for (const std::string& name: names.get())
+    Filesystem::remove(path + Filesystem::PATH_SEPERATOR + name);
+  Filesystem::remove(path);
+  Filesystem::forget_dir(path);
+}
+
+static void
+log_messages(Logger& logger, unsigned thread, unsigned count)
+{
+  std::string padding(LogRingbuffer::RECORD_LEN, 'x');
+
+  for (unsigned i=0; i<count; i++) {
+    logger.info("stress thread=%u message=%u padding=%s", thread, i,
+                i % LONG_EVERY == 0? padding.c_str(): "");
+  }
+}
+
+static void
+change_settings(Logger& logger, const std::atomic<bool>& done)
+{
+  /* Both log-levels pass the messages of LOG_MESSAGES()  */
+  for (unsigned i=0; !done.load(); i++) {
+    logger.set_loglevel(i % 2 == 0
+      ? Logger::loglevel_t::debug_e: Logger::loglevel_t::all_e);
+    logger.set_time_format(i % 2 == 0
+      ? "[%H:%M:%S]": "[%Y-%m-%d %H:%M:%S.%3N]");
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * Returns an empty string if `text` contains every message exactly
+ * once, otherwise the first error.
+ */
+static std::string
+check(const std::string& text, unsigned count)
+{
+  std::vector<std::vector<bool>> seen(
+    THREADS, std::vector<bool>(count, false));
+  uint64_t found = 0;
+
+  size_t pos = 0;
+  while (pos < text.length()) {
+    size_t end = text.find('\n', pos);
+    if (end == std::string::npos) return "Last line is truncated";
+    std::string line = text.substr(pos, end - pos);
+    pos = end + 1;
+
+    size_t msg = line.find(" info: stress ");
+    if (msg == std::string::npos) continue;
+    if (line.find(" info: ", msg + 1) != std::string::npos)
+      return "Interleaved line: " + line;
+
+    unsigned thread, i;
+    int padding_pos = -1;
+    if (2 != ::sscanf(line.c_str() + msg,
+                      " info: stress thread=%u message=%u padding=%n",
+                      &thread, &i, &padding_pos)
+        || padding_pos < 0 || thread >= THREADS || i >= count)
+      return "Malformed line: " + line;
+
+    size_t padding = line.length() - msg - padding_pos;
+    if (padding != (i % LONG_EVERY == 0? LogRingbuffer::RECORD_LEN: 0))
+      return "Truncated line: " + line;
+    if (seen[thread][i]) return "Duplicated line: " + line;
+
+    seen[thread][i] = true;
+    found++;
+  }
+
+  if (found != (uint64_t) THREADS * count) {
+    return "Found " + std::to_string(found) + " of "
+      + std::to_string((uint64_t) THREADS * count) + " messages";
+  }
+
+  return "";
+}
+
+static bool
+run(Logger::format_t format, bool async, unsigned count) noexcept(false)
+{
+  remove_all(STRESS_PATH);
+
+  MonotonicClock clock;
+  {
+    Logger logger(Logger::loglevel_t::all_e, RealtimeClock::utc_e,
+                  STRESS_PATH, STRESS_FILE, 0, format);
+    /* Blocking, dropped messages would fail the check  */
+    if (async) logger.async_start(1024, LogRingbuffer::block_e);
+
+    std::atomic<bool> done(false);
+    std::thread settings(change_settings, std::ref(logger),
+                         std::cref(done));
+
+    std::vector<std::thread> threads;
+    for (unsigned t=0; t<THREADS; t++)
+      threads.emplace_back(log_messages, std::ref(logger), t, count);
+    for (std::thread& thread: threads) thread.join();
+
+    done.store(true);
+    settings.join();
+  }
+  double seconds = clock.get_elapsed() / 1e9;
+
+  std::string text = read_all(STRESS_PATH, STRESS_FILE);
+  if (format == Logger::binary_e) {
+    File out(STRESS_PATH, "decoded.log", true);
+    out.open(File::access_t::write_e);
+    LogBinary().decode(text, out);
+    out.close();
+
+    text = read_all(STRESS_PATH, "decoded.log");
+  }
+
+  std::string error = check(text, count);
+  ::printf("%-6s %-5s %8.0f messages/s  %s\n", Logger::to_string(format),
+           async? "async": "sync", THREADS * count / seconds,
+           error.empty()? "OK": error.c_str());
+
+  remove_all(STRESS_PATH);
+  return error.empty();
+}
+
+int
+main(int argc, char** argv)
+{
+  unsigned count = argc > 1? (unsigned) ::strtoul(argv[1], NULL, 10)
+    : 20000;
+  if (count == 0) {
+    ::fprintf(stderr, "Usage: %s [MESSAGES_PER_THREAD]\n", argv[0]);
+    return 2;
+  }
+
+  bool ok = true;
+  try {
+    for (Logger::format_t format: {Logger::text_e, Logger::binary_e}) {
+      ok = run(format, false, count) && ok;
+      ok = run(format, true, count) && ok;
+    }
+  } catch (Error& e) {
+    ::fprintf(stderr, "ERROR: %s\n", e.what());
+    return 1;
+  }
+
+  return ok? 0: 1;
+}
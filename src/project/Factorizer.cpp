@@ -0,0 +1,380 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "Factorizer.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+
+using namespace ::libathome_common;
+
+
+/* Montgomery arithmetic modulo an odd 64-bit N, values are kept as
+ * `x * 2^64 mod N` in [0, N)
+ */
+typedef struct {
+  uint64_t n;
+  /** `n * inverse == 1 (mod 2^64)`  */
+  uint64_t inverse;
+  /** `2^64 mod n`, the 1  */
+  uint64_t one;
+  /** `2^128 mod n`, to convert into Montgomery form  */
+  uint64_t r2;
+} montgomery_t;
+
+static uint64_t
+_inverse(uint64_t n)
+{
+  /* Newton iteration, every step doubles the correct bits, starting
+   * with 5 bits of N itself
+   */
+  uint64_t result = (3 * n) ^ 2;
+  for (int i=0; i<4; i++) result *= 2 - n * result;
+
+  return result;
+}
+
+static void
+_mont_init(montgomery_t& mont, uint64_t n)
+{
+  mont.n = n;
+  mont.inverse = _inverse(n);
+  mont.one = (0 - n) % n;
+  mont.r2 = (uint64_t) (((unsigned __int128) mont.one * mont.one) % n);
+}
+
+static inline uint64_t
+_mont_mul(const montgomery_t& mont, uint64_t a, uint64_t b)
+{
+  /* REDC: the low halves of T and M*N are equal, so only the high
+   * halves need to be subtracted.  No overflow, even for N near 2^64.
+   */
+  unsigned __int128 t = (unsigned __int128) a * b;
+  uint64_t m = (uint64_t) t * mont.inverse;
+  uint64_t mn_high = (uint64_t) (((unsigned __int128) m * mont.n) >> 64);
+  uint64_t t_high = (uint64_t) (t >> 64);
+
+  return t_high >= mn_high? t_high - mn_high: t_high - mn_high + mont.n;
+}
+
+static inline uint64_t
+_mont_add(const montgomery_t& mont, uint64_t a, uint64_t b)
+{
+  return a >= mont.n - b? a - (mont.n - b): a + b;
+}
+
+static inline uint64_t
+_mont_from(const montgomery_t& mont, uint64_t x)
+{
+  return _mont_mul(mont, x % mont.n, mont.r2);
+}
+
+static uint64_t
+_gcd(uint64_t a, uint64_t b)
+{
+  if (a == 0) return b;
+  if (b == 0) return a;
+
+  int shift = ::__builtin_ctzll(a | b);
+  a >>= ::__builtin_ctzll(a);
+  do {
+    b >>= ::__builtin_ctzll(b);
+    if (a > b) std::swap(a, b);
+    b -= a;
+  } while (b != 0);
+
+  return a << shift;
+}
+
+/* ***************************************************************  */
+
+const Factorizer::table_t& Factorizer::
+_table()
+{
+  /* Built on first use, thread-safe by C++11  */
+  static table_t table = []() {
+    table_t result;
+    std::vector<bool> composite(TRIAL_LIMIT, false);
+
+    result.count = 0;
+    for (uint32_t p=3; p<TRIAL_LIMIT; p+=2) {
+      if (composite[p]) continue;
+      for (uint32_t k=p*p; k<TRIAL_LIMIT; k+=2*p) composite[k] = true;
+
+      /* N * INVERSE is N / P for multiples of P, which are exactly the
+       * values up to LIMIT
+       */
+      result.inverses[result.count] = _inverse(p);
+      result.limits[result.count] = UINT64_MAX / p;
+      result.primes[result.count] = p;
+      result.count++;
+    }
+
+    /* Pad the last block, N * 1 <= 0 never matches  */
+    while (result.count % TRIAL_BLOCK != 0) {
+      result.inverses[result.count] = 1;
+      result.limits[result.count] = 0;
+      result.primes[result.count] = UINT32_MAX;
+      result.count++;
+    }
+
+    return result;
+  }();
+
+  return table;
+}
+
+uint64_t Factorizer::
+_trial(uint64_t n, std::vector<uint64_t>& factors)
+{
+  int twos = ::__builtin_ctzll(n);
+  factors.insert(factors.end(), twos, 2);
+  n >>= twos;
+
+  const table_t& table = Factorizer::_table();
+  for (size_t i=0; i<table.count; i+=TRIAL_BLOCK) {
+    /* The rest is 1 or prime  */
+    if ((uint64_t) table.primes[i] * table.primes[i] > n) {
+      if (n > 1) factors.push_back(n);
+      return 1;
+    }
+
+    /* Usually no hit, so test the whole block without branches  */
+    unsigned hits = 0;
+    for (unsigned j=0; j<TRIAL_BLOCK; j++) {
+      hits |= (unsigned) (n * table.inverses[i + j] <= table.limits[i + j])
+        << j;
+    }
+
+    while (hits != 0) {
+      unsigned j = ::__builtin_ctz(hits);
+      hits &= hits - 1;
+
+      do {
+        factors.push_back(table.primes[i + j]);
+        n *= table.inverses[i + j];
+      } while (n * table.inverses[i + j] <= table.limits[i + j]);
+    }
+  }
+
+  return n;
+}
+
+bool Factorizer::
+is_prime(uint64_t n)
+{
+  if (n < 2) return false;
+  if (n % 2 == 0) return n == 2;
+
+  /* Small primes and composites with a small factor  */
+  const table_t& table = Factorizer::_table();
+  for (size_t i=0; i<64; i++) {
+    uint64_t p = table.primes[i];
+    if (n == p) return true;
+    if (n * table.inverses[i] <= table.limits[i]) return false;
+  }
+  if (n < (uint64_t) table.primes[64] * table.primes[64]) return true;
+
+  montgomery_t mont;
+  _mont_init(mont, n);
+  uint64_t minus_one = mont.n - mont.one;
+
+  int s = ::__builtin_ctzll(n - 1);
+  uint64_t d = (n - 1) >> s;
+
+  /* Deterministic for all N < 2^64, by Jim Sinclair  */
+  static const uint64_t bases[] = {
+    2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+  for (uint64_t base: bases) {
+    uint64_t a = _mont_from(mont, base);
+    if (a == 0) continue;
+
+    uint64_t x = mont.one;
+    for (uint64_t e=d; e!=0; e>>=1) {
+      if (e & 1) x = _mont_mul(mont, x, a);
+      a = _mont_mul(mont, a, a);
+    }
+    if (x == mont.one || x == minus_one) continue;
+
+    int r = 1;
+    for (; r<s; r++) {
+      x = _mont_mul(mont, x, x);
+      if (x == minus_one) break;
+    }
+    if (r == s) return false;
+  }
+
+  return true;
+}
+
+uint64_t Factorizer::
+_rho(uint64_t n)
+{
+  /* Brent's variant with batched GCDs, M steps per GCD  */
+  static const uint64_t M = 128;
+
+  montgomery_t mont;
+  _mont_init(mont, n);
+
+  for (uint64_t c=1; ; c++) {
+    uint64_t c_mont = _mont_from(mont, c);
+    uint64_t y = _mont_from(mont, 2);
+    uint64_t x = y, ys = y;
+    uint64_t q = mont.one;
+    uint64_t g = 1;
+
+    for (uint64_t r=1; g == 1; r*=2) {
+      x = y;
+      for (uint64_t i=0; i<r; i++)
+        y = _mont_add(mont, _mont_mul(mont, y, y), c_mont);
+
+      for (uint64_t k=0; k<r && g == 1; k+=M) {
+        ys = y;
+        uint64_t steps = std::min(M, r - k);
+        for (uint64_t i=0; i<steps; i++) {
+          y = _mont_add(mont, _mont_mul(mont, y, y), c_mont);
+          q = _mont_mul(mont, q, x > y? x - y: y - x);
+        }
+        /* Montgomery form is X * 2^64, which is coprime to N  */
+        g = _gcd(q, n);
+      }
+    }
+
+    /* Overshot, step back one by one  */
+    if (g == n) {
+      do {
+        ys = _mont_add(mont, _mont_mul(mont, ys, ys), c_mont);
+        g = _gcd(x > ys? x - ys: ys - x, n);
+      } while (g == 1);
+    }
+
+    if (g != n) return g;
+  }
+}
+
+void Factorizer::
+_factorize_large(uint64_t n, std::vector<uint64_t>& factors)
+{
+  if (Factorizer::is_prime(n)) {
+    factors.push_back(n);
+    return;
+  }
+
+  uint64_t d = Factorizer::_rho(n);
+  Factorizer::_factorize_large(d, factors);
+  Factorizer::_factorize_large(n / d, factors);
+}
+
+void Factorizer::
+factorize(uint64_t n, std::vector<uint64_t>& factors)
+{
+  if (n < 2) return;
+
+  size_t begin = factors.size();
+  n = Factorizer::_trial(n, factors);
+  if (n == 1) return;
+
+  /* No factor below TRIAL_LIMIT, so it's prime if below its square  */
+  if (n < (uint64_t) TRIAL_LIMIT * TRIAL_LIMIT) {
+    factors.push_back(n);
+    return;
+  }
+
+  Factorizer::_factorize_large(n, factors);
+  std::sort(factors.begin() + begin, factors.end());
+}
+
+void Factorizer::
+factorize_rough(uint64_t n, uint64_t bound, std::vector<uint64_t>& factors)
+{
+  if (bound < Factorizer::TRIAL_LIMIT) {
+    Factorizer::factorize(n, factors);
+    return;
+  }
+
+  if (n < 2) return;
+  if (bound <= UINT32_MAX && n < bound * bound) {
+    factors.push_back(n);
+    return;
+  }
+
+  size_t begin = factors.size();
+  Factorizer::_factorize_large(n, factors);
+  std::sort(factors.begin() + begin, factors.end());
+}
+
+void Factorizer::
+factorize_naive(uint64_t n, std::vector<uint64_t>& factors)
+{
+  if (n < 2) return;
+
+  while (n % 2 == 0) {
+    factors.push_back(2);
+    n /= 2;
+  }
+  for (uint64_t divisor=3; divisor <= n / divisor; divisor += 2) {
+    while (n % divisor == 0) {
+      factors.push_back(divisor);
+      n /= divisor;
+    }
+  }
+  if (n > 1) factors.push_back(n);
+}
+
+/* ***************************************************************  */
+
+void Factorizer::
+benchmark(uint64_t count)
+{
+  static const uint64_t starts[] = {
+    UINT64_C(1000000), UINT64_C(1000000000), UINT64_C(1000000000000),
+    UINT64_C(1000000000000000), UINT64_C(1000000000000000000),
+    UINT64_MAX - 1000000};
+
+  std::vector<uint64_t> factors;
+  for (uint64_t start: starts) {
+    uint64_t end = count > UINT64_MAX - start? UINT64_MAX: start + count;
+    uint64_t checksum = 0;
+
+    MonotonicClock clock;
+    for (uint64_t n=start; n<end; n++) {
+      factors.clear();
+      Factorizer::factorize(n, factors);
+      checksum += factors.back();
+    }
+    double fast_s = clock.get_elapsed() / 1e9;
+
+    /* Naive is hopeless for large numbers, measure one second only  */
+    uint64_t naive_count = 0;
+    clock.restart();
+    for (uint64_t n=start; n<end; n++) {
+      factors.clear();
+      Factorizer::factorize_naive(n, factors);
+      checksum -= factors.back();
+      naive_count++;
+      if (clock.get_elapsed() > 1000000000) break;
+    }
+    double naive_s = clock.get_elapsed() / 1e9;
+
+    Log->info("Factorizer from %" PRIu64 ": %.0f/s, naive %.0f/s (%"
+              PRIu64 " numbers)%s", start, (end - start) / fast_s,
+              naive_count / naive_s, naive_count,
+              naive_count == end - start && checksum != 0
+              ? " MISMATCH!": "");
+  }
+}
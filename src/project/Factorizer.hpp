@@ -0,0 +1,131 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PRIMEATHOME_FACTORIZER_H__
+#define PRIMEATHOME_FACTORIZER_H__
+/**
+ * @file
+ * @brief Declares the class ::Factorizer.
+ */
+
+#include <libathome-client.hpp>
+
+#include <vector>
+
+
+/**
+ * Prime factorization of 64-bit numbers, the kernel of ::PrimeTask.
+ *
+ * ::Factorizer::factorize() works in three stages:
+ *
+ * 1. Trial division by the primes below
+ *    ::Factorizer::TRIAL_LIMIT.  Divisibility is tested by
+ *    multiplying with the modular inverse of the prime, without a
+ *    division and for ::Factorizer::TRIAL_BLOCK primes at once.
+ * 2. A deterministic Miller-Rabin test with 7 bases, which is exact
+ *    for all 64-bit numbers.
+ * 3. Pollard-Brent rho for the composite rest, until all factors are
+ *    prime.
+ *
+ * Stages 2 and 3 calculate with Montgomery multiplication, so there
+ * is no 128-bit division in the inner loops.
+ */
+class Factorizer
+{
+public:
+  /**
+   * Primes below it are found by trial division.
+   */
+  static const uint32_t TRIAL_LIMIT = 1 << 12;
+  /**
+   * Number of primes which are tested at once, without branches.
+   */
+  static const unsigned TRIAL_BLOCK = 8;
+
+  /**
+   * Factorizes `n`.
+   *
+   * Thread-safe.
+   *
+   * @param n The number to factorize
+   * @param factors Output, the prime factors in ascending order will
+   *                be appended.  Nothing for `0` and `1`.
+   */
+  static void factorize(uint64_t n, std::vector<uint64_t>& factors);
+  /**
+   * Factorizes `n` which has no prime factor below `bound`, such like
+   * the rest of a sieve.
+   *
+   * Thread-safe.
+   *
+   * @param n The number to factorize
+   * @param bound All prime factors of `n` are at least `bound`
+   * @param factors Output, the prime factors in ascending order will
+   *                be appended.  Nothing for `1`.
+   */
+  static void factorize_rough(uint64_t n, uint64_t bound,
+    std::vector<uint64_t>& factors);
+  /**
+   * Factorizes `n` by trial division with all odd numbers.
+   *
+   * Simple and slow, to verify and to benchmark
+   * ::Factorizer::factorize().
+   *
+   * @param n The number to factorize
+   * @param factors Output, the prime factors in ascending order will
+   *                be appended.  Nothing for `0` and `1`.
+   */
+  static void factorize_naive(uint64_t n, std::vector<uint64_t>& factors);
+
+  /**
+   * Deterministic primality test.
+   *
+   * @param n The number to test
+   * @return `true` if `n` is prime
+   */
+  static bool is_prime(uint64_t n);
+
+  /**
+   * Logs the factorizations per second of ::Factorizer::factorize()
+   * and ::Factorizer::factorize_naive() for consecutive ranges at
+   * several magnitudes.
+   *
+   * @param count Numbers per range.  The naive factorization stops
+   *              after one second per range.
+   */
+  static void benchmark(uint64_t count);
+
+private:
+  /** Structure of arrays, so a block can be tested vectorized  */
+  typedef struct {
+    size_t count;
+    uint64_t inverses[1024];
+    uint64_t limits[1024];
+    uint32_t primes[1024];
+  } table_t;
+
+  static const table_t& _table();
+  static uint64_t _trial(uint64_t n, std::vector<uint64_t>& factors);
+  static uint64_t _rho(uint64_t n);
+  static void _factorize_large(uint64_t n, std::vector<uint64_t>& factors);
+
+  Factorizer() = delete;
+
+}; /* class Factorizer  */
+
+#endif /* PRIMEATHOME_FACTORIZER_H__  */
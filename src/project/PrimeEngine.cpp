@@ -0,0 +1,66 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "PrimeEngine.hpp"
+
+using namespace ::libathome_common;
+using namespace ::libathome_client;
+
+
+PrimeEngine::
+PrimeEngine(uint64_t range) noexcept(false)
+  /* A range result is large, so upload them in smaller batches  */
+  :Engine("checkpoint", "primeathome.txt", 0, range > 1? 16: 256),
+   range(range < 1? 1: range),
+   results_file("results", range > 1? "primes.bin": "primes.txt", false)
+{
+  /* 0 and 1 have no prime factors  */
+  this->next_number = this->get_checkpoint() < 2? 2: this->get_checkpoint();
+  this->results_file.open(File::access_t::append_e);
+}
+
+PrimeEngine::
+~PrimeEngine()
+{
+}
+
+void PrimeEngine::
+fetch(size_t max, std::vector<Task*>& tasks) noexcept(false)
+{
+  for (size_t i=0; i<max; i++) {
+    /* No more numbers below 2^64  */
+    if (this->next_number > UINT64_MAX - this->range) break;
+
+    if (this->range > 1) {
+      tasks.push_back(new RangeTask(this->next_number, this->range));
+      this->next_number += this->range;
+    } else {
+      tasks.push_back(new PrimeTask(this->next_number++));
+    }
+  }
+}
+
+void PrimeEngine::
+upload(const std::vector<TaskResult*>& results) noexcept(false)
+{
+  this->buffer.clear();
+  for (TaskResult* result: results) result->serialize(this->buffer);
+
+  this->results_file.write(this->buffer.data(), this->buffer.length());
+  this->results_file.flush();
+}
@@ -0,0 +1,72 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PRIMEATHOME_PRIMEENGINE_H__
+#define PRIMEATHOME_PRIMEENGINE_H__
+/**
+ * @file
+ * @brief Declares the class ::PrimeEngine.
+ */
+
+#include "PrimeTask.hpp"
+#include "RangeTask.hpp"
+
+
+/**
+ * Runs ::PrimeTask or ::RangeTask for consecutive numbers.
+ *
+ * There is no server yet, so it hands out the numbers itself,
+ * starting at the checkpoint, and appends the results to
+ * `"results/primes.txt"`, or for ranges in the encoding of
+ * ::RangeResult to `"results/primes.bin"`.  After a crash the results
+ * of the last batch may be appended twice.
+ */
+class PrimeEngine: public libathome_client::Engine
+{
+public:
+  /**
+   * Constructs the engine, continues at the checkpoint.
+   *
+   * @param range Numbers per task, greater than `1` to hand out
+   *              ::RangeTask instead of ::PrimeTask
+   * @exception ::libathome_common::Error will be thrown if
+   *            ::libathome_client::Init was not instanced or the
+   *            checkpoint is corrupt
+   */
+  explicit PrimeEngine(uint64_t range = 1) noexcept(false);
+  /**
+   * Default destructor.
+   */
+  virtual ~PrimeEngine();
+
+protected:
+  virtual void fetch(size_t max,
+    std::vector<libathome_client::Task*>& tasks) noexcept(false) override;
+  virtual void upload(
+    const std::vector<libathome_client::TaskResult*>& results)
+    noexcept(false) override;
+
+private:
+  uint64_t range;
+  uint64_t next_number;
+  libathome_common::File results_file;
+  std::string buffer;
+
+}; /* class PrimeEngine  */
+
+#endif /* PRIMEATHOME_PRIMEENGINE_H__  */
@@ -0,0 +1,54 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "PrimeResult.hpp"
+
+#include <cinttypes>
+
+
+PrimeResult::
+PrimeResult(uint64_t number, std::vector<uint64_t>&& factors)
+  :TaskResult(number), factors(std::move(factors))
+{
+}
+
+PrimeResult::
+~PrimeResult()
+{
+}
+
+const std::vector<uint64_t>& PrimeResult::
+get_factors() const
+{
+  return this->factors;
+}
+
+void PrimeResult::
+serialize(std::string& out) const
+{
+  char buf[24];
+
+  ::snprintf(buf, sizeof(buf), "%" PRIu64 "={", this->get_task_id());
+  out += buf;
+  for (size_t i=0; i<this->factors.size(); i++) {
+    ::snprintf(buf, sizeof(buf), i == 0? "%" PRIu64: ", %" PRIu64,
+               this->factors[i]);
+    out += buf;
+  }
+  out += "}\n";
+}
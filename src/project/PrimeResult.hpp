@@ -0,0 +1,66 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PRIMEATHOME_PRIMERESULT_H__
+#define PRIMEATHOME_PRIMERESULT_H__
+/**
+ * @file
+ * @brief Declares the class ::PrimeResult.
+ */
+
+#include <libathome-client.hpp>
+
+#include <vector>
+
+
+/**
+ * Prime factors of the number of a ::PrimeTask.
+ *
+ * Serialized as `"45={3, 3, 5}\n"`, the server verifies it by
+ * multiplying the factors and testing them for primality.
+ */
+class PrimeResult: public libathome_client::TaskResult
+{
+public:
+  /**
+   * Constructs the result.
+   *
+   * @param number The factorized number, also the task ID
+   * @param factors The prime factors in ascending order
+   */
+  explicit PrimeResult(uint64_t number, std::vector<uint64_t>&& factors);
+  /**
+   * Default destructor.
+   */
+  virtual ~PrimeResult();
+
+  /**
+   * Returns the prime factors.
+   *
+   * @return The prime factors in ascending order
+   */
+  virtual const std::vector<uint64_t>& get_factors() const;
+
+  virtual void serialize(std::string& out) const override;
+
+private:
+  std::vector<uint64_t> factors;
+
+}; /* class PrimeResult  */
+
+#endif /* PRIMEATHOME_PRIMERESULT_H__  */
@@ -0,0 +1,46 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "PrimeTask.hpp"
+#include "Factorizer.hpp"
+
+using namespace ::libathome_common;
+
+
+PrimeTask::
+PrimeTask(uint64_t number)
+  :Task(number)
+{
+}
+
+PrimeTask::
+~PrimeTask()
+{
+}
+
+libathome_client::TaskResult* PrimeTask::
+compute() noexcept(false)
+{
+  uint64_t n = this->get_id();
+  if (n < 2) throw Err("Number %lu has no prime factors!", (unsigned long) n);
+
+  std::vector<uint64_t> factors;
+  Factorizer::factorize(n, factors);
+
+  return new PrimeResult(this->get_id(), std::move(factors));
+}
@@ -0,0 +1,59 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PRIMEATHOME_PRIMETASK_H__
+#define PRIMEATHOME_PRIMETASK_H__
+/**
+ * @file
+ * @brief Declares the class ::PrimeTask.
+ */
+
+#include "PrimeResult.hpp"
+
+
+/**
+ * Task of Prime@home, factorize one number.
+ *
+ * The number is the task ID, so the checkpoint of
+ * ::libathome_client::Engine is the next number to factorize.
+ */
+class PrimeTask: public libathome_client::Task
+{
+public:
+  /**
+   * Constructs the task.
+   *
+   * @param number The number to factorize, greater than `1`
+   */
+  explicit PrimeTask(uint64_t number);
+  /**
+   * Default destructor.
+   */
+  virtual ~PrimeTask();
+
+  /**
+   * Factorizes the number.
+   *
+   * @return A ::PrimeResult
+   */
+  virtual libathome_client::TaskResult* compute() noexcept(false)
+    override;
+
+}; /* class PrimeTask  */
+
+#endif /* PRIMEATHOME_PRIMETASK_H__  */
@@ -0,0 +1,112 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "RangeResult.hpp"
+
+#include <cinttypes>
+
+using namespace ::libathome_common;
+
+
+RangeResult::
+RangeResult(uint64_t first, uint64_t count)
+  :TaskResult(first), count(count), used(0)
+{
+  /* Most numbers need less than 8 bytes  */
+  this->payload.resize(count * 8);
+}
+
+RangeResult::
+~RangeResult()
+{
+}
+
+uint64_t RangeResult::
+get_count() const
+{
+  return this->count;
+}
+
+void RangeResult::
+serialize(std::string& out) const
+{
+  RangeResult::_put_varint(out, this->get_task_id());
+  RangeResult::_put_varint(out, this->count);
+  RangeResult::_put_varint(out, this->used);
+  out.append(this->payload.data(), this->used);
+}
+
+/* ***************************************************************  */
+
+void RangeResult::
+_put_varint(std::string& out, uint64_t value)
+{
+  uint8_t buf[10];
+  out.append((const char*) buf, RangeResult::_encode(buf, value) - buf);
+}
+
+uint64_t RangeResult::
+_get_varint(const char*& pos, const char* end) noexcept(false)
+{
+  uint64_t result = 0;
+
+  for (unsigned shift=0; shift<64; shift+=7) {
+    if (pos >= end) throw Err("Range result is truncated!");
+
+    uint8_t byte = (uint8_t) *pos++;
+    result |= (uint64_t) (byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return result;
+  }
+
+  throw Err("Range result has a varint with more than 64 bits!");
+}
+
+size_t RangeResult::
+decode(const char* data, size_t length, std::string& text) noexcept(false)
+{
+  const char* pos = data;
+  const char* end = data + length;
+
+  uint64_t first = RangeResult::_get_varint(pos, end);
+  uint64_t count = RangeResult::_get_varint(pos, end);
+  uint64_t payload_length = RangeResult::_get_varint(pos, end);
+  if (payload_length > (uint64_t) (end - pos))
+    throw Err("Range result is truncated!");
+  end = pos + payload_length;
+
+  char buf[24];
+  for (uint64_t i=0; i<count; i++) {
+    ::snprintf(buf, sizeof(buf), "%" PRIu64 "={", first + i);
+    text += buf;
+
+    uint64_t factors = RangeResult::_get_varint(pos, end);
+    uint64_t factor = 0;
+    for (uint64_t j=0; j<factors; j++) {
+      factor += RangeResult::_get_varint(pos, end);
+      ::snprintf(buf, sizeof(buf), j == 0? "%" PRIu64: ", %" PRIu64,
+                 factor);
+      text += buf;
+    }
+    text += "}\n";
+  }
+  if (pos != end)
+    throw Err("Range result has %lu bytes behind the last number!",
+              (unsigned long) (end - pos));
+
+  return end - data;
+}
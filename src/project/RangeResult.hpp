@@ -0,0 +1,143 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PRIMEATHOME_RANGERESULT_H__
+#define PRIMEATHOME_RANGERESULT_H__
+/**
+ * @file
+ * @brief Declares the class ::RangeResult.
+ */
+
+#include <libathome-client.hpp>
+
+#include <algorithm>
+
+
+/**
+ * Prime factors of all numbers of a ::RangeTask.
+ *
+ * The numbers are implicit, so only the factors are stored.  All
+ * integers are unsigned LEB128 varints, 7 bits per byte, least
+ * significant first.  A serialized result is
+ *
+ * ```
+ * first count length  (length bytes of factorizations)
+ * ```
+ *
+ * and one factorization per number, starting at `first`, is the
+ * number of factors followed by the differences between consecutive
+ * factors in ascending order, starting at `0`.  So `45={3, 3, 5}` is
+ * stored as the 4 bytes `3 3 0 2`, most numbers need less than 8
+ * bytes.
+ */
+class RangeResult: public libathome_client::TaskResult
+{
+public:
+  /**
+   * Constructs an empty result.
+   *
+   * @param first The first number of the range, also the task ID
+   * @param count The number of numbers of the range
+   */
+  explicit RangeResult(uint64_t first, uint64_t count);
+  /**
+   * Default destructor.
+   */
+  virtual ~RangeResult();
+
+  /**
+   * Appends the factorization of the next number.
+   *
+   * Non-virtual and inline, it's called for every number.
+   *
+   * @param factors The prime factors in ascending order
+   * @param length Number of `factors`
+   */
+  void add(const uint64_t* factors, size_t length)
+  {
+    /* Written in place, appending byte by byte to the std::string is
+     * much slower.  At most 10 bytes per varint.
+     */
+    size_t needed = this->used + 10 * (length + 1);
+    if (needed > this->payload.size())
+      this->payload.resize(std::max(needed, 2 * this->payload.size()));
+
+    uint8_t* begin = (uint8_t*) &this->payload[0];
+    uint8_t* pos = RangeResult::_encode(begin + this->used, length);
+
+    uint64_t previous = 0;
+    for (size_t i=0; i<length; i++) {
+      pos = RangeResult::_encode(pos, factors[i] - previous);
+      previous = factors[i];
+    }
+
+    this->used = pos - begin;
+  }
+
+  /**
+   * Returns the number of numbers of the range.
+   *
+   * @return The number of numbers
+   */
+  virtual uint64_t get_count() const;
+
+  /**
+   * Appends the encoding, see ::RangeResult.
+   *
+   * @param out The result will be appended
+   */
+  virtual void serialize(std::string& out) const override;
+
+  /**
+   * Renders one serialized result as text, in the format of
+   * ::PrimeResult.
+   *
+   * @param data Buffer which begins with a serialized result
+   * @param length Length of `data`
+   * @param text Output, one line per number will be appended
+   * @return Number of bytes of `data` which were decoded
+   * @exception ::libathome_common::Error will be thrown if `data` is
+   *            truncated or corrupt
+   */
+  static size_t decode(const char* data, size_t length,
+    std::string& text) noexcept(false);
+
+private:
+  uint64_t count;
+  /** Size of the buffer PAYLOAD, USED bytes are valid  */
+  std::string payload;
+  size_t used;
+
+  /** Writes at most 10 bytes, returns the position behind them  */
+  static uint8_t* _encode(uint8_t* pos, uint64_t value)
+  {
+    while (value >= 0x80) {
+      *pos++ = (uint8_t) (value | 0x80);
+      value >>= 7;
+    }
+    *pos++ = (uint8_t) value;
+
+    return pos;
+  }
+  static void _put_varint(std::string& out, uint64_t value);
+  static uint64_t _get_varint(const char*& pos, const char* end)
+    noexcept(false);
+
+}; /* class RangeResult  */
+
+#endif /* PRIMEATHOME_RANGERESULT_H__  */
@@ -0,0 +1,209 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "RangeTask.hpp"
+#include "Factorizer.hpp"
+
+#include <algorithm>
+
+using namespace ::libathome_common;
+
+
+static uint64_t
+_inverse(uint64_t n)
+{
+  /* Newton iteration, see Factorizer.cpp  */
+  uint64_t result = (3 * n) ^ 2;
+  for (int i=0; i<4; i++) result *= 2 - n * result;
+
+  return result;
+}
+
+/* ***************************************************************  */
+
+const RangeTask::table_t& RangeTask::
+_table()
+{
+  /* Built on first use, thread-safe by C++11  */
+  static table_t table = []() {
+    table_t result;
+    std::vector<bool> composite(SIEVE_LIMIT + 1, false);
+
+    for (uint32_t p=3; p<=SIEVE_LIMIT; p+=2) {
+      if (composite[p]) continue;
+      for (uint64_t k=(uint64_t) p*p; k<=SIEVE_LIMIT; k+=2*p)
+        composite[k] = true;
+
+      result.primes.push_back(p);
+      result.inverses.push_back(_inverse(p));
+      result.limits.push_back(UINT64_MAX / p);
+    }
+
+    return result;
+  }();
+
+  return table;
+}
+
+/* ***************************************************************  */
+
+RangeTask::
+RangeTask(uint64_t first, uint64_t count) noexcept(false)
+  :Task(first, count)
+{
+  if (first < 2)
+    throw Err("Range starting at %lu contains numbers without prime"
+              " factors!", (unsigned long) first);
+  if (count == 0 || count - 1 > UINT64_MAX - first)
+    throw Err("Range of %lu numbers starting at %lu is invalid!",
+              (unsigned long) count, (unsigned long) first);
+}
+
+RangeTask::
+~RangeTask()
+{
+}
+
+libathome_client::TaskResult* RangeTask::
+compute() noexcept(false)
+{
+  const table_t& table = RangeTask::_table();
+  uint64_t first = this->get_id();
+  uint64_t count = this->get_span();
+  uint64_t last = first + (count - 1);
+
+  /* Only primes up to sqrt(LAST) are needed.  If less than all were
+   * sieved, then every rest is 1 or prime.
+   */
+  size_t sieved = std::partition_point(
+    table.primes.begin(), table.primes.end(),
+    [last](uint32_t p) { return (uint64_t) p * p <= last; })
+    - table.primes.begin();
+  bool complete = sieved < table.primes.size();
+
+  /* Offset of the next multiple of every prime, relative to the
+   * current segment.  The only division per prime and range.
+   */
+  std::vector<uint32_t> offsets(sieved);
+  for (size_t k=0; k<sieved; k++) {
+    uint32_t p = table.primes[k];
+    offsets[k] = (p - first % p) % p;
+  }
+
+  std::vector<number_t> numbers(SEGMENT_SIZE);
+  /* Factors which don't fit into number_t::found  */
+  std::vector<entry_t> entries;
+  std::vector<uint64_t> rest;
+
+  RangeResult* result = new RangeResult(first, count);
+  try {
+    for (uint64_t base=0; base<count; base+=SEGMENT_SIZE) {
+      uint32_t length = (uint32_t) std::min<uint64_t>(SEGMENT_SIZE,
+                                                      count - base);
+
+      /* Factor 2 is cheaper by counting trailing zeros  */
+      for (uint32_t i=0; i<length; i++) {
+        uint64_t n = first + base + i;
+        unsigned zeros = __builtin_ctzll(n);
+        numbers[i].residual = n >> zeros;
+        numbers[i].twos = (uint8_t) zeros;
+        numbers[i].count = 0;
+        numbers[i].overflow = NONE;
+      }
+
+      entries.clear();
+      for (size_t k=0; k<sieved; k++) {
+        uint32_t j = offsets[k];
+        /* Most large primes don't hit the segment  */
+        if (j >= length) {
+          offsets[k] = j - length;
+          continue;
+        }
+
+        uint32_t p = table.primes[k];
+        uint64_t inverse = table.inverses[k];
+        uint64_t limit = table.limits[k];
+        do {
+          number_t& number = numbers[j];
+
+          /* Multiplying by the inverse divides exactly  */
+          uint64_t r = number.residual;
+          uint32_t exponent = 0;
+          do {
+            r *= inverse;
+            exponent++;
+          } while (r * inverse <= limit);
+          number.residual = r;
+
+          uint32_t found = p << 6 | exponent;
+          if (number.count < FOUND_MAX) {
+            number.found[number.count++] = found;
+          } else {
+            entries.push_back({found, number.overflow});
+            number.overflow = (uint32_t) entries.size() - 1;
+          }
+
+          j += p;
+        } while (j < length);
+        offsets[k] = j - length;
+      }
+
+      for (uint32_t i=0; i<length; i++) {
+        const number_t& number = numbers[i];
+
+        /* Numbers below 2^64 have at most 63 prime factors  */
+        uint64_t factors[64];
+        size_t n_factors = 0;
+        while (n_factors < number.twos) factors[n_factors++] = 2;
+
+        for (unsigned f=0; f<number.count; f++) {
+          uint32_t exponent = number.found[f] & 0x3f;
+          for (uint32_t e=0; e<exponent; e++)
+            factors[n_factors++] = number.found[f] >> 6;
+        }
+
+        /* The overflow is linked in descending order  */
+        if (number.overflow != NONE) {
+          size_t begin = n_factors;
+          for (uint32_t o=number.overflow; o!=NONE; o=entries[o].previous) {
+            uint32_t exponent = entries[o].found & 0x3f;
+            for (uint32_t e=0; e<exponent; e++)
+              factors[n_factors++] = entries[o].found >> 6;
+          }
+          std::reverse(factors + begin, factors + n_factors);
+        }
+
+        uint64_t r = number.residual;
+        if (r > 1 && complete) {
+          factors[n_factors++] = r;
+        } else if (r > 1) {
+          rest.clear();
+          Factorizer::factorize_rough(r, SIEVE_LIMIT, rest);
+          for (uint64_t factor: rest) factors[n_factors++] = factor;
+        }
+
+        result->add(factors, n_factors);
+      }
+    }
+  } catch (...) {
+    delete result;
+    throw;
+  }
+
+  return result;
+}
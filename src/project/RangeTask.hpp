@@ -0,0 +1,125 @@
+/* Prime@home, create together a prime-factor database using lib@home :)
+ * Copyright (C) 2020  Dirk "YouDirk" Lehmann
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PRIMEATHOME_RANGETASK_H__
+#define PRIMEATHOME_RANGETASK_H__
+/**
+ * @file
+ * @brief Declares the class ::RangeTask.
+ */
+
+#include "RangeResult.hpp"
+
+#include <vector>
+
+
+/**
+ * Task of Prime@home, factorize all numbers of `[first, first+count)`.
+ *
+ * Consecutive numbers share their small prime factors, so instead of
+ * factorizing them one by one, a segmented sieve walks with every
+ * prime `p` over its multiples in the range and divides them out.
+ * Per number this costs about `ln ln sqrt(n)` divisions.
+ *
+ * The range is sieved in segments of
+ * ::RangeTask::SEGMENT_SIZE numbers, so the per-number state of a
+ * segment stays in the L2 cache.  Primes up to ::RangeTask::SIEVE_LIMIT
+ * are sieved, a rest above its square is factorized by
+ * ::Factorizer::factorize_rough().  Tasks of the same engine run in
+ * parallel on all workers.
+ *
+ * The task covers the IDs `[first, first+count)`, so the checkpoint
+ * of ::libathome_client::Engine is still the next number to
+ * factorize.
+ */
+class RangeTask: public libathome_client::Task
+{
+public:
+  /**
+   * Numbers per segment.  The sieve state is 32 bytes per number,
+   * so a segment needs 512 KiB.
+   */
+  static const uint32_t SEGMENT_SIZE = 1 << 14;
+  /**
+   * Primes up to it are sieved, enough to factorize all numbers
+   * below `2^40` completely.
+   */
+  static const uint32_t SIEVE_LIMIT = 1 << 20;
+
+  /**
+   * Constructs the task.
+   *
+   * @param first The first number to factorize, greater than `1`
+   * @param count Number of numbers, greater than `0`
+   * @exception ::libathome_common::Error will be thrown if the range
+   *            is empty, contains `0` or `1` or overflows 64 bits
+   */
+  explicit RangeTask(uint64_t first, uint64_t count) noexcept(false);
+  /**
+   * Default destructor.
+   */
+  virtual ~RangeTask();
+
+  /**
+   * Factorizes all numbers of the range.
+   *
+   * @return A ::RangeResult
+   */
+  virtual libathome_client::TaskResult* compute() noexcept(false)
+    override;
+
+private:
+  /** Odd primes up to ::RangeTask::SIEVE_LIMIT, structure of arrays  */
+  typedef struct {
+    std::vector<uint32_t> primes;
+    /** `primes[i] * inverses[i] == 1 (mod 2^64)`  */
+    std::vector<uint64_t> inverses;
+    /** `UINT64_MAX / primes[i]`, `n` is divisible if
+     * `n * inverses[i] <= limits[i]`  */
+    std::vector<uint64_t> limits;
+  } table_t;
+
+  /** Distinct odd primes per number which are stored inline  */
+  static const unsigned FOUND_MAX = 4;
+
+  /** Sieve state of one number, 32 bytes  */
+  typedef struct {
+    /** Not yet divided part  */
+    uint64_t residual;
+    /** Found odd primes in ascending order, `prime << 6 | exponent`  */
+    uint32_t found[FOUND_MAX];
+    /** Index of the last entry_t, for more than `FOUND_MAX` primes  */
+    uint32_t overflow;
+    uint8_t twos;
+    uint8_t count;
+  } number_t;
+
+  /** A found prime of a number with more than `FOUND_MAX` primes,
+   * linked to the previous one  */
+  typedef struct {
+    uint32_t found;
+    uint32_t previous;
+  } entry_t;
+
+  static const uint32_t NONE = UINT32_MAX;
+
+  static const table_t& _table();
+
+}; /* class RangeTask  */
+
+#endif /* PRIMEATHOME_RANGETASK_H__  */
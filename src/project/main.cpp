@@ -18,6 +18,11 @@
 
 #include <libathome-client.hpp>
 
+#include "PrimeEngine.hpp"
+#include "Factorizer.hpp"
+
+#include <cstdlib>
+
 using namespace ::libathome_common;
 using namespace ::libathome_client;
 
@@ -27,6 +32,49 @@ main(int argc, char** argv)
 {
   Init* init = new Init(argc, argv);
 
+  /* Numbers per run, `--count=0` runs until the process is killed  */
+  uint64_t count = 100000;
+  /* Numbers per task, `--range=N` factorizes them by a sieve  */
+  uint64_t range = 1;
+  uint64_t bench = 0;
+  for (int i=1; i<argc; i++) {
+    if (0 == ::strncmp(argv[i], "--count=", 8))
+      count = ::strtoull(argv[i] + 8, NULL, 10);
+    else if (0 == ::strncmp(argv[i], "--range=", 8))
+      range = ::strtoull(argv[i] + 8, NULL, 10);
+    else if (0 == ::strcmp(argv[i], "--bench"))
+      bench = 100000;
+    else if (0 == ::strncmp(argv[i], "--bench=", 8))
+      bench = ::strtoull(argv[i] + 8, NULL, 10);
+  }
+
+  /* Numbers per range for Factorizer::benchmark(), instead of
+   * running the engine
+   */
+  if (bench != 0) {
+    Factorizer::benchmark(bench);
+    delete init;
+    return 0;
+  }
+
+  int result = 0;
+  try {
+    if (range < 1) range = 1;
+    PrimeEngine engine(range);
+
+    MonotonicClock clock;
+    uint64_t done = range * engine.run((count + range - 1) / range);
+    double seconds = clock.get_elapsed() / 1e9;
+
+    Log->info("Factorized %lu numbers in %.3f s (%.0f/s), continue at %lu",
+              (unsigned long) done, seconds,
+              seconds > 0? done / seconds: 0.0,
+              (unsigned long) engine.get_checkpoint());
+  } catch (Error& e) {
+    Log->error(e);
+    result = 1;
+  }
+
   delete init;
-  return 0;
+  return result;
 }